@@ -11,6 +11,7 @@
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
+#include "util/rate_limiter.h"
 
 namespace leveldb {
 
@@ -22,15 +23,23 @@ Status BuildTable(const std::string& dbname,
                   FileMetaData* meta) {
   Status s;
   meta->file_size = 0;
+  meta->num_entries = 0;
+  meta->num_deletions = 0;
   iter->SeekToFirst();
 
   std::string fname = TableFileName(dbname, meta->number);
   if (iter->Valid()) {
     WritableFile* file;
-    s = env->NewWritableFile(fname, &file);
+    if (options.use_direct_io_for_flush_and_compaction) {
+      s = env->NewDirectWritableFile(fname, &file);
+    } else {
+      s = env->NewWritableFile(fname, &file);
+    }
     if (!s.ok()) {
       return s;
     }
+    file = NewRateLimitedWritableFile(file, options.rate_limiter,
+                                      RateLimiter::kHighPriority);
 
     TableBuilder* builder = new TableBuilder(options, file);
     meta->smallest.DecodeFrom(iter->key());
@@ -38,6 +47,10 @@ Status BuildTable(const std::string& dbname,
       Slice key = iter->key();
       meta->largest.DecodeFrom(key);
       builder->Add(key, iter->value());
+      meta->num_entries++;
+      if (ExtractValueType(key) == kTypeDeletion) {
+        meta->num_deletions++;
+      }
     }
 
     // Finish and check for builder errors
@@ -0,0 +1,121 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/column_family.h"
+
+#include <vector>
+#include "db/db_impl.h"
+#include "db/memtable.h"
+#include "db/table_cache.h"
+#include "db/version_set.h"
+#include "leveldb/env.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+const char* kDefaultColumnFamilyName = "default";
+
+// Return "cf_options" with the options that describe the DB as a whole
+// replaced by those of "db_options".
+static Options MergeOptions(const Options& db_options,
+                            const Options& cf_options) {
+  Options result = cf_options;
+  result.env = db_options.env;
+  result.info_log = db_options.info_log;
+  result.paranoid_checks = db_options.paranoid_checks;
+  result.max_open_files = db_options.max_open_files;
+  result.reuse_logs = db_options.reuse_logs;
+  result.delayed_write_rate = db_options.delayed_write_rate;
+  result.rate_limiter = db_options.rate_limiter;
+  result.inplace_update_support = db_options.inplace_update_support;
+  result.statistics = db_options.statistics;
+  result.listeners = db_options.listeners;
+  if (result.block_cache == NULL) {
+    result.block_cache = db_options.block_cache;
+  }
+  return result;
+}
+
+ColumnFamilyData::ColumnFamilyData(uint32_t id, const std::string& name,
+                                   const std::string& dir,
+                                   const Options& db_options,
+                                   const Options& cf_options,
+                                   Cache* table_cache,
+                                   std::vector<std::string>* dropped_dirs)
+    : id(id),
+      name(name),
+      dir(dir),
+      internal_comparator(cf_options.comparator),
+      internal_filter_policy(cf_options.filter_policy),
+      options(SanitizeOptions(dir, &internal_comparator,
+                              &internal_filter_policy,
+                              MergeOptions(db_options, cf_options))),
+      table_cache(new TableCache(dir, &options, table_cache, id)),
+      versions(new VersionSet(dir, &options, this->table_cache,
+                              &internal_comparator)),
+      mem(NULL),
+      imm(NULL),
+      flushed_bytes(0),
+      dropped(false),
+      refs(0),
+      dropped_dirs_(dropped_dirs) {
+}
+
+ColumnFamilyData::~ColumnFamilyData() {
+  assert(refs == 0);
+  // The open tables of this column family would otherwise stay in the
+  // shared cache until they are pushed out.
+  std::set<uint64_t> live;
+  versions->AddLiveFiles(&live);
+  for (std::set<uint64_t>::iterator it = live.begin(); it != live.end();
+       ++it) {
+    table_cache->Evict(*it);
+  }
+  delete versions;
+  delete table_cache;
+  if (mem != NULL) mem->Unref();
+  if (imm != NULL) imm->Unref();
+  if (dropped) {
+    dropped_dirs_->push_back(dir);
+  }
+}
+
+ColumnFamilyHandleImpl::ColumnFamilyHandleImpl(ColumnFamilyData* cfd,
+                                               DBImpl* db, port::Mutex* mu)
+    : cfd_(cfd), db_(db), mu_(mu) {
+  mu_->AssertHeld();
+  cfd_->Ref();
+}
+
+ColumnFamilyHandleImpl::~ColumnFamilyHandleImpl() {
+  mu_->Lock();
+  const bool delete_dir = (cfd_->dropped && cfd_->refs == 1);
+  cfd_->Unref();
+  mu_->Unlock();
+  if (delete_dir) {
+    db_->DeleteDroppedColumnFamilyDirs();
+  }
+}
+
+Status DestroyColumnFamilyDir(Env* env, const std::string& dir) {
+  std::vector<std::string> filenames;
+  env->GetChildren(dir, &filenames);  // Ignoring errors on purpose
+  Status result;
+  for (size_t i = 0; i < filenames.size(); i++) {
+    if (filenames[i] == "." || filenames[i] == "..") {
+      continue;
+    }
+    Status del = env->DeleteFile(dir + "/" + filenames[i]);
+    if (result.ok() && !del.ok()) {
+      result = del;
+    }
+  }
+  Status del = env->DeleteDir(dir);
+  if (result.ok() && !del.ok()) {
+    result = del;
+  }
+  return result;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,141 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// The state of one column family of a DB.
+//
+// Every column family has its own memtables, VersionSet and table files.
+// The files of the default column family live in the DB directory; the
+// files of every other column family live in a directory of their own
+// (see ColumnFamilyDirName()) with its own descriptor and file numbers.
+// The log is shared: it lives in the DB directory and its numbers are
+// allocated by the VersionSet of the default column family, which also
+// holds the last sequence number of the DB and the list of the other
+// column families.
+
+#ifndef STORAGE_LEVELDB_DB_COLUMN_FAMILY_H_
+#define STORAGE_LEVELDB_DB_COLUMN_FAMILY_H_
+
+#include <set>
+#include <string>
+#include <vector>
+#include "db/dbformat.h"
+#include "leveldb/db.h"
+#include "leveldb/options.h"
+#include "port/port.h"
+
+namespace leveldb {
+
+class Cache;
+class DBImpl;
+class MemTable;
+class TableCache;
+class VersionSet;
+
+// Per level compaction stats.  stats[level] stores the stats for
+// compactions that produced data for the specified "level".
+struct CompactionStats {
+  int64_t micros;
+  int64_t bytes_read;
+  int64_t bytes_written;
+
+  CompactionStats() : micros(0), bytes_read(0), bytes_written(0) { }
+
+  void Add(const CompactionStats& c) {
+    this->micros += c.micros;
+    this->bytes_read += c.bytes_read;
+    this->bytes_written += c.bytes_written;
+  }
+};
+
+// All members other than the constant ones are protected by the mutex
+// of the DB.
+struct ColumnFamilyData {
+  // "db_options" are the sanitized options of the DB; the options that
+  // describe the DB as a whole are taken from it.  The remaining options
+  // are taken from "cf_options".  Open tables are kept in the shared
+  // "table_cache".  If the column family is dropped, its directory is
+  // appended to "*dropped_dirs" when the object is deleted, so that the
+  // DB can delete the files once it has released its mutex.
+  ColumnFamilyData(uint32_t id, const std::string& name,
+                   const std::string& dir, const Options& db_options,
+                   const Options& cf_options, Cache* table_cache,
+                   std::vector<std::string>* dropped_dirs);
+
+  // Increase or drop the reference count.  Unref() deletes the object
+  // when no more references exist.
+  // REQUIRES: the DB mutex is held.
+  void Ref() { ++refs; }
+  void Unref() {
+    --refs;
+    assert(refs >= 0);
+    if (refs <= 0) {
+      delete this;
+    }
+  }
+
+  const uint32_t id;
+  const std::string name;
+  const std::string dir;   // Directory that holds the table files
+  const InternalKeyComparator internal_comparator;
+  const InternalFilterPolicy internal_filter_policy;
+  const Options options;   // options.comparator == &internal_comparator
+
+  // table_cache provides its own synchronization
+  TableCache* const table_cache;
+  VersionSet* const versions;
+
+  MemTable* mem;
+  MemTable* imm;           // Memtable being compacted
+
+  // Set of table files to protect from deletion because they are
+  // part of ongoing compactions.
+  std::set<uint64_t> pending_outputs;
+
+  CompactionStats stats[config::kNumLevels];
+
+  // Bytes written by memtable compactions; the denominator of the write
+  // amplification reported in the "leveldb.stats" property.
+  int64_t flushed_bytes;
+
+  // Set once the column family has been dropped.  Its files are deleted
+  // after the last reference goes away.
+  bool dropped;
+
+  int refs;
+
+ private:
+  ~ColumnFamilyData();  // Private since only Unref() should be used
+
+  std::vector<std::string>* const dropped_dirs_;
+
+  // No copying allowed
+  ColumnFamilyData(const ColumnFamilyData&);
+  void operator=(const ColumnFamilyData&);
+};
+
+class ColumnFamilyHandleImpl : public ColumnFamilyHandle {
+ public:
+  // Holds a reference to "cfd", which is released under "*mu".
+  // REQUIRES: "*mu", the mutex of "db", is held
+  ColumnFamilyHandleImpl(ColumnFamilyData* cfd, DBImpl* db, port::Mutex* mu);
+  virtual ~ColumnFamilyHandleImpl();
+
+  virtual const std::string& GetName() const { return cfd_->name; }
+  virtual uint32_t GetID() const { return cfd_->id; }
+
+  ColumnFamilyData* cfd() const { return cfd_; }
+
+ private:
+  ColumnFamilyData* const cfd_;
+  DBImpl* const db_;
+  port::Mutex* const mu_;
+};
+
+// Delete the directory "dir" of a column family along with all the files
+// in it.
+extern Status DestroyColumnFamilyDir(Env* env, const std::string& dir);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_COLUMN_FAMILY_H_
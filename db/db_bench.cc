@@ -3,13 +3,18 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include <sys/types.h>
+#include <algorithm>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "db/db_impl.h"
 #include "db/version_set.h"
 #include "leveldb/cache.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/rate_limiter.h"
+#include "leveldb/statistics.h"
 #include "leveldb/write_batch.h"
 #include "port/port.h"
 #include "util/crc32c.h"
@@ -33,6 +38,18 @@
 //      readmissing   -- read N missing keys in random order
 //      readhot       -- read N times in random order from 1% section of DB
 //      seekrandom    -- N random seeks
+//      readrandomwriterandom -- N random reads and writes, --readwritepercent
+//                       of which are reads
+//      ycsba         -- YCSB workload A: 50% reads, 50% updates, zipfian
+//      ycsbb         -- YCSB workload B: 95% reads, 5% updates, zipfian
+//      ycsbc         -- YCSB workload C: 100% reads, zipfian
+//      ycsbd         -- YCSB workload D: 95% reads, 5% inserts, latest
+//      ycsbe         -- YCSB workload E: 95% short scans, 5% inserts, zipfian
+//      ycsbf         -- YCSB workload F: 50% reads, 50% read-modify-writes,
+//                       zipfian
+//                       The YCSB workloads expect a database loaded by a
+//                       preceding fillseq or fillrandom and do --reads
+//                       operations.
 //      open          -- cost of opening a DB
 //      crc32c        -- repeated crc32c of 4K of data
 //      acquireload   -- load N*1000 times
@@ -40,6 +57,7 @@
 //      compact     -- Compact the entire DB
 //      stats       -- Print DB stats
 //      sstables    -- Print sstable info
+//      statistics  -- Print DB statistics (requires --statistics=1)
 //      heapprofile -- Dump a heap profile (if supported by this port)
 static const char* FLAGS_benchmarks =
     "fillseq,"
@@ -80,6 +98,19 @@ static double FLAGS_compression_ratio = 0.5;
 // Print histogram of operation timings
 static bool FLAGS_histogram = false;
 
+// If positive, print the throughput and latency percentiles of the last
+// interval every this many seconds while a benchmark runs
+static int FLAGS_report_interval = 0;
+
+// If "json" or "csv", also write a machine-readable record for every
+// benchmark (and every reporting interval) to --output_file: one JSON
+// object per line, or CSV rows with a header.
+static const char* FLAGS_output_format = NULL;
+
+// File the machine-readable records are written to.  If NULL, they are
+// written to stdout.
+static const char* FLAGS_output_file = NULL;
+
 // Number of bytes to buffer in memtable before compacting
 // (initialized to default value by "main")
 static int FLAGS_write_buffer_size = 0;
@@ -103,6 +134,57 @@ static int FLAGS_open_files = 0;
 // Negative means use default settings.
 static int FLAGS_bloom_bits = -1;
 
+// Compaction style: 0 for leveled, 1 for universal (tiered).  Use the
+// "stats" benchmark to compare the resulting write amplification.
+static int FLAGS_compaction_style = 0;
+
+// If positive, limit flush and compaction writes to this many bytes per
+// second.  Compare "readwhilewriting --histogram=1" runs with and without
+// a limit to see the effect on read latency.
+static int FLAGS_rate_limiter_bytes_per_sec = 0;
+
+// If true, the rate limit above is an upper bound that is tuned to the
+// demand for background writes.
+static bool FLAGS_rate_limiter_auto_tuned = false;
+
+// If true, flushes and compactions use direct I/O
+static bool FLAGS_use_direct_io_for_flush_and_compaction = false;
+
+// Readahead size for compaction inputs (use default if < 0)
+static int FLAGS_compaction_readahead_size = -1;
+
+// Number of blocks iterators prefetch during sequential scans
+static int FLAGS_prefetch_blocks = 0;
+
+// If true, readrandom reads values into a PinnableSlice instead of
+// copying them into a string
+static bool FLAGS_pin_values = false;
+
+// If true, collect tickers and latency histograms in a Statistics object
+static bool FLAGS_statistics = false;
+
+// Distribution of the keys read and updated by readrandom, seekrandom,
+// readrandomwriterandom and the YCSB workloads: "uniform", "zipfian"
+// (popular keys scattered over the key space), "latest" (recently
+// inserted keys are the most popular) or "hotspot".  If NULL, the YCSB
+// workloads use their standard distribution and the others use uniform.
+static const char* FLAGS_key_dist = NULL;
+
+// Skew of the zipfian and latest distributions
+static double FLAGS_zipf_theta = 0.99;
+
+// The hotspot distribution sends this fraction of the operations to
+// the first --hotspot_data_fraction of the keys
+static double FLAGS_hotspot_opn_fraction = 0.8;
+static double FLAGS_hotspot_data_fraction = 0.2;
+
+// Percentage of reads in readrandomwriterandom
+static int FLAGS_readwritepercent = 90;
+
+// Maximum number of entries read by a YCSB workload E scan.  Scan
+// lengths are uniformly distributed in [1, ycsb_max_scan_length].
+static int FLAGS_ycsb_max_scan_length = 100;
+
 // If true, do not destroy the existing database.  If you set this
 // flag and also specify a benchmark that wants a fresh database, that
 // benchmark will fail.
@@ -151,6 +233,49 @@ class RandomGenerator {
   }
 };
 
+enum KeyDistribution {
+  kUniform,
+  kZipfian,
+  kLatest,
+  kHotspot
+};
+
+static bool ParseKeyDistribution(const char* name, KeyDistribution* dist) {
+  if (strcmp(name, "uniform") == 0) {
+    *dist = kUniform;
+  } else if (strcmp(name, "zipfian") == 0) {
+    *dist = kZipfian;
+  } else if (strcmp(name, "latest") == 0) {
+    *dist = kLatest;
+  } else if (strcmp(name, "hotspot") == 0) {
+    *dist = kHotspot;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Operation mix of a YCSB workload, in percent
+struct Workload {
+  int read;
+  int update;
+  int insert;
+  int scan;
+  int read_modify_write;
+  KeyDistribution dist;
+};
+
+// Workloads A-F of the Yahoo! Cloud Serving Benchmark
+static const Workload kYCSBWorkloads[] = {
+  // read update insert scan rmw
+  {  50,   50,     0,     0,   0, kZipfian },    // A: update heavy
+  {  95,    5,     0,     0,   0, kZipfian },    // B: read mostly
+  { 100,    0,     0,     0,   0, kZipfian },    // C: read only
+  {  95,    0,     5,     0,   0, kLatest },     // D: read latest
+  {   0,    0,     5,    95,   0, kZipfian },    // E: short ranges
+  {  50,    0,     0,     0,  50, kZipfian },    // F: read-modify-write
+};
+
 #if defined(__linux)
 static Slice TrimSpace(Slice s) {
   size_t start = 0;
@@ -173,6 +298,124 @@ static void AppendWithSpace(std::string* str, Slice msg) {
   str->append(msg.data(), msg.size());
 }
 
+enum OutputFormat {
+  kOutputNone,
+  kOutputJSON,
+  kOutputCSV
+};
+
+static OutputFormat g_output_format = kOutputNone;
+static FILE* g_output = NULL;
+
+// Latencies are only measured when some report needs them, since reading
+// the clock after every op slows down the fastest benchmarks.
+static bool MeasureLatency() {
+  return FLAGS_histogram || FLAGS_report_interval > 0 ||
+         g_output_format != kOutputNone;
+}
+
+static void WriteRecordHeader() {
+  if (g_output_format == kOutputCSV) {
+    fprintf(g_output,
+            "type,benchmark,threads,num,value_size,elapsed_seconds,ops,"
+            "micros_per_op,ops_per_sec,mb_per_sec,p50_micros,p99_micros,"
+            "p999_micros,max_micros\n");
+    fflush(g_output);
+  }
+}
+
+// Write a machine-readable record of a whole benchmark run ("summary")
+// or of one reporting interval ("interval") to g_output.
+static void WriteRecord(const char* type, const Slice& name, int threads,
+                        double elapsed_seconds, int64_t ops,
+                        double micros_per_op, double mb_per_sec,
+                        const Histogram& hist) {
+  const double ops_per_sec =
+      elapsed_seconds > 0 ? ops / elapsed_seconds : 0;
+  const char* fmt;
+  if (g_output_format == kOutputJSON) {
+    fmt = "{\"type\": \"%s\", \"benchmark\": \"%s\", \"threads\": %d, "
+          "\"num\": %d, \"value_size\": %d, \"elapsed_seconds\": %.3f, "
+          "\"ops\": %lld, \"micros_per_op\": %.3f, \"ops_per_sec\": %.1f, "
+          "\"mb_per_sec\": %.1f, \"p50_micros\": %.2f, "
+          "\"p99_micros\": %.2f, \"p999_micros\": %.2f, "
+          "\"max_micros\": %.0f}\n";
+  } else if (g_output_format == kOutputCSV) {
+    fmt = "%s,%s,%d,%d,%d,%.3f,%lld,%.3f,%.1f,%.1f,%.2f,%.2f,%.2f,%.0f\n";
+  } else {
+    return;
+  }
+  const bool have_latency = hist.Count() > 0;
+  fprintf(g_output, fmt, type, name.ToString().c_str(), threads,
+          FLAGS_num, FLAGS_value_size, elapsed_seconds,
+          static_cast<long long>(ops), micros_per_op, ops_per_sec,
+          mb_per_sec,
+          have_latency ? hist.Median() : 0.0,
+          have_latency ? hist.Percentile(99) : 0.0,
+          have_latency ? hist.Percentile(99.9) : 0.0,
+          have_latency ? hist.Max() : 0.0);
+  fflush(g_output);
+}
+
+// Combines the latencies of all threads running a benchmark and prints
+// the throughput and latency percentiles of every --report_interval
+// seconds.  The reports are printed by the thread that waits for the
+// benchmark, so an interval in which no op finishes (e.g. during a write
+// stall) is reported as 0 ops/sec.
+class IntervalReporter {
+ public:
+  IntervalReporter(const Slice& name, int threads)
+      : name_(name.ToString()),
+        threads_(threads),
+        start_(g_env->NowMicros()),
+        last_report_(start_),
+        done_(0) {
+    hist_.Clear();
+  }
+
+  // Add the ops a thread finished since its last call.
+  void Add(int done, const Histogram& hist) {
+    MutexLock l(&mu_);
+    done_ += done;
+    hist_.Merge(hist);
+  }
+
+  // Print a report if the current interval has ended.  Returns the time
+  // at which the next report is due.
+  double MaybeReport(double now) {
+    MutexLock l(&mu_);
+    const double interval_micros = now - last_report_;
+    if (interval_micros < FLAGS_report_interval * 1e6) {
+      return last_report_ + FLAGS_report_interval * 1e6;
+    }
+    const double ops_per_sec = done_ / (interval_micros * 1e-6);
+    const bool have_latency = hist_.Count() > 0;
+    fprintf(stdout, "%-12s : %8.1f s %11.1f ops/sec; "
+            "P50: %.2f P99: %.2f P99.9: %.2f Max: %.0f micros\n",
+            name_.c_str(), (now - start_) * 1e-6, ops_per_sec,
+            have_latency ? hist_.Median() : 0.0,
+            have_latency ? hist_.Percentile(99) : 0.0,
+            have_latency ? hist_.Percentile(99.9) : 0.0,
+            have_latency ? hist_.Max() : 0.0);
+    fflush(stdout);
+    WriteRecord("interval", name_, threads_, interval_micros * 1e-6, done_,
+                done_ > 0 ? interval_micros / done_ : 0, 0, hist_);
+    last_report_ = now;
+    done_ = 0;
+    hist_.Clear();
+    return now + FLAGS_report_interval * 1e6;
+  }
+
+ private:
+  const std::string name_;
+  const int threads_;
+  const double start_;
+  port::Mutex mu_;
+  double last_report_;
+  int64_t done_;
+  Histogram hist_;
+};
+
 class Stats {
  private:
   double start_;
@@ -185,19 +428,32 @@ class Stats {
   Histogram hist_;
   std::string message_;
 
+  // Ops finished since they were last handed to interval_
+  IntervalReporter* interval_;
+  int interval_done_;
+  Histogram interval_hist_;
+  double next_interval_flush_;
+
  public:
-  Stats() { Start(); }
+  Stats() : interval_(NULL) { Start(); }
+
+  void SetIntervalReporter(IntervalReporter* interval) {
+    interval_ = interval;
+  }
 
   void Start() {
     next_report_ = 100;
-    last_op_finish_ = start_;
     hist_.Clear();
     done_ = 0;
     bytes_ = 0;
     seconds_ = 0;
     start_ = g_env->NowMicros();
     finish_ = start_;
+    last_op_finish_ = start_;
     message_.clear();
+    interval_done_ = 0;
+    interval_hist_.Clear();
+    next_interval_flush_ = start_;
   }
 
   void Merge(const Stats& other) {
@@ -215,6 +471,7 @@ class Stats {
   void Stop() {
     finish_ = g_env->NowMicros();
     seconds_ = (finish_ - start_) * 1e-6;
+    FlushInterval();
   }
 
   void AddMessage(Slice msg) {
@@ -222,7 +479,7 @@ class Stats {
   }
 
   void FinishedSingleOp() {
-    if (FLAGS_histogram) {
+    if (MeasureLatency()) {
       double now = g_env->NowMicros();
       double micros = now - last_op_finish_;
       hist_.Add(micros);
@@ -231,6 +488,17 @@ class Stats {
         fflush(stderr);
       }
       last_op_finish_ = now;
+
+      if (interval_ != NULL && FLAGS_report_interval > 0) {
+        interval_done_++;
+        interval_hist_.Add(micros);
+        if (now >= next_interval_flush_) {
+          // Hand the ops over a few times per interval so that the
+          // reports do not lag behind
+          FlushInterval();
+          next_interval_flush_ = now + FLAGS_report_interval * 1e5;
+        }
+      }
     }
 
     done_++;
@@ -251,32 +519,53 @@ class Stats {
     bytes_ += n;
   }
 
-  void Report(const Slice& name) {
+  void Report(const Slice& name, int threads) {
     // Pretend at least one op was done in case we are running a benchmark
     // that does not call FinishedSingleOp().
     if (done_ < 1) done_ = 1;
 
     std::string extra;
+    // Rate is computed on actual elapsed time, not the sum of per-thread
+    // elapsed times.
+    const double elapsed = (finish_ - start_) * 1e-6;
+    double mb_per_sec = 0;
     if (bytes_ > 0) {
-      // Rate is computed on actual elapsed time, not the sum of per-thread
-      // elapsed times.
-      double elapsed = (finish_ - start_) * 1e-6;
+      mb_per_sec = (bytes_ / 1048576.0) / elapsed;
       char rate[100];
-      snprintf(rate, sizeof(rate), "%6.1f MB/s",
-               (bytes_ / 1048576.0) / elapsed);
+      snprintf(rate, sizeof(rate), "%6.1f MB/s", mb_per_sec);
       extra = rate;
     }
+    if (hist_.Count() > 0) {
+      char percentiles[200];
+      snprintf(percentiles, sizeof(percentiles),
+               "P50: %.2f P99: %.2f P99.9: %.2f Max: %.0f;",
+               hist_.Median(), hist_.Percentile(99), hist_.Percentile(99.9),
+               hist_.Max());
+      AppendWithSpace(&extra, percentiles);
+    }
     AppendWithSpace(&extra, message_);
 
+    const double micros_per_op = seconds_ * 1e6 / done_;
     fprintf(stdout, "%-12s : %11.3f micros/op;%s%s\n",
             name.ToString().c_str(),
-            seconds_ * 1e6 / done_,
+            micros_per_op,
             (extra.empty() ? "" : " "),
             extra.c_str());
     if (FLAGS_histogram) {
       fprintf(stdout, "Microseconds per op:\n%s\n", hist_.ToString().c_str());
     }
     fflush(stdout);
+    WriteRecord("summary", name, threads, elapsed, done_, micros_per_op,
+                mb_per_sec, hist_);
+  }
+
+ private:
+  void FlushInterval() {
+    if (interval_ != NULL && interval_done_ > 0) {
+      interval_->Add(interval_done_, interval_hist_);
+      interval_done_ = 0;
+      interval_hist_.Clear();
+    }
   }
 };
 
@@ -318,6 +607,8 @@ class Benchmark {
  private:
   Cache* cache_;
   const FilterPolicy* filter_policy_;
+  RateLimiter* rate_limiter_;
+  Statistics* statistics_;
   DB* db_;
   int num_;
   int value_size_;
@@ -326,6 +617,16 @@ class Benchmark {
   int reads_;
   int heap_counter_;
 
+  // Key distribution and YCSB operation mix of the current benchmark
+  KeyDistribution key_dist_;
+  Workload workload_;
+  test::ZipfianGenerator* zipf_;    // Over FLAGS_num keys; created on first use
+
+  // Keys inserted by the YCSB workloads follow the FLAGS_num keys
+  // written by the fill benchmarks
+  port::Mutex insert_mu_;
+  int64_t next_insert_key_;
+
   void PrintHeader() {
     const int kKeySize = 16;
     PrintEnvironment();
@@ -406,12 +707,20 @@ class Benchmark {
     filter_policy_(FLAGS_bloom_bits >= 0
                    ? NewBloomFilterPolicy(FLAGS_bloom_bits)
                    : NULL),
+    rate_limiter_(FLAGS_rate_limiter_bytes_per_sec > 0
+                  ? NewGenericRateLimiter(FLAGS_rate_limiter_bytes_per_sec,
+                                          FLAGS_rate_limiter_auto_tuned)
+                  : NULL),
+    statistics_(FLAGS_statistics ? CreateDBStatistics() : NULL),
     db_(NULL),
     num_(FLAGS_num),
     value_size_(FLAGS_value_size),
     entries_per_batch_(1),
     reads_(FLAGS_reads < 0 ? FLAGS_num : FLAGS_reads),
-    heap_counter_(0) {
+    heap_counter_(0),
+    key_dist_(kUniform),
+    zipf_(NULL),
+    next_insert_key_(FLAGS_num) {
     std::vector<std::string> files;
     g_env->GetChildren(FLAGS_db, &files);
     for (size_t i = 0; i < files.size(); i++) {
@@ -428,6 +737,9 @@ class Benchmark {
     delete db_;
     delete cache_;
     delete filter_policy_;
+    delete rate_limiter_;
+    delete statistics_;
+    delete zipf_;
   }
 
   void Run() {
@@ -452,6 +764,7 @@ class Benchmark {
       value_size_ = FLAGS_value_size;
       entries_per_batch_ = 1;
       write_options_ = WriteOptions();
+      key_dist_ = kUniform;
 
       void (Benchmark::*method)(ThreadState*) = NULL;
       bool fresh_db = false;
@@ -503,6 +816,13 @@ class Benchmark {
         method = &Benchmark::DeleteSeq;
       } else if (name == Slice("deleterandom")) {
         method = &Benchmark::DeleteRandom;
+      } else if (name == Slice("readrandomwriterandom")) {
+        method = &Benchmark::ReadRandomWriteRandom;
+      } else if (name.size() == 5 && name.starts_with("ycsb") &&
+                 name[4] >= 'a' && name[4] <= 'f') {
+        workload_ = kYCSBWorkloads[name[4] - 'a'];
+        key_dist_ = workload_.dist;
+        method = &Benchmark::YCSB;
       } else if (name == Slice("readwhilewriting")) {
         num_threads++;  // Add extra thread for writing
         method = &Benchmark::ReadWhileWriting;
@@ -522,13 +842,23 @@ class Benchmark {
         PrintStats("leveldb.stats");
       } else if (name == Slice("sstables")) {
         PrintStats("leveldb.sstables");
+      } else if (name == Slice("statistics")) {
+        PrintStats("leveldb.statistics");
       } else {
         if (name != Slice()) {  // No error message for empty name
           fprintf(stderr, "unknown benchmark '%s'\n", name.ToString().c_str());
         }
       }
 
+      if (FLAGS_key_dist != NULL) {
+        ParseKeyDistribution(FLAGS_key_dist, &key_dist_);
+      }
+      if ((key_dist_ == kZipfian || key_dist_ == kLatest) && zipf_ == NULL) {
+        zipf_ = new test::ZipfianGenerator(FLAGS_num, FLAGS_zipf_theta);
+      }
+
       if (fresh_db) {
+        next_insert_key_ = FLAGS_num;
         if (FLAGS_use_existing_db) {
           fprintf(stdout, "%-12s : skipped (--use_existing_db is true)\n",
                   name.ToString().c_str());
@@ -590,6 +920,7 @@ class Benchmark {
     shared.num_initialized = 0;
     shared.num_done = 0;
     shared.start = false;
+    IntervalReporter interval(name, n);
 
     ThreadArg* arg = new ThreadArg[n];
     for (int i = 0; i < n; i++) {
@@ -598,6 +929,7 @@ class Benchmark {
       arg[i].shared = &shared;
       arg[i].thread = new ThreadState(i);
       arg[i].thread->shared = &shared;
+      arg[i].thread->stats.SetIntervalReporter(&interval);
       g_env->StartThread(ThreadBody, &arg[i]);
     }
 
@@ -608,15 +940,27 @@ class Benchmark {
 
     shared.start = true;
     shared.cv.SignalAll();
-    while (shared.num_done < n) {
-      shared.cv.Wait();
+    if (FLAGS_report_interval > 0) {
+      // Poll so that intervals without finished ops are reported too
+      while (shared.num_done < n) {
+        shared.mu.Unlock();
+        const double now = g_env->NowMicros();
+        const double next = interval.MaybeReport(now);
+        g_env->SleepForMicroseconds(
+            static_cast<int>(std::min(next - now, 100000.0)) + 1);
+        shared.mu.Lock();
+      }
+    } else {
+      while (shared.num_done < n) {
+        shared.cv.Wait();
+      }
     }
     shared.mu.Unlock();
 
     for (int i = 1; i < n; i++) {
       arg[0].thread->stats.Merge(arg[i].thread->stats);
     }
-    arg[0].thread->stats.Report(name);
+    arg[0].thread->stats.Report(name, n);
 
     for (int i = 0; i < n; i++) {
       delete arg[i].thread;
@@ -717,7 +1061,16 @@ class Benchmark {
     options.block_size = FLAGS_block_size;
     options.max_open_files = FLAGS_open_files;
     options.filter_policy = filter_policy_;
+    options.rate_limiter = rate_limiter_;
+    options.statistics = statistics_;
+    options.use_direct_io_for_flush_and_compaction =
+        FLAGS_use_direct_io_for_flush_and_compaction;
+    if (FLAGS_compaction_readahead_size >= 0) {
+      options.compaction_readahead_size = FLAGS_compaction_readahead_size;
+    }
     options.reuse_logs = FLAGS_reuse_logs;
+    options.compaction_style =
+        static_cast<CompactionStyle>(FLAGS_compaction_style);
     Status s = DB::Open(options, FLAGS_db, &db_);
     if (!s.ok()) {
       fprintf(stderr, "open error: %s\n", s.ToString().c_str());
@@ -772,7 +1125,9 @@ class Benchmark {
   }
 
   void ReadSequential(ThreadState* thread) {
-    Iterator* iter = db_->NewIterator(ReadOptions());
+    ReadOptions options;
+    options.prefetch_blocks = FLAGS_prefetch_blocks;
+    Iterator* iter = db_->NewIterator(options);
     int i = 0;
     int64_t bytes = 0;
     for (iter->SeekToFirst(); i < reads_ && iter->Valid(); iter->Next()) {
@@ -800,12 +1155,15 @@ class Benchmark {
   void ReadRandom(ThreadState* thread) {
     ReadOptions options;
     std::string value;
+    PinnableSlice pinned;
     int found = 0;
     for (int i = 0; i < reads_; i++) {
       char key[100];
-      const int k = thread->rand.Next() % FLAGS_num;
+      const int k = NextKey(thread);
       snprintf(key, sizeof(key), "%016d", k);
-      if (db_->Get(options, key, &value).ok()) {
+      Status s = FLAGS_pin_values ? db_->Get(options, key, &pinned) :
+                                    db_->Get(options, key, &value);
+      if (s.ok()) {
         found++;
       }
       thread->stats.FinishedSingleOp();
@@ -846,7 +1204,7 @@ class Benchmark {
     for (int i = 0; i < reads_; i++) {
       Iterator* iter = db_->NewIterator(options);
       char key[100];
-      const int k = thread->rand.Next() % FLAGS_num;
+      const int k = NextKey(thread);
       snprintf(key, sizeof(key), "%016d", k);
       iter->Seek(key);
       if (iter->Valid() && iter->key() == key) found++;
@@ -858,6 +1216,149 @@ class Benchmark {
     thread->stats.AddMessage(msg);
   }
 
+  int64_t NextInsertKey() {
+    MutexLock l(&insert_mu_);
+    return next_insert_key_++;
+  }
+
+  // Returns the key to read or update next, drawn from key_dist_ over the
+  // keys written by the fill benchmarks (and, for the latest distribution,
+  // the keys inserted since).
+  int64_t NextKey(ThreadState* thread) {
+    switch (key_dist_) {
+      case kZipfian:
+        return zipf_->NextScrambled(&thread->rand);
+      case kLatest: {
+        int64_t latest;
+        {
+          MutexLock l(&insert_mu_);
+          latest = next_insert_key_ - 1;
+        }
+        const int64_t k = latest - static_cast<int64_t>(
+            zipf_->Next(&thread->rand));
+        return std::max<int64_t>(k, 0);
+      }
+      case kHotspot: {
+        const int64_t hot = std::max<int64_t>(
+            static_cast<int64_t>(FLAGS_num * FLAGS_hotspot_data_fraction), 1);
+        if (hot >= FLAGS_num ||
+            test::NextDouble(&thread->rand) < FLAGS_hotspot_opn_fraction) {
+          return thread->rand.Next() % hot;
+        }
+        return hot + thread->rand.Next() % (FLAGS_num - hot);
+      }
+      case kUniform:
+        break;
+    }
+    return thread->rand.Next() % FLAGS_num;
+  }
+
+  void ReadRandomWriteRandom(ThreadState* thread) {
+    ReadOptions options;
+    RandomGenerator gen;
+    std::string value;
+    int found = 0;
+    int reads = 0;
+    int writes = 0;
+    for (int i = 0; i < reads_; i++) {
+      char key[100];
+      const int k = NextKey(thread);
+      snprintf(key, sizeof(key), "%016d", k);
+      if (thread->rand.Uniform(100) < FLAGS_readwritepercent) {
+        reads++;
+        if (db_->Get(options, key, &value).ok()) {
+          found++;
+        }
+      } else {
+        writes++;
+        Status s = db_->Put(write_options_, key, gen.Generate(value_size_));
+        if (!s.ok()) {
+          fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+          exit(1);
+        }
+      }
+      thread->stats.FinishedSingleOp();
+    }
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(reads:%d writes:%d found:%d)",
+             reads, writes, found);
+    thread->stats.AddMessage(msg);
+  }
+
+  void YCSB(ThreadState* thread) {
+    const Workload& w = workload_;
+    ReadOptions options;
+    RandomGenerator gen;
+    std::string value;
+    int found = 0;
+    int counts[5] = { 0, 0, 0, 0, 0 };
+    int64_t bytes = 0;
+    for (int i = 0; i < reads_; i++) {
+      char key[100];
+      Status s;
+      int op = thread->rand.Uniform(100);
+      if (op < w.read) {
+        counts[0]++;
+        snprintf(key, sizeof(key), "%016lld",
+                 static_cast<long long>(NextKey(thread)));
+        s = db_->Get(options, key, &value);
+        if (s.ok()) {
+          found++;
+          bytes += value.size();
+        }
+        s = Status::OK();
+      } else if ((op -= w.read) < w.update) {
+        counts[1]++;
+        snprintf(key, sizeof(key), "%016lld",
+                 static_cast<long long>(NextKey(thread)));
+        s = db_->Put(write_options_, key, gen.Generate(value_size_));
+        bytes += value_size_;
+      } else if ((op -= w.update) < w.insert) {
+        counts[2]++;
+        snprintf(key, sizeof(key), "%016lld",
+                 static_cast<long long>(NextInsertKey()));
+        s = db_->Put(write_options_, key, gen.Generate(value_size_));
+        bytes += value_size_;
+      } else if ((op -= w.insert) < w.scan) {
+        counts[3]++;
+        snprintf(key, sizeof(key), "%016lld",
+                 static_cast<long long>(NextKey(thread)));
+        const int length = 1 + thread->rand.Uniform(FLAGS_ycsb_max_scan_length);
+        Iterator* iter = db_->NewIterator(options);
+        int n = 0;
+        for (iter->Seek(key); n < length && iter->Valid(); iter->Next()) {
+          bytes += iter->value().size();
+          n++;
+        }
+        if (n > 0) {
+          found++;
+        }
+        delete iter;
+      } else {
+        counts[4]++;
+        snprintf(key, sizeof(key), "%016lld",
+                 static_cast<long long>(NextKey(thread)));
+        if (db_->Get(options, key, &value).ok()) {
+          found++;
+          bytes += value.size();
+        }
+        s = db_->Put(write_options_, key, gen.Generate(value_size_));
+        bytes += value_size_;
+      }
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+      thread->stats.FinishedSingleOp();
+    }
+    char msg[200];
+    snprintf(msg, sizeof(msg),
+             "(reads:%d updates:%d inserts:%d scans:%d rmws:%d found:%d)",
+             counts[0], counts[1], counts[2], counts[3], counts[4], found);
+    thread->stats.AddBytes(bytes);
+    thread->stats.AddMessage(msg);
+  }
+
   void DoDelete(ThreadState* thread, bool seq) {
     RandomGenerator gen;
     WriteBatch batch;
@@ -997,6 +1498,65 @@ int main(int argc, char** argv) {
       FLAGS_bloom_bits = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
       FLAGS_open_files = n;
+    } else if (sscanf(argv[i], "--compaction_style=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_compaction_style = n;
+    } else if (sscanf(argv[i], "--rate_limiter_bytes_per_sec=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_rate_limiter_bytes_per_sec = n;
+    } else if (sscanf(argv[i], "--rate_limiter_auto_tuned=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_rate_limiter_auto_tuned = n;
+    } else if (sscanf(argv[i], "--use_direct_io_for_flush_and_compaction=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_use_direct_io_for_flush_and_compaction = n;
+    } else if (sscanf(argv[i], "--compaction_readahead_size=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_compaction_readahead_size = n;
+    } else if (sscanf(argv[i], "--prefetch_blocks=%d%c", &n, &junk) == 1) {
+      FLAGS_prefetch_blocks = n;
+    } else if (sscanf(argv[i], "--pin_values=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_pin_values = n;
+    } else if (sscanf(argv[i], "--statistics=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_statistics = n;
+    } else if (sscanf(argv[i], "--report_interval=%d%c", &n, &junk) == 1) {
+      FLAGS_report_interval = n;
+    } else if (strncmp(argv[i], "--output_format=", 16) == 0) {
+      FLAGS_output_format = argv[i] + 16;
+      if (strcmp(FLAGS_output_format, "json") == 0) {
+        leveldb::g_output_format = leveldb::kOutputJSON;
+      } else if (strcmp(FLAGS_output_format, "csv") == 0) {
+        leveldb::g_output_format = leveldb::kOutputCSV;
+      } else {
+        fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+        exit(1);
+      }
+    } else if (strncmp(argv[i], "--output_file=", 14) == 0) {
+      FLAGS_output_file = argv[i] + 14;
+    } else if (strncmp(argv[i], "--key_dist=", 11) == 0) {
+      FLAGS_key_dist = argv[i] + 11;
+      leveldb::KeyDistribution dist;
+      if (!leveldb::ParseKeyDistribution(FLAGS_key_dist, &dist)) {
+        fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+        exit(1);
+      }
+    } else if (sscanf(argv[i], "--zipf_theta=%lf%c", &d, &junk) == 1 &&
+               d > 0 && d < 1) {
+      FLAGS_zipf_theta = d;
+    } else if (sscanf(argv[i], "--hotspot_opn_fraction=%lf%c",
+                      &d, &junk) == 1 && d >= 0 && d <= 1) {
+      FLAGS_hotspot_opn_fraction = d;
+    } else if (sscanf(argv[i], "--hotspot_data_fraction=%lf%c",
+                      &d, &junk) == 1 && d > 0 && d <= 1) {
+      FLAGS_hotspot_data_fraction = d;
+    } else if (sscanf(argv[i], "--readwritepercent=%d%c", &n, &junk) == 1 &&
+               n >= 0 && n <= 100) {
+      FLAGS_readwritepercent = n;
+    } else if (sscanf(argv[i], "--ycsb_max_scan_length=%d%c",
+                      &n, &junk) == 1 && n > 0) {
+      FLAGS_ycsb_max_scan_length = n;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
       FLAGS_db = argv[i] + 5;
     } else {
@@ -1014,7 +1574,24 @@ int main(int argc, char** argv) {
       FLAGS_db = default_db_path.c_str();
   }
 
+  if (leveldb::g_output_format != leveldb::kOutputNone) {
+    if (FLAGS_output_file == NULL) {
+      leveldb::g_output = stdout;
+    } else {
+      leveldb::g_output = fopen(FLAGS_output_file, "w");
+      if (leveldb::g_output == NULL) {
+        fprintf(stderr, "cannot open %s: %s\n", FLAGS_output_file,
+                strerror(errno));
+        exit(1);
+      }
+    }
+    leveldb::WriteRecordHeader();
+  }
+
   leveldb::Benchmark benchmark;
   benchmark.Run();
+  if (leveldb::g_output != NULL && leveldb::g_output != stdout) {
+    fclose(leveldb::g_output);
+  }
   return 0;
 }
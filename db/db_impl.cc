@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <vector>
 #include "db/builder.h"
+#include "db/column_family.h"
 #include "db/db_iter.h"
 #include "db/dbformat.h"
 #include "db/filename.h"
@@ -32,6 +33,9 @@
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/perf_context_imp.h"
+#include "util/rate_limiter.h"
+#include "util/statistics.h"
 
 namespace leveldb {
 
@@ -41,6 +45,7 @@ const int kNumNonTableCacheFiles = 10;
 struct DBImpl::Writer {
   Status status;
   WriteBatch* batch;
+  std::vector<uint32_t> column_families;  // Non-default ones batch updates
   bool sync;
   bool done;
   port::CondVar cv;
@@ -49,6 +54,7 @@ struct DBImpl::Writer {
 };
 
 struct DBImpl::CompactionState {
+  ColumnFamilyData* const cfd;
   Compaction* const compaction;
 
   // Sequence numbers < smallest_snapshot are not significant since we
@@ -62,6 +68,8 @@ struct DBImpl::CompactionState {
     uint64_t number;
     uint64_t file_size;
     InternalKey smallest, largest;
+    uint64_t num_entries;
+    uint64_t num_deletions;
   };
   std::vector<Output> outputs;
 
@@ -73,8 +81,9 @@ struct DBImpl::CompactionState {
 
   Output* current_output() { return &outputs[outputs.size()-1]; }
 
-  explicit CompactionState(Compaction* c)
-      : compaction(c),
+  CompactionState(ColumnFamilyData* cfd, Compaction* c)
+      : cfd(cfd),
+        compaction(c),
         outfile(NULL),
         builder(NULL),
         total_bytes(0) {
@@ -126,30 +135,44 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       db_lock_(NULL),
       shutting_down_(NULL),
       bg_cv_(&mutex_),
-      mem_(NULL),
-      imm_(NULL),
+      default_cf_(NULL),
+      default_handle_(NULL),
       logfile_(NULL),
       logfile_number_(0),
       log_(NULL),
       seed_(0),
       tmp_batch_(new WriteBatch),
       bg_compaction_scheduled_(false),
-      manual_compaction_(NULL) {
+      prewarm_next_(0),
+      prewarm_done_(0),
+      prewarm_threads_(0),
+      prewarm_data_bytes_(0),
+      manual_compaction_(NULL),
+      write_controller_(options_.delayed_write_rate),
+      stall_condition_(kStallNormal) {
   has_imm_.Release_Store(NULL);
+  has_pending_events_.Release_Store(NULL);
 
-  // Reserve ten files or so for other uses and give the rest to TableCache.
+  // Reserve ten files or so for other uses and give the rest to the
+  // TableCaches of the column families.
   const int table_cache_size = options_.max_open_files - kNumNonTableCacheFiles;
-  table_cache_ = new TableCache(dbname_, &options_, table_cache_size);
-
-  versions_ = new VersionSet(dbname_, &options_, table_cache_,
-                             &internal_comparator_);
+  table_cache_ = NewLRUCache(table_cache_size);
+
+  default_cf_ = new ColumnFamilyData(0, kDefaultColumnFamilyName, dbname_,
+                                     options_, raw_options, table_cache_,
+                                     &dropped_dirs_);
+  default_cf_->Ref();
+  column_families_[0] = default_cf_;
+  versions_ = default_cf_->versions;
+  MutexLock l(&mutex_);
+  default_handle_ = new ColumnFamilyHandleImpl(default_cf_, this, &mutex_);
 }
 
 DBImpl::~DBImpl() {
   // Wait for background work to finish
   mutex_.Lock();
   shutting_down_.Release_Store(this);  // Any non-NULL value is ok
-  while (bg_compaction_scheduled_) {
+  while (bg_compaction_scheduled_ || prewarm_threads_ > 0) {
     bg_cv_.Wait();
   }
   mutex_.Unlock();
@@ -158,9 +181,15 @@ DBImpl::~DBImpl() {
     env_->UnlockFile(db_lock_);
   }
 
-  delete versions_;
-  if (mem_ != NULL) mem_->Unref();
-  if (imm_ != NULL) imm_->Unref();
+  delete default_handle_;
+  mutex_.Lock();
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    it->second->Unref();
+  }
+  column_families_.clear();
+  mutex_.Unlock();
+  DeleteDroppedColumnFamilyDirs();
   delete tmp_batch_;
   delete log_;
   delete logfile_;
@@ -174,14 +203,16 @@ DBImpl::~DBImpl() {
   }
 }
 
-Status DBImpl::NewDB() {
+Status DBImpl::NewDB(const std::string& dir,
+                     const Comparator* user_comparator,
+                     uint64_t log_number) {
   VersionEdit new_db;
-  new_db.SetComparatorName(user_comparator()->Name());
-  new_db.SetLogNumber(0);
-  new_db.SetNextFile(2);
+  new_db.SetComparatorName(user_comparator->Name());
+  new_db.SetLogNumber(log_number);
+  new_db.SetNextFile(std::max<uint64_t>(log_number + 1, 2));
   new_db.SetLastSequence(0);
 
-  const std::string manifest = DescriptorFileName(dbname_, 1);
+  const std::string manifest = DescriptorFileName(dir, 1);
   WritableFile* file;
   Status s = env_->NewWritableFile(manifest, &file);
   if (!s.ok()) {
@@ -199,7 +230,7 @@ Status DBImpl::NewDB() {
   delete file;
   if (s.ok()) {
     // Make "CURRENT" file that points to the new manifest file.
-    s = SetCurrentFile(env_, dbname_, 1);
+    s = SetCurrentFile(env_, dir, 1);
   } else {
     env_->DeleteFile(manifest);
   }
@@ -222,12 +253,37 @@ void DBImpl::DeleteObsoleteFiles() {
     return;
   }
 
+  // A log is needed as long as some column family has updates in it that
+  // are not in a table file yet.  Those updates are in the logs starting
+  // at the log number of the column family.
+  uint64_t min_log = logfile_number_;
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    ColumnFamilyData* cfd = it->second;
+    if (cfd->imm != NULL || (cfd->mem != NULL && !cfd->mem->IsEmpty())) {
+      min_log = std::min(min_log, cfd->versions->LogNumber());
+    }
+  }
+
+  std::vector<TableFileDeletionInfo> deleted_tables;
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    DeleteObsoleteFiles(it->second, min_log, &deleted_tables);
+  }
+  if (!deleted_tables.empty()) {
+    NotifyOnTableFilesDeleted(deleted_tables);
+  }
+}
+
+void DBImpl::DeleteObsoleteFiles(ColumnFamilyData* cfd, uint64_t min_log,
+                                 std::vector<TableFileDeletionInfo>* deleted) {
+  mutex_.AssertHeld();
   // Make a set of all of the live files
-  std::set<uint64_t> live = pending_outputs_;
-  versions_->AddLiveFiles(&live);
+  std::set<uint64_t> live = cfd->pending_outputs;
+  cfd->versions->AddLiveFiles(&live);
 
   std::vector<std::string> filenames;
-  env_->GetChildren(dbname_, &filenames); // Ignoring errors on purpose
+  env_->GetChildren(cfd->dir, &filenames); // Ignoring errors on purpose
   uint64_t number;
   FileType type;
   for (size_t i = 0; i < filenames.size(); i++) {
@@ -235,20 +291,20 @@ void DBImpl::DeleteObsoleteFiles() {
       bool keep = true;
       switch (type) {
         case kLogFile:
-          keep = ((number >= versions_->LogNumber()) ||
+          keep = ((number >= min_log) ||
                   (number == versions_->PrevLogNumber()));
           break;
         case kDescriptorFile:
           // Keep my manifest file, and any newer incarnations'
           // (in case there is a race that allows other incarnations)
-          keep = (number >= versions_->ManifestFileNumber());
+          keep = (number >= cfd->versions->ManifestFileNumber());
           break;
         case kTableFile:
           keep = (live.find(number) != live.end());
           break;
         case kTempFile:
           // Any temp files that are currently being written to must
-          // be recorded in pending_outputs_, which is inserted into "live"
+          // be recorded in pending_outputs, which is inserted into "live"
           keep = (live.find(number) != live.end());
           break;
         case kCurrentFile:
@@ -260,18 +316,65 @@ void DBImpl::DeleteObsoleteFiles() {
 
       if (!keep) {
         if (type == kTableFile) {
-          table_cache_->Evict(number);
+          cfd->table_cache->Evict(number);
         }
-        Log(options_.info_log, "Delete type=%d #%lld\n",
+        Log(options_.info_log, "Delete type=%d #%lld in %s\n",
             int(type),
-            static_cast<unsigned long long>(number));
-        env_->DeleteFile(dbname_ + "/" + filenames[i]);
+            static_cast<unsigned long long>(number),
+            cfd->name.c_str());
+        const std::string fname = cfd->dir + "/" + filenames[i];
+        Status s = env_->DeleteFile(fname);
+        if (type == kTableFile && !options_.listeners.empty()) {
+          TableFileDeletionInfo info;
+          info.db_name = dbname_;
+          info.file_path = fname;
+          info.file_number = number;
+          info.status = s;
+          deleted->push_back(info);
+        }
       }
     }
   }
 }
 
-Status DBImpl::Recover(VersionEdit* edit, bool *save_manifest) {
+// Routes the updates read from a log file to the memtables of the column
+// families whose data in that log is not in a table file yet, creating
+// the memtables on demand.
+class DBImpl::RecoveryMemTables
+    : public WriteBatchInternal::ColumnFamilyMemTables {
+ public:
+  RecoveryMemTables(DBImpl* db, uint64_t log_number)
+      : db_(db), log_number_(log_number) { }
+
+  virtual MemTable* GetMemTable(uint32_t id) {
+    ColumnFamilyMap::iterator it = db_->column_families_.find(id);
+    if (it == db_->column_families_.end()) {
+      // The column family has been dropped
+      return NULL;
+    }
+    ColumnFamilyData* cfd = it->second;
+    if (log_number_ < cfd->versions->LogNumber() &&
+        !(cfd == db_->default_cf_ &&
+          log_number_ == cfd->versions->PrevLogNumber())) {
+      // The updates are already in a table file
+      return NULL;
+    }
+    if (cfd->mem == NULL) {
+      cfd->mem = new MemTable(cfd->internal_comparator,
+                              db_->options_.inplace_update_support);
+      cfd->mem->Ref();
+    }
+    return cfd->mem;
+  }
+
+ private:
+  DBImpl* const db_;
+  const uint64_t log_number_;
+};
+
+Status DBImpl::Recover(
+    const std::vector<ColumnFamilyDescriptor>& column_families,
+    std::map<uint32_t, VersionEdit>* edits, bool *save_manifest) {
   mutex_.AssertHeld();
 
   // Ignore error from CreateDir since the creation of the DB is
@@ -286,7 +389,7 @@ Status DBImpl::Recover(VersionEdit* edit, bool *save_manifest) {
 
   if (!env_->FileExists(CurrentFileName(dbname_))) {
     if (options_.create_if_missing) {
-      s = NewDB();
+      s = NewDB(dbname_, user_comparator(), 0);
       if (!s.ok()) {
         return s;
       }
@@ -305,55 +408,125 @@ Status DBImpl::Recover(VersionEdit* edit, bool *save_manifest) {
   if (!s.ok()) {
     return s;
   }
+
+  // Open the other column families.  Every one of them must be described
+  // by the caller since its options are not persisted.
+  const std::map<uint32_t, std::string>& registered =
+      versions_->ColumnFamilies();
+  for (size_t i = 0; i < column_families.size(); i++) {
+    const std::string& name = column_families[i].name;
+    bool found = (name == kDefaultColumnFamilyName);
+    for (std::map<uint32_t, std::string>::const_iterator it =
+             registered.begin();
+         !found && it != registered.end(); ++it) {
+      found = (it->second == name);
+    }
+    if (!found) {
+      return Status::InvalidArgument(name, "column family does not exist");
+    }
+  }
   SequenceNumber max_sequence(0);
+  for (std::map<uint32_t, std::string>::const_iterator it =
+           registered.begin();
+       it != registered.end(); ++it) {
+    const ColumnFamilyDescriptor* desc = NULL;
+    for (size_t i = 0; desc == NULL && i < column_families.size(); i++) {
+      if (column_families[i].name == it->second) {
+        desc = &column_families[i];
+      }
+    }
+    if (desc == NULL) {
+      return Status::InvalidArgument(it->second,
+                                     "column family must be opened");
+    }
+    ColumnFamilyData* cfd = new ColumnFamilyData(
+        it->first, it->second, ColumnFamilyDirName(dbname_, it->first),
+        options_, desc->options, table_cache_, &dropped_dirs_);
+    cfd->Ref();
+    column_families_[cfd->id] = cfd;
+    bool ignored;
+    s = cfd->versions->Recover(&ignored);
+    if (!s.ok()) {
+      return s;
+    }
+    max_sequence = std::max(max_sequence, cfd->versions->LastSequence());
+  }
 
   // Recover from all newer log files than the ones named in the
-  // descriptor (new log files may have been added by the previous
-  // incarnation without registering them in the descriptor).
+  // descriptors (new log files may have been added by the previous
+  // incarnation without registering them in the descriptor).  Every
+  // column family skips the logs older than the one named in its own
+  // descriptor.
   //
   // Note that PrevLogNumber() is no longer used, but we pay
   // attention to it in case we are recovering a database
   // produced by an older version of leveldb.
-  const uint64_t min_log = versions_->LogNumber();
-  const uint64_t prev_log = versions_->PrevLogNumber();
-  std::vector<std::string> filenames;
-  s = env_->GetChildren(dbname_, &filenames);
-  if (!s.ok()) {
-    return s;
+  uint64_t min_log = versions_->LogNumber();
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    min_log = std::min(min_log, it->second->versions->LogNumber());
   }
-  std::set<uint64_t> expected;
-  versions_->AddLiveFiles(&expected);
-  uint64_t number;
-  FileType type;
+  const uint64_t prev_log = versions_->PrevLogNumber();
   std::vector<uint64_t> logs;
-  for (size_t i = 0; i < filenames.size(); i++) {
-    if (ParseFileName(filenames[i], &number, &type)) {
-      expected.erase(number);
-      if (type == kLogFile && ((number >= min_log) || (number == prev_log)))
-        logs.push_back(number);
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    ColumnFamilyData* cfd = it->second;
+    std::vector<std::string> filenames;
+    s = env_->GetChildren(cfd->dir, &filenames);
+    if (!s.ok()) {
+      return s;
+    }
+    std::set<uint64_t> expected;
+    cfd->versions->AddLiveFiles(&expected);
+    uint64_t number;
+    FileType type;
+    uint32_t id;
+    for (size_t i = 0; i < filenames.size(); i++) {
+      if (ParseFileName(filenames[i], &number, &type)) {
+        expected.erase(number);
+        if (cfd == default_cf_ && type == kLogFile &&
+            ((number >= min_log) || (number == prev_log)))
+          logs.push_back(number);
+      } else if (cfd == default_cf_ &&
+                 ParseColumnFamilyDirName(filenames[i], &id) &&
+                 registered.count(id) == 0) {
+        // Left behind by a dropped column family, or by one whose
+        // creation did not complete.
+        Log(options_.info_log, "Delete column family directory %s\n",
+            filenames[i].c_str());
+        DestroyColumnFamilyDir(env_, dbname_ + "/" + filenames[i]);
+      }
+    }
+    if (!expected.empty()) {
+      char buf[50];
+      snprintf(buf, sizeof(buf), "%d missing files; e.g.",
+               static_cast<int>(expected.size()));
+      return Status::Corruption(buf,
+                                TableFileName(cfd->dir, *(expected.begin())));
     }
-  }
-  if (!expected.empty()) {
-    char buf[50];
-    snprintf(buf, sizeof(buf), "%d missing files; e.g.",
-             static_cast<int>(expected.size()));
-    return Status::Corruption(buf, TableFileName(dbname_, *(expected.begin())));
   }
 
-  // Recover in the order in which the logs were generated
+  // Recover in the order in which the logs were generated.  The tables
+  // written for the memtables of one log may still be in progress while
+  // the next log is read.
   std::sort(logs.begin(), logs.end());
-  for (size_t i = 0; i < logs.size(); i++) {
-    s = RecoverLogFile(logs[i], (i == logs.size() - 1), save_manifest, edit,
-                       &max_sequence);
-    if (!s.ok()) {
-      return s;
-    }
+  std::vector<RecoveryFlush*> flushes;
+  for (size_t i = 0; s.ok() && i < logs.size(); i++) {
+    s = RecoverLogFile(logs[i], (i == logs.size() - 1), save_manifest, edits,
+                       &max_sequence, &flushes);
 
     // The previous incarnation may not have written any MANIFEST
     // records after allocating this log number.  So we manually
     // update the file number allocation counter in VersionSet.
     versions_->MarkFileNumberUsed(logs[i]);
   }
+  Status flush_status = FinishRecoveryFlushes(&flushes, 0, edits);
+  if (s.ok()) {
+    s = flush_status;
+  }
+  if (!s.ok()) {
+    return s;
+  }
 
   if (versions_->LastSequence() < max_sequence) {
     versions_->SetLastSequence(max_sequence);
@@ -362,22 +535,241 @@ Status DBImpl::Recover(VersionEdit* edit, bool *save_manifest) {
   return Status::OK();
 }
 
-Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
-                              bool* save_manifest, VersionEdit* edit,
-                              SequenceNumber* max_sequence) {
-  struct LogReporter : public log::Reader::Reporter {
-    Env* env;
-    Logger* info_log;
-    const char* fname;
-    Status* status;  // NULL if options_.paranoid_checks==false
-    virtual void Corruption(size_t bytes, const Status& s) {
-      Log(info_log, "%s%s: dropping %d bytes; %s",
-          (this->status == NULL ? "(ignoring error) " : ""),
-          fname, static_cast<int>(bytes), s.ToString().c_str());
-      if (this->status != NULL && this->status->ok()) *this->status = s;
+namespace {
+
+struct LogReporter : public log::Reader::Reporter {
+  Logger* info_log;
+  const char* fname;
+  Status* status;  // NULL if options_.paranoid_checks==false
+  virtual void Corruption(size_t bytes, const Status& s) {
+    Log(info_log, "%s%s: dropping %d bytes; %s",
+        (this->status == NULL ? "(ignoring error) " : ""),
+        fname, static_cast<int>(bytes), s.ToString().c_str());
+    if (this->status != NULL && this->status->ok()) *this->status = s;
+  }
+};
+
+// Reads the records of a log file in a thread of its own, so that reading
+// and checksumming the log overlaps with inserting the records into the
+// memtables.  Records are handed over in chunks of about kChunkBytes, and
+// at most kMaxChunks chunks are read ahead of the consumer.
+class LogPrefetcher {
+ public:
+  LogPrefetcher(Env* env, SequentialFile* file, Logger* info_log,
+                const std::string& fname, bool paranoid_checks)
+      : env_(env),
+        file_(file),
+        info_log_(info_log),
+        fname_(fname),
+        paranoid_checks_(paranoid_checks),
+        cv_(&mu_),
+        stop_(false),
+        done_(false) {
+  }
+
+  // Stops the reading thread and waits for it to exit.
+  ~LogPrefetcher() {
+    MutexLock l(&mu_);
+    stop_ = true;
+    cv_.SignalAll();
+    while (!done_) {
+      cv_.Wait();
     }
-  };
+    for (size_t i = 0; i < chunks_.size(); i++) {
+      delete chunks_[i];
+    }
+  }
+
+  void Start() {
+    env_->StartThread(&LogPrefetcher::ReadThread, this);
+  }
+
+  // Replace the contents of *records with the next records of the log.
+  // Returns false once all records have been returned.
+  bool NextChunk(std::vector<std::string>* records) {
+    MutexLock l(&mu_);
+    while (chunks_.empty() && !done_) {
+      cv_.Wait();
+    }
+    if (chunks_.empty()) {
+      return false;
+    }
+    std::vector<std::string>* chunk = chunks_.front();
+    chunks_.pop_front();
+    records->swap(*chunk);
+    delete chunk;
+    cv_.SignalAll();
+    return true;
+  }
+
+  // The first corruption found while paranoid_checks is set.
+  // REQUIRES: NextChunk() has returned false
+  Status status() {
+    MutexLock l(&mu_);
+    return status_;
+  }
+
+ private:
+  static const size_t kChunkBytes = 1 << 20;
+  static const size_t kMaxChunks = 8;
+
+  static void ReadThread(void* arg) {
+    reinterpret_cast<LogPrefetcher*>(arg)->ReadAll();
+  }
+
+  void ReadAll() {
+    Status status;
+    LogReporter reporter;
+    reporter.info_log = info_log_;
+    reporter.fname = fname_.c_str();
+    reporter.status = (paranoid_checks_ ? &status : NULL);
+    // We intentionally make log::Reader do checksumming even if
+    // paranoid_checks==false so that corruptions cause entire commits
+    // to be skipped instead of propagating bad information (like overly
+    // large sequence numbers).
+    log::Reader reader(file_, &reporter, true/*checksum*/,
+                       0/*initial_offset*/);
+    std::string scratch;
+    Slice record;
+    std::vector<std::string>* chunk = new std::vector<std::string>;
+    size_t chunk_bytes = 0;
+    bool stopped = false;
+    while (!stopped && reader.ReadRecord(&record, &scratch) && status.ok()) {
+      if (record.size() < 12) {
+        reporter.Corruption(
+            record.size(), Status::Corruption("log record too small"));
+        continue;
+      }
+      chunk->push_back(record.ToString());
+      chunk_bytes += record.size();
+      if (chunk_bytes >= kChunkBytes) {
+        stopped = !Deliver(chunk);
+        chunk = new std::vector<std::string>;
+        chunk_bytes = 0;
+      }
+    }
+    if (!stopped && !chunk->empty()) {
+      Deliver(chunk);
+    } else {
+      delete chunk;
+    }
+
+    MutexLock l(&mu_);
+    status_ = status;
+    done_ = true;
+    cv_.SignalAll();
+  }
+
+  // Hand "chunk" over to the consumer, waiting while it is too far behind.
+  // Returns false, after deleting "chunk", if the consumer has stopped.
+  bool Deliver(std::vector<std::string>* chunk) {
+    MutexLock l(&mu_);
+    while (chunks_.size() >= kMaxChunks && !stop_) {
+      cv_.Wait();
+    }
+    if (stop_) {
+      delete chunk;
+      return false;
+    }
+    chunks_.push_back(chunk);
+    cv_.SignalAll();
+    return true;
+  }
+
+  Env* const env_;
+  SequentialFile* const file_;
+  Logger* const info_log_;
+  const std::string fname_;
+  const bool paranoid_checks_;
+
+  port::Mutex mu_;
+  port::CondVar cv_;
+  std::deque<std::vector<std::string>*> chunks_;
+  bool stop_;   // The consumer does not want any more records
+  bool done_;   // The reading thread has exited
+  Status status_;
+};
+
+// At most this many memtables are written to level-0 tables at the same
+// time while logs are recovered.
+static const size_t kMaxRecoveryFlushes = 4;
+
+}  // namespace
+
+// A memtable filled during recovery that is being written to a level-0
+// table in a thread of its own.
+struct DBImpl::RecoveryFlush {
+  DBImpl* db;
+  ColumnFamilyData* cfd;
+  MemTable* mem;
+  FileMetaData meta;
+  uint64_t start_micros;
+  Status status;
+  bool done;
+};
+
+void DBImpl::RecoveryFlushWork(void* arg) {
+  RecoveryFlush* flush = reinterpret_cast<RecoveryFlush*>(arg);
+  DBImpl* db = flush->db;
+  Status s = db->BuildLevel0Table(flush->cfd, flush->mem, &flush->meta);
+  MutexLock l(&db->mutex_);
+  flush->status = s;
+  flush->done = true;
+  db->bg_cv_.SignalAll();
+}
 
+void DBImpl::StartRecoveryFlush(ColumnFamilyData* cfd,
+                                std::vector<RecoveryFlush*>* flushes) {
+  mutex_.AssertHeld();
+  RecoveryFlush* flush = new RecoveryFlush;
+  flush->db = this;
+  flush->cfd = cfd;
+  flush->mem = cfd->mem;  // Takes over the reference
+  flush->meta.number = cfd->versions->NewFileNumber();
+  flush->start_micros = env_->NowMicros();
+  flush->done = false;
+  cfd->pending_outputs.insert(flush->meta.number);
+  cfd->mem = NULL;
+  flushes->push_back(flush);
+  env_->StartThread(&DBImpl::RecoveryFlushWork, flush);
+}
+
+Status DBImpl::FinishRecoveryFlushes(std::vector<RecoveryFlush*>* flushes,
+                                     size_t max_running,
+                                     std::map<uint32_t, VersionEdit>* edits) {
+  mutex_.AssertHeld();
+  Status result;
+  while (true) {
+    size_t running = 0;
+    for (size_t i = 0; i < flushes->size(); ) {
+      RecoveryFlush* flush = (*flushes)[i];
+      if (!flush->done) {
+        running++;
+        i++;
+        continue;
+      }
+      Status s = FinishLevel0Table(flush->cfd, flush->meta, flush->status,
+                                   flush->start_micros,
+                                   &(*edits)[flush->cfd->id], NULL, NULL);
+      if (result.ok()) {
+        result = s;
+      }
+      flush->mem->Unref();
+      delete flush;
+      flushes->erase(flushes->begin() + i);
+    }
+    if (running <= max_running) {
+      return result;
+    }
+    bg_cv_.Wait();
+  }
+}
+
+Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
+                              bool* save_manifest,
+                              std::map<uint32_t, VersionEdit>* edits,
+                              SequenceNumber* max_sequence,
+                              std::vector<RecoveryFlush*>* flushes) {
   mutex_.AssertHeld();
 
   // Open the log file
@@ -389,127 +781,150 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     return status;
   }
 
-  // Create the log reader.
-  LogReporter reporter;
-  reporter.env = env_;
-  reporter.info_log = options_.info_log;
-  reporter.fname = fname.c_str();
-  reporter.status = (options_.paranoid_checks ? &status : NULL);
-  // We intentionally make log::Reader do checksumming even if
-  // paranoid_checks==false so that corruptions cause entire commits
-  // to be skipped instead of propagating bad information (like overly
-  // large sequence numbers).
-  log::Reader reader(file, &reporter, true/*checksum*/,
-                     0/*initial_offset*/);
   Log(options_.info_log, "Recovering log #%llu",
       (unsigned long long) log_number);
 
-  // Read all the records and add to a memtable
-  std::string scratch;
-  Slice record;
+  // Read all the records and add to the memtables.  Memtables that fill
+  // up are written to tables in the background while the log is read.
+  std::vector<std::string> records;
   WriteBatch batch;
   int compactions = 0;
-  MemTable* mem = NULL;
-  while (reader.ReadRecord(&record, &scratch) &&
-         status.ok()) {
-    if (record.size() < 12) {
-      reporter.Corruption(
-          record.size(), Status::Corruption("log record too small"));
-      continue;
-    }
-    WriteBatchInternal::SetContents(&batch, record);
-
-    if (mem == NULL) {
-      mem = new MemTable(internal_comparator_);
-      mem->Ref();
-    }
-    status = WriteBatchInternal::InsertInto(&batch, mem);
-    MaybeIgnoreError(&status);
-    if (!status.ok()) {
-      break;
-    }
-    const SequenceNumber last_seq =
-        WriteBatchInternal::Sequence(&batch) +
-        WriteBatchInternal::Count(&batch) - 1;
-    if (last_seq > *max_sequence) {
-      *max_sequence = last_seq;
-    }
+  RecoveryMemTables memtables(this, log_number);
+  {
+    LogPrefetcher prefetcher(env_, file, options_.info_log, fname,
+                             options_.paranoid_checks);
+    prefetcher.Start();
+    while (status.ok() && prefetcher.NextChunk(&records)) {
+      for (size_t r = 0; status.ok() && r < records.size(); r++) {
+        WriteBatchInternal::SetContents(&batch, records[r]);
+
+        if (options_.inplace_update_support) {
+          // No snapshots exist during recovery
+          status = WriteBatchInternal::InsertInto(&batch, &memtables, 0);
+        } else {
+          status = WriteBatchInternal::InsertInto(&batch, &memtables);
+        }
+        MaybeIgnoreError(&status);
+        if (!status.ok()) {
+          break;
+        }
+        const SequenceNumber last_seq =
+            WriteBatchInternal::Sequence(&batch) +
+            WriteBatchInternal::Count(&batch) - 1;
+        if (last_seq > *max_sequence) {
+          *max_sequence = last_seq;
+        }
 
-    if (mem->ApproximateMemoryUsage() > options_.write_buffer_size) {
-      compactions++;
-      *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, NULL);
-      mem->Unref();
-      mem = NULL;
-      if (!status.ok()) {
-        // Reflect errors immediately so that conditions like full
-        // file-systems cause the DB::Open() to fail.
-        break;
+        for (ColumnFamilyMap::iterator it = column_families_.begin();
+             status.ok() && it != column_families_.end(); ++it) {
+          ColumnFamilyData* cfd = it->second;
+          if (cfd->mem != NULL &&
+              cfd->mem->ApproximateMemoryUsage() >
+                  cfd->options.write_buffer_size) {
+            compactions++;
+            *save_manifest = true;
+            // Reflect errors immediately so that conditions like full
+            // file-systems cause the DB::Open() to fail.
+            status = FinishRecoveryFlushes(flushes, kMaxRecoveryFlushes - 1,
+                                           edits);
+            if (status.ok()) {
+              StartRecoveryFlush(cfd, flushes);
+            }
+          }
+        }
       }
     }
+    if (status.ok()) {
+      status = prefetcher.status();
+    }
   }
 
   delete file;
 
-  // See if we should keep reusing the last log file.
-  if (status.ok() && options_.reuse_logs && last_log && compactions == 0) {
+  // See if we should keep reusing the last log file.  The log is only
+  // reused when there is a single column family.
+  if (status.ok() && options_.reuse_logs && last_log && compactions == 0 &&
+      column_families_.size() == 1) {
     assert(logfile_ == NULL);
     assert(log_ == NULL);
-    assert(mem_ == NULL);
     uint64_t lfile_size;
     if (env_->GetFileSize(fname, &lfile_size).ok() &&
         env_->NewAppendableFile(fname, &logfile_).ok()) {
       Log(options_.info_log, "Reusing old log %s \n", fname.c_str());
       log_ = new log::Writer(logfile_, lfile_size);
       logfile_number_ = log_number;
-      if (mem != NULL) {
-        mem_ = mem;
-        mem = NULL;
-      } else {
+      if (default_cf_->mem == NULL) {
         // mem can be NULL if lognum exists but was empty.
-        mem_ = new MemTable(internal_comparator_);
-        mem_->Ref();
+        default_cf_->mem = new MemTable(default_cf_->internal_comparator,
+                                        options_.inplace_update_support);
+        default_cf_->mem->Ref();
       }
+      return status;
     }
   }
 
-  if (mem != NULL) {
-    // mem did not get reused; compact it.
-    if (status.ok()) {
-      *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, NULL);
+  // The memtables did not get reused; compact them.
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    ColumnFamilyData* cfd = it->second;
+    if (cfd->mem != NULL) {
+      if (status.ok()) {
+        *save_manifest = true;
+        status = FinishRecoveryFlushes(flushes, kMaxRecoveryFlushes - 1,
+                                       edits);
+      }
+      if (status.ok()) {
+        StartRecoveryFlush(cfd, flushes);
+      } else {
+        cfd->mem->Unref();
+        cfd->mem = NULL;
+      }
     }
-    mem->Unref();
   }
 
   return status;
 }
 
-Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
-                                Version* base) {
+Status DBImpl::BuildLevel0Table(ColumnFamilyData* cfd, MemTable* mem,
+                                FileMetaData* meta) {
+  Iterator* iter = mem->NewIterator();
+  Log(options_.info_log, "Level-0 table #%llu in %s: started",
+      (unsigned long long) meta->number, cfd->name.c_str());
+  Status s = BuildTable(cfd->dir, env_, cfd->options, cfd->table_cache, iter,
+                        meta);
+  Log(options_.info_log, "Level-0 table #%llu in %s: %lld bytes %s",
+      (unsigned long long) meta->number,
+      cfd->name.c_str(),
+      (unsigned long long) meta->file_size,
+      s.ToString().c_str());
+  delete iter;
+  return s;
+}
+
+Status DBImpl::WriteLevel0Table(ColumnFamilyData* cfd, MemTable* mem,
+                                VersionEdit* edit, Version* base,
+                                FlushJobInfo* info) {
   mutex_.AssertHeld();
   const uint64_t start_micros = env_->NowMicros();
   FileMetaData meta;
-  meta.number = versions_->NewFileNumber();
-  pending_outputs_.insert(meta.number);
-  Iterator* iter = mem->NewIterator();
-  Log(options_.info_log, "Level-0 table #%llu: started",
-      (unsigned long long) meta.number);
+  meta.number = cfd->versions->NewFileNumber();
+  cfd->pending_outputs.insert(meta.number);
 
   Status s;
   {
     mutex_.Unlock();
-    s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    s = BuildLevel0Table(cfd, mem, &meta);
     mutex_.Lock();
   }
+  return FinishLevel0Table(cfd, meta, s, start_micros, edit, base, info);
+}
 
-  Log(options_.info_log, "Level-0 table #%llu: %lld bytes %s",
-      (unsigned long long) meta.number,
-      (unsigned long long) meta.file_size,
-      s.ToString().c_str());
-  delete iter;
-  pending_outputs_.erase(meta.number);
-
+Status DBImpl::FinishLevel0Table(ColumnFamilyData* cfd,
+                                 const FileMetaData& meta, const Status& s,
+                                 uint64_t start_micros, VersionEdit* edit,
+                                 Version* base, FlushJobInfo* info) {
+  mutex_.AssertHeld();
+  cfd->pending_outputs.erase(meta.number);
 
   // Note that if file_size is zero, the file has been deleted and
   // should not be added to the manifest.
@@ -520,26 +935,38 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
     if (base != NULL) {
       level = base->PickLevelForMemTableOutput(min_user_key, max_user_key);
     }
-    edit->AddFile(level, meta.number, meta.file_size,
-                  meta.smallest, meta.largest);
+    edit->AddFile(level, meta);
   }
 
   CompactionStats stats;
   stats.micros = env_->NowMicros() - start_micros;
   stats.bytes_written = meta.file_size;
-  stats_[level].Add(stats);
+  cfd->stats[level].Add(stats);
+  cfd->flushed_bytes += meta.file_size;
+  RecordTick(options_.statistics, kFlushWriteBytes, meta.file_size);
+  MeasureTime(options_.statistics, kFlushMicros, stats.micros);
+  if (info != NULL) {
+    info->db_name = dbname_;
+    info->column_family_name = cfd->name;
+    info->file_path = TableFileName(cfd->dir, meta.number);
+    info->file_number = meta.number;
+    info->file_size = meta.file_size;
+    info->level = level;
+    info->micros = stats.micros;
+  }
   return s;
 }
 
-void DBImpl::CompactMemTable() {
+void DBImpl::CompactMemTable(ColumnFamilyData* cfd) {
   mutex_.AssertHeld();
-  assert(imm_ != NULL);
+  assert(cfd->imm != NULL);
 
   // Save the contents of the memtable as a new Table
   VersionEdit edit;
-  Version* base = versions_->current();
+  FlushJobInfo info;
+  Version* base = cfd->versions->current();
   base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
+  Status s = WriteLevel0Table(cfd, cfd->imm, &edit, base, &info);
   base->Unref();
 
   if (s.ok() && shutting_down_.Acquire_Load()) {
@@ -550,25 +977,66 @@ void DBImpl::CompactMemTable() {
   if (s.ok()) {
     edit.SetPrevLogNumber(0);
     edit.SetLogNumber(logfile_number_);  // Earlier logs no longer needed
-    s = versions_->LogAndApply(&edit, &mutex_);
+    s = LogAndApply(cfd, &edit);
   }
 
   if (s.ok()) {
     // Commit to the new state
-    imm_->Unref();
-    imm_ = NULL;
-    has_imm_.Release_Store(NULL);
+    cfd->imm->Unref();
+    cfd->imm = NULL;
+    UpdateHasImm();
+    if (info.file_size > 0) {
+      NotifyOnFlushCompleted(info);
+    }
     DeleteObsoleteFiles();
   } else {
     RecordBackgroundError(s);
   }
 }
 
+ColumnFamilyData* DBImpl::PickMemTableToCompact() {
+  mutex_.AssertHeld();
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    if (it->second->imm != NULL) {
+      return it->second;
+    }
+  }
+  return NULL;
+}
+
+void DBImpl::UpdateHasImm() {
+  mutex_.AssertHeld();
+  has_imm_.Release_Store(PickMemTableToCompact());
+}
+
+Status DBImpl::LogAndApply(ColumnFamilyData* cfd, VersionEdit* edit) {
+  mutex_.AssertHeld();
+  if (cfd != default_cf_) {
+    // Sequence and log numbers are allocated by the default column
+    // family, but recorded in every descriptor.
+    cfd->versions->SetLastSequence(versions_->LastSequence());
+    cfd->versions->MarkFileNumberUsed(logfile_number_);
+  }
+  return cfd->versions->LogAndApply(edit, &mutex_);
+}
+
 void DBImpl::CompactRange(const Slice* begin, const Slice* end) {
+  CompactRange(default_handle_, begin, end);
+}
+
+void DBImpl::CompactRange(ColumnFamilyHandle* column_family,
+                          const Slice* begin, const Slice* end) {
+  ColumnFamilyData* cfd;
   int max_level_with_files = 1;
   {
     MutexLock l(&mutex_);
-    Version* base = versions_->current();
+    cfd = GetColumnFamily(column_family);
+    if (cfd == NULL) {
+      return;
+    }
+    cfd->Ref();
+    Version* base = cfd->versions->current();
     for (int level = 1; level < config::kNumLevels; level++) {
       if (base->OverlapInLevel(level, begin, end)) {
         max_level_with_files = level;
@@ -577,17 +1045,270 @@ void DBImpl::CompactRange(const Slice* begin, const Slice* end) {
   }
   TEST_CompactMemTable(); // TODO(sanjay): Skip if memtable does not overlap
   for (int level = 0; level < max_level_with_files; level++) {
-    TEST_CompactRange(level, begin, end);
+    ManualCompactRange(cfd, level, begin, end);
+  }
+  MutexLock l(&mutex_);
+  cfd->Unref();
+}
+
+// Copy the contents of the file "src" to the new file "target".
+static Status CopyFile(Env* env, const std::string& src,
+                       const std::string& target) {
+  SequentialFile* in;
+  Status s = env->NewSequentialFile(src, &in);
+  if (!s.ok()) {
+    return s;
+  }
+  WritableFile* out;
+  s = env->NewWritableFile(target, &out);
+  if (!s.ok()) {
+    delete in;
+    return s;
+  }
+  const size_t kBufferSize = 64 * 1024;
+  char* buffer = new char[kBufferSize];
+  while (true) {
+    Slice fragment;
+    s = in->Read(kBufferSize, &fragment, buffer);
+    if (!s.ok() || fragment.empty()) {
+      break;
+    }
+    s = out->Append(fragment);
+    if (!s.ok()) {
+      break;
+    }
+  }
+  if (s.ok()) {
+    s = out->Sync();
+  }
+  if (s.ok()) {
+    s = out->Close();
+  }
+  delete[] buffer;
+  delete out;
+  delete in;
+  return s;
+}
+
+Status DBImpl::CreateCheckpoint(const std::string& checkpoint_dir) {
+  if (env_->FileExists(checkpoint_dir)) {
+    return Status::InvalidArgument(checkpoint_dir, "exists");
+  }
+
+  // Move the memtable contents into table files so that the checkpoint
+  // consists of table files only and needs no log.
+  Status s = FlushMemTable();
+  if (!s.ok()) {
+    return s;
+  }
+
+  // Describe the current version of every column family in a fresh
+  // descriptor.  The versions are pinned so that their files are not
+  // deleted by compactions before they are linked.
+  struct Part {
+    ColumnFamilyData* cfd;
+    std::string dir;
+    Version* current;
+    std::set<uint64_t> live;
+    VersionEdit edit;
+    uint64_t manifest_number;
+  };
+  std::vector<Part*> parts;
+  {
+    MutexLock l(&mutex_);
+    for (ColumnFamilyMap::iterator it = column_families_.begin();
+         it != column_families_.end(); ++it) {
+      Part* part = new Part;
+      part->cfd = it->second;
+      part->cfd->Ref();
+      part->dir = (part->cfd == default_cf_)
+          ? checkpoint_dir : ColumnFamilyDirName(checkpoint_dir, it->first);
+      part->current = part->cfd->versions->current();
+      part->current->Ref();
+      part->current->AddLiveFiles(&part->live);
+      part->cfd->versions->AddCurrentState(&part->edit);
+      part->manifest_number = part->cfd->versions->NewFileNumber();
+      part->edit.SetLastSequence(versions_->LastSequence());
+      parts.push_back(part);
+    }
+  }
+
+  int num_files = 0;
+  for (size_t i = 0; s.ok() && i < parts.size(); i++) {
+    Part* part = parts[i];
+    VersionEdit* edit = &part->edit;
+    edit->SetLogNumber(0);
+    edit->SetPrevLogNumber(0);
+    edit->SetNextFile(part->manifest_number + 1);
+
+    s = env_->CreateDir(part->dir);
+    for (std::set<uint64_t>::iterator it = part->live.begin();
+         s.ok() && it != part->live.end(); ++it) {
+      std::string src = TableFileName(part->cfd->dir, *it);
+      std::string target = TableFileName(part->dir, *it);
+      if (!env_->FileExists(src)) {
+        src = SSTTableFileName(part->cfd->dir, *it);
+        target = SSTTableFileName(part->dir, *it);
+      }
+      s = env_->LinkFile(src, target);
+      if (!s.ok()) {
+        // Hard links are not supported by the Env or the checkpoint is on
+        // another file system.
+        s = CopyFile(env_, src, target);
+      }
+      num_files++;
+    }
+
+    if (s.ok()) {
+      WritableFile* file;
+      s = env_->NewWritableFile(DescriptorFileName(part->dir,
+                                                   part->manifest_number),
+                                &file);
+      if (s.ok()) {
+        log::Writer log(file);
+        std::string record;
+        edit->EncodeTo(&record);
+        s = log.AddRecord(record);
+        if (s.ok()) {
+          s = file->Sync();
+        }
+        if (s.ok()) {
+          s = file->Close();
+        }
+        delete file;
+      }
+    }
+    if (s.ok()) {
+      s = SetCurrentFile(env_, part->dir, part->manifest_number);
+    }
+  }
+
+  {
+    MutexLock l(&mutex_);
+    for (size_t i = 0; i < parts.size(); i++) {
+      parts[i]->current->Unref();
+      parts[i]->cfd->Unref();
+      delete parts[i];
+    }
+  }
+
+  if (s.ok()) {
+    Log(options_.info_log, "Created checkpoint %s with %d files",
+        checkpoint_dir.c_str(), num_files);
+  } else {
+    Log(options_.info_log, "Checkpoint %s failed: %s",
+        checkpoint_dir.c_str(), s.ToString().c_str());
+    // Remove the partial checkpoint
+    std::vector<std::string> filenames;
+    env_->GetChildren(checkpoint_dir, &filenames);
+    uint32_t id;
+    for (size_t i = 0; i < filenames.size(); i++) {
+      if (ParseColumnFamilyDirName(filenames[i], &id)) {
+        DestroyColumnFamilyDir(env_, checkpoint_dir + "/" + filenames[i]);
+      } else if (filenames[i] != "." && filenames[i] != "..") {
+        env_->DeleteFile(checkpoint_dir + "/" + filenames[i]);
+      }
+    }
+    env_->DeleteDir(checkpoint_dir);
+  }
+  return s;
+}
+
+// Number of threads that open table files after DB::Open().  Opening a
+// table is dominated by reads of its footer, index and filter blocks, so
+// a few reads in flight hide most of the latency.
+static const int kNumPrewarmThreads = 4;
+
+void DBImpl::StartPrewarm() {
+  mutex_.AssertHeld();
+  // Open the files of the lower levels first: they are the smallest and
+  // hold the most recently written data.  Do not open more files than
+  // fit in the table cache, since they would just push each other out.
+  const size_t limit = options_.max_open_files - kNumNonTableCacheFiles;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    for (ColumnFamilyMap::iterator it = column_families_.begin();
+         it != column_families_.end(); ++it) {
+      ColumnFamilyData* cfd = it->second;
+      std::vector<FileMetaData*> files;
+      cfd->versions->current()->GetOverlappingInputs(level, NULL, NULL,
+                                                      &files);
+      for (size_t i = 0; i < files.size(); i++) {
+        if (prewarm_files_.size() >= limit) {
+          break;
+        }
+        PrewarmFile f;
+        f.cfd = cfd;
+        f.number = files[i]->number;
+        f.file_size = files[i]->file_size;
+        prewarm_files_.push_back(f);
+      }
+    }
+  }
+  if (prewarm_files_.empty()) {
+    return;
+  }
+
+  // Keep the files alive until the prewarming threads are done with them
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    ColumnFamilyData* cfd = it->second;
+    Version* v = cfd->versions->current();
+    cfd->Ref();
+    v->Ref();
+    prewarm_refs_.push_back(std::make_pair(cfd, v));
+  }
+  prewarm_data_bytes_ = options_.prewarm_data_bytes;
+  prewarm_threads_ = std::min<int>(kNumPrewarmThreads, prewarm_files_.size());
+  for (int i = 0; i < prewarm_threads_; i++) {
+    env_->StartThread(&DBImpl::PrewarmWork, this);
+  }
+}
+
+void DBImpl::PrewarmWork(void* arg) {
+  reinterpret_cast<DBImpl*>(arg)->Prewarm();
+}
+
+void DBImpl::Prewarm() {
+  MutexLock l(&mutex_);
+  while (prewarm_next_ < prewarm_files_.size() &&
+         !shutting_down_.Acquire_Load()) {
+    const PrewarmFile f = prewarm_files_[prewarm_next_++];
+    const uint64_t data_bytes = std::min(prewarm_data_bytes_, f.file_size);
+    prewarm_data_bytes_ -= data_bytes;
+    mutex_.Unlock();
+    Status s = f.cfd->table_cache->Prewarm(f.number, f.file_size, data_bytes);
+    if (!s.ok()) {
+      Log(options_.info_log, "Prewarming table #%llu: %s",
+          static_cast<unsigned long long>(f.number), s.ToString().c_str());
+    }
+    mutex_.Lock();
+    prewarm_done_++;
+  }
+
+  prewarm_threads_--;
+  if (prewarm_threads_ == 0) {
+    for (size_t i = 0; i < prewarm_refs_.size(); i++) {
+      prewarm_refs_[i].second->Unref();
+      prewarm_refs_[i].first->Unref();
+    }
+    prewarm_refs_.clear();
+    bg_cv_.SignalAll();
   }
 }
 
 void DBImpl::TEST_CompactRange(int level, const Slice* begin,const Slice* end) {
+  ManualCompactRange(default_cf_, level, begin, end);
+}
+
+void DBImpl::ManualCompactRange(ColumnFamilyData* cfd, int level,
+                                const Slice* begin, const Slice* end) {
   assert(level >= 0);
   assert(level + 1 < config::kNumLevels);
 
   InternalKey begin_storage, end_storage;
 
   ManualCompaction manual;
+  manual.cfd = cfd;
   manual.level = level;
   manual.done = false;
   if (begin == NULL) {
@@ -619,21 +1340,33 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,const Slice* end) {
 }
 
 Status DBImpl::TEST_CompactMemTable() {
+  return FlushMemTable();
+}
+
+Status DBImpl::FlushMemTable() {
   // NULL batch means just wait for earlier writes to be done
   Status s = Write(WriteOptions(), NULL);
   if (s.ok()) {
     // Wait until the compaction completes
     MutexLock l(&mutex_);
-    while (imm_ != NULL && bg_error_.ok()) {
+    while (PickMemTableToCompact() != NULL && bg_error_.ok()) {
       bg_cv_.Wait();
     }
-    if (imm_ != NULL) {
+    if (PickMemTableToCompact() != NULL) {
       s = bg_error_;
     }
   }
   return s;
 }
 
+Status DBImpl::TEST_WaitForCompactions() {
+  MutexLock l(&mutex_);
+  while (bg_compaction_scheduled_ && bg_error_.ok()) {
+    bg_cv_.Wait();
+  }
+  return bg_error_;
+}
+
 void DBImpl::RecordBackgroundError(const Status& s) {
   mutex_.AssertHeld();
   if (bg_error_.ok()) {
@@ -650,9 +1383,9 @@ void DBImpl::MaybeScheduleCompaction() {
     // DB is being deleted; no more background compactions
   } else if (!bg_error_.ok()) {
     // Already got an error; no more changes
-  } else if (imm_ == NULL &&
+  } else if (has_imm_.NoBarrier_Load() == NULL &&
              manual_compaction_ == NULL &&
-             !versions_->NeedsCompaction()) {
+             PickCompactionColumnFamily() == NULL) {
     // No work to be done
   } else {
     bg_compaction_scheduled_ = true;
@@ -675,6 +1408,12 @@ void DBImpl::BackgroundCall() {
     BackgroundCompaction();
   }
 
+  // Deliver the events of this call before ~DBImpl() may proceed
+  mutex_.Unlock();
+  DeliverEvents();
+  DeleteDroppedColumnFamilyDirs();
+  mutex_.Lock();
+
   bg_compaction_scheduled_ = false;
 
   // Previous compaction may have produced too many files in a level,
@@ -683,20 +1422,35 @@ void DBImpl::BackgroundCall() {
   bg_cv_.SignalAll();
 }
 
+ColumnFamilyData* DBImpl::PickCompactionColumnFamily() {
+  mutex_.AssertHeld();
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    if (it->second->versions->NeedsCompaction()) {
+      return it->second;
+    }
+  }
+  return NULL;
+}
+
 void DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
 
-  if (imm_ != NULL) {
-    CompactMemTable();
+  ColumnFamilyData* cfd = PickMemTableToCompact();
+  if (cfd != NULL) {
+    CompactMemTable(cfd);
     return;
   }
 
-  Compaction* c;
+  Compaction* c = NULL;
   bool is_manual = (manual_compaction_ != NULL);
   InternalKey manual_end;
   if (is_manual) {
     ManualCompaction* m = manual_compaction_;
-    c = versions_->CompactRange(m->level, m->begin, m->end);
+    cfd = m->cfd;
+    if (!cfd->dropped) {
+      c = cfd->versions->CompactRange(m->level, m->begin, m->end);
+    }
     m->done = (c == NULL);
     if (c != NULL) {
       manual_end = c->input(0, c->num_input_files(0) - 1)->largest;
@@ -708,7 +1462,10 @@ void DBImpl::BackgroundCompaction() {
         (m->end ? m->end->DebugString().c_str() : "(end)"),
         (m->done ? "(end)" : manual_end.DebugString().c_str()));
   } else {
-    c = versions_->PickCompaction();
+    cfd = PickCompactionColumnFamily();
+    if (cfd != NULL) {
+      c = cfd->versions->PickCompaction();
+    }
   }
 
   Status status;
@@ -719,21 +1476,21 @@ void DBImpl::BackgroundCompaction() {
     assert(c->num_input_files(0) == 1);
     FileMetaData* f = c->input(0, 0);
     c->edit()->DeleteFile(c->level(), f->number);
-    c->edit()->AddFile(c->level() + 1, f->number, f->file_size,
-                       f->smallest, f->largest);
-    status = versions_->LogAndApply(c->edit(), &mutex_);
+    c->edit()->AddFile(c->output_level(), *f);
+    status = LogAndApply(cfd, c->edit());
     if (!status.ok()) {
       RecordBackgroundError(status);
     }
     VersionSet::LevelSummaryStorage tmp;
-    Log(options_.info_log, "Moved #%lld to level-%d %lld bytes %s: %s\n",
+    Log(options_.info_log, "Moved #%lld in %s to level-%d %lld bytes %s: %s\n",
         static_cast<unsigned long long>(f->number),
-        c->level() + 1,
+        cfd->name.c_str(),
+        c->output_level(),
         static_cast<unsigned long long>(f->file_size),
         status.ToString().c_str(),
-        versions_->LevelSummary(&tmp));
+        cfd->versions->LevelSummary(&tmp));
   } else {
-    CompactionState* compact = new CompactionState(c);
+    CompactionState* compact = new CompactionState(cfd, c);
     status = DoCompactionWork(compact);
     if (!status.ok()) {
       RecordBackgroundError(status);
@@ -780,7 +1537,7 @@ void DBImpl::CleanupCompaction(CompactionState* compact) {
   delete compact->outfile;
   for (size_t i = 0; i < compact->outputs.size(); i++) {
     const CompactionState::Output& out = compact->outputs[i];
-    pending_outputs_.erase(out.number);
+    compact->cfd->pending_outputs.erase(out.number);
   }
   delete compact;
 }
@@ -791,21 +1548,32 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
   uint64_t file_number;
   {
     mutex_.Lock();
-    file_number = versions_->NewFileNumber();
-    pending_outputs_.insert(file_number);
+    file_number = compact->cfd->versions->NewFileNumber();
+    compact->cfd->pending_outputs.insert(file_number);
     CompactionState::Output out;
     out.number = file_number;
     out.smallest.Clear();
     out.largest.Clear();
+    out.num_entries = 0;
+    out.num_deletions = 0;
     compact->outputs.push_back(out);
     mutex_.Unlock();
   }
 
   // Make the output file
-  std::string fname = TableFileName(dbname_, file_number);
-  Status s = env_->NewWritableFile(fname, &compact->outfile);
+  const Options& options = compact->cfd->options;
+  std::string fname = TableFileName(compact->cfd->dir, file_number);
+  Status s;
+  if (options.use_direct_io_for_flush_and_compaction) {
+    s = env_->NewDirectWritableFile(fname, &compact->outfile);
+  } else {
+    s = env_->NewWritableFile(fname, &compact->outfile);
+  }
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    compact->outfile = NewRateLimitedWritableFile(compact->outfile,
+                                                  options_.rate_limiter,
+                                                  RateLimiter::kLowPriority);
+    compact->builder = new TableBuilder(options, compact->outfile);
   }
   return s;
 }
@@ -845,16 +1613,16 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
 
   if (s.ok() && current_entries > 0) {
     // Verify that the table is usable
-    Iterator* iter = table_cache_->NewIterator(ReadOptions(),
-                                               output_number,
-                                               current_bytes);
+    Iterator* iter = compact->cfd->table_cache->NewIterator(ReadOptions(),
+                                                            output_number,
+                                                            current_bytes);
     s = iter->status();
     delete iter;
     if (s.ok()) {
       Log(options_.info_log,
           "Generated table #%llu@%d: %lld keys, %lld bytes",
           (unsigned long long) output_number,
-          compact->compaction->level(),
+          compact->compaction->output_level(),
           (unsigned long long) current_entries,
           (unsigned long long) current_bytes);
     }
@@ -869,32 +1637,40 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
       compact->compaction->num_input_files(0),
       compact->compaction->level(),
       compact->compaction->num_input_files(1),
-      compact->compaction->level() + 1,
+      compact->compaction->output_level(),
       static_cast<long long>(compact->total_bytes));
 
   // Add compaction outputs
   compact->compaction->AddInputDeletions(compact->compaction->edit());
-  const int level = compact->compaction->level();
+  const int level = compact->compaction->output_level();
   for (size_t i = 0; i < compact->outputs.size(); i++) {
     const CompactionState::Output& out = compact->outputs[i];
-    compact->compaction->edit()->AddFile(
-        level + 1,
-        out.number, out.file_size, out.smallest, out.largest);
-  }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+    FileMetaData f;
+    f.number = out.number;
+    f.file_size = out.file_size;
+    f.smallest = out.smallest;
+    f.largest = out.largest;
+    f.num_entries = out.num_entries;
+    f.num_deletions = out.num_deletions;
+    compact->compaction->edit()->AddFile(level, f);
+  }
+  return LogAndApply(compact->cfd, compact->compaction->edit());
 }
 
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
   const uint64_t start_micros = env_->NowMicros();
-  int64_t imm_micros = 0;  // Micros spent doing imm_ compactions
+  int64_t imm_micros = 0;  // Micros spent doing imm compactions
+  ColumnFamilyData* const cfd = compact->cfd;
+  const Comparator* const ucmp = cfd->internal_comparator.user_comparator();
 
-  Log(options_.info_log,  "Compacting %d@%d + %d@%d files",
+  Log(options_.info_log,  "Compacting %d@%d + %d@%d files in %s",
       compact->compaction->num_input_files(0),
       compact->compaction->level(),
       compact->compaction->num_input_files(1),
-      compact->compaction->level() + 1);
+      compact->compaction->output_level(),
+      cfd->name.c_str());
 
-  assert(versions_->NumLevelFiles(compact->compaction->level()) > 0);
+  assert(cfd->versions->NumLevelFiles(compact->compaction->level()) > 0);
   assert(compact->builder == NULL);
   assert(compact->outfile == NULL);
   if (snapshots_.empty()) {
@@ -902,11 +1678,20 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   } else {
     compact->smallest_snapshot = snapshots_.oldest()->number_;
   }
+  CompactionJobInfo info;
+  if (!options_.listeners.empty()) {
+    FillCompactionJobInfo(compact, &info);
+  }
+
+  if (!options_.listeners.empty()) {
+    NotifyOnCompactionBegin(info);
+  }
 
   // Release mutex while we're actually doing the compaction work
   mutex_.Unlock();
+  DeliverEvents();
 
-  Iterator* input = versions_->MakeInputIterator(compact->compaction);
+  Iterator* input = cfd->versions->MakeInputIterator(compact->compaction);
   input->SeekToFirst();
   Status status;
   ParsedInternalKey ikey;
@@ -918,13 +1703,16 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     if (has_imm_.NoBarrier_Load() != NULL) {
       const uint64_t imm_start = env_->NowMicros();
       mutex_.Lock();
-      if (imm_ != NULL) {
-        CompactMemTable();
+      ColumnFamilyData* imm_cfd = PickMemTableToCompact();
+      if (imm_cfd != NULL) {
+        CompactMemTable(imm_cfd);
         bg_cv_.SignalAll();  // Wakeup MakeRoomForWrite() if necessary
       }
       mutex_.Unlock();
       imm_micros += (env_->NowMicros() - imm_start);
     }
+    // Deliver events such as write stalls while the compaction runs
+    DeliverEvents();
 
     Slice key = input->key();
     if (compact->compaction->ShouldStopBefore(key) &&
@@ -937,15 +1725,15 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
 
     // Handle key/value, add to state, etc.
     bool drop = false;
-    if (!ParseInternalKey(key, &ikey)) {
+    const bool parsed = ParseInternalKey(key, &ikey);
+    if (!parsed) {
       // Do not hide error keys
       current_user_key.clear();
       has_current_user_key = false;
       last_sequence_for_key = kMaxSequenceNumber;
     } else {
       if (!has_current_user_key ||
-          user_comparator()->Compare(ikey.user_key,
-                                     Slice(current_user_key)) != 0) {
+          ucmp->Compare(ikey.user_key, Slice(current_user_key)) != 0) {
         // First occurrence of this user key
         current_user_key.assign(ikey.user_key.data(), ikey.user_key.size());
         has_current_user_key = true;
@@ -993,6 +1781,10 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
       }
       compact->current_output()->largest.DecodeFrom(key);
       compact->builder->Add(key, input->value());
+      compact->current_output()->num_entries++;
+      if (parsed && ikey.type == kTypeDeletion) {
+        compact->current_output()->num_deletions++;
+      }
 
       // Close output file if it is big enough
       if (compact->builder->FileSize() >=
@@ -1021,7 +1813,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
 
   CompactionStats stats;
   stats.micros = env_->NowMicros() - start_micros - imm_micros;
-  for (int which = 0; which < 2; which++) {
+  for (int which = 0; which < compact->compaction->num_input_levels();
+       which++) {
     for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
       stats.bytes_read += compact->compaction->input(which, i)->file_size;
     }
@@ -1029,76 +1822,253 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   for (size_t i = 0; i < compact->outputs.size(); i++) {
     stats.bytes_written += compact->outputs[i].file_size;
   }
+  RecordTick(options_.statistics, kCompactReadBytes, stats.bytes_read);
+  RecordTick(options_.statistics, kCompactWriteBytes, stats.bytes_written);
+  MeasureTime(options_.statistics, kCompactionMicros, stats.micros);
+
+  mutex_.Lock();
+  cfd->stats[compact->compaction->output_level()].Add(stats);
+
+  if (status.ok()) {
+    status = InstallCompactionResults(compact);
+  }
+  if (!status.ok()) {
+    RecordBackgroundError(status);
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log,
+      "compacted to: %s", cfd->versions->LevelSummary(&tmp));
+
+  if (!options_.listeners.empty()) {
+    FillCompactionJobInfo(compact, &info);
+    info.bytes_read = stats.bytes_read;
+    info.bytes_written = stats.bytes_written;
+    info.micros = stats.micros;
+    info.status = status;
+    NotifyOnCompactionCompleted(info);
+  }
+  return status;
+}
+
+void DBImpl::FillCompactionJobInfo(CompactionState* compact,
+                                   CompactionJobInfo* info) const {
+  const Compaction* c = compact->compaction;
+  const std::string& dir = compact->cfd->dir;
+  info->db_name = dbname_;
+  info->column_family_name = compact->cfd->name;
+  info->level = c->level();
+  info->output_level = c->output_level();
+  info->input_files.clear();
+  for (int which = 0; which < c->num_input_levels(); which++) {
+    for (int i = 0; i < c->num_input_files(which); i++) {
+      info->input_files.push_back(
+          TableFileName(dir, c->input(which, i)->number));
+    }
+  }
+  info->output_files.clear();
+  for (size_t i = 0; i < compact->outputs.size(); i++) {
+    info->output_files.push_back(
+        TableFileName(dir, compact->outputs[i].number));
+  }
+  info->bytes_read = 0;
+  info->bytes_written = 0;
+  info->micros = 0;
+  info->status = Status::OK();
+}
+
+void DBImpl::NotifyOnFlushCompleted(const FlushJobInfo& info) {
+  mutex_.AssertHeld();
+  if (options_.listeners.empty()) {
+    return;
+  }
+  pending_events_.push_back(ListenerEvent());
+  pending_events_.back().type = ListenerEvent::kFlushCompleted;
+  pending_events_.back().flush = info;
+  has_pending_events_.Release_Store(this);
+}
+
+void DBImpl::NotifyOnCompactionBegin(const CompactionJobInfo& info) {
+  mutex_.AssertHeld();
+  if (options_.listeners.empty()) {
+    return;
+  }
+  pending_events_.push_back(ListenerEvent());
+  pending_events_.back().type = ListenerEvent::kCompactionBegin;
+  pending_events_.back().compaction = info;
+  has_pending_events_.Release_Store(this);
+}
+
+void DBImpl::NotifyOnCompactionCompleted(const CompactionJobInfo& info) {
+  mutex_.AssertHeld();
+  if (options_.listeners.empty()) {
+    return;
+  }
+  pending_events_.push_back(ListenerEvent());
+  pending_events_.back().type = ListenerEvent::kCompactionCompleted;
+  pending_events_.back().compaction = info;
+  has_pending_events_.Release_Store(this);
+}
+
+void DBImpl::NotifyOnStallConditionChanged(const WriteStallInfo& info) {
+  mutex_.AssertHeld();
+  if (options_.listeners.empty()) {
+    return;
+  }
+  pending_events_.push_back(ListenerEvent());
+  pending_events_.back().type = ListenerEvent::kStallConditionChanged;
+  pending_events_.back().stall = info;
+  has_pending_events_.Release_Store(this);
+}
+
+void DBImpl::NotifyOnTableFilesDeleted(
+    const std::vector<TableFileDeletionInfo>& infos) {
+  mutex_.AssertHeld();
+  if (options_.listeners.empty()) {
+    return;
+  }
+  for (size_t i = 0; i < infos.size(); i++) {
+    pending_events_.push_back(ListenerEvent());
+    pending_events_.back().type = ListenerEvent::kTableFileDeleted;
+    pending_events_.back().deletion = infos[i];
+  }
+  has_pending_events_.Release_Store(this);
+}
 
+void DBImpl::DeliverEvents() {
+  if (has_pending_events_.Acquire_Load() == NULL) {
+    return;
+  }
+  MutexLock l(&deliver_mutex_);
+  std::vector<ListenerEvent> events;
   mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
+  events.swap(pending_events_);
+  has_pending_events_.Release_Store(NULL);
+  mutex_.Unlock();
 
-  if (status.ok()) {
-    status = InstallCompactionResults(compact);
-  }
-  if (!status.ok()) {
-    RecordBackgroundError(status);
+  const std::vector<EventListener*>& listeners = options_.listeners;
+  for (size_t i = 0; i < events.size(); i++) {
+    const ListenerEvent& e = events[i];
+    for (size_t j = 0; j < listeners.size(); j++) {
+      switch (e.type) {
+        case ListenerEvent::kFlushCompleted:
+          listeners[j]->OnFlushCompleted(this, e.flush);
+          break;
+        case ListenerEvent::kCompactionBegin:
+          listeners[j]->OnCompactionBegin(this, e.compaction);
+          break;
+        case ListenerEvent::kCompactionCompleted:
+          listeners[j]->OnCompactionCompleted(this, e.compaction);
+          break;
+        case ListenerEvent::kStallConditionChanged:
+          listeners[j]->OnStallConditionChanged(this, e.stall);
+          break;
+        case ListenerEvent::kTableFileDeleted:
+          listeners[j]->OnTableFileDeleted(e.deletion);
+          break;
+      }
+    }
   }
-  VersionSet::LevelSummaryStorage tmp;
-  Log(options_.info_log,
-      "compacted to: %s", versions_->LevelSummary(&tmp));
-  return status;
 }
 
-namespace {
+// The state an internal iterator reads from.  The iterator holds a
+// reference to every part of it.
 struct IterState {
+  DBImpl* db;
   port::Mutex* mu;
+  ColumnFamilyData* cfd;
   Version* version;
   MemTable* mem;
   MemTable* imm;
 };
 
+namespace {
 static void CleanupIteratorState(void* arg1, void* arg2) {
   IterState* state = reinterpret_cast<IterState*>(arg1);
   state->mu->Lock();
   state->mem->Unref();
   if (state->imm != NULL) state->imm->Unref();
   state->version->Unref();
+  const bool delete_dir = (state->cfd->dropped && state->cfd->refs == 1);
+  state->cfd->Unref();
   state->mu->Unlock();
+  if (delete_dir) {
+    state->db->DeleteDroppedColumnFamilyDirs();
+  }
   delete state;
 }
 }  // namespace
 
 Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
+                                      ColumnFamilyData* cfd,
                                       SequenceNumber* latest_snapshot,
-                                      uint32_t* seed) {
+                                      uint32_t* seed,
+                                      IterState** state) {
+  mutex_.AssertHeld();
   IterState* cleanup = new IterState;
-  mutex_.Lock();
   *latest_snapshot = versions_->LastSequence();
 
   // Collect together all needed child iterators
   std::vector<Iterator*> list;
-  list.push_back(mem_->NewIterator());
-  mem_->Ref();
-  if (imm_ != NULL) {
-    list.push_back(imm_->NewIterator());
-    imm_->Ref();
-  }
-  versions_->current()->AddIterators(options, &list);
+  list.push_back(cfd->mem->NewIterator());
+  cfd->mem->Ref();
+  if (cfd->imm != NULL) {
+    list.push_back(cfd->imm->NewIterator());
+    cfd->imm->Ref();
+  }
+  Version* current = cfd->versions->current();
+  current->AddIterators(options, &list);
   Iterator* internal_iter =
-      NewMergingIterator(&internal_comparator_, &list[0], list.size());
-  versions_->current()->Ref();
+      NewMergingIterator(&cfd->internal_comparator, &list[0], list.size());
+  current->Ref();
+  cfd->Ref();
 
+  cleanup->db = this;
   cleanup->mu = &mutex_;
-  cleanup->mem = mem_;
-  cleanup->imm = imm_;
-  cleanup->version = versions_->current();
+  cleanup->cfd = cfd;
+  cleanup->mem = cfd->mem;
+  cleanup->imm = cfd->imm;
+  cleanup->version = current;
   internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, NULL);
 
   *seed = ++seed_;
-  mutex_.Unlock();
+  *state = cleanup;
   return internal_iter;
 }
 
+Status DBImpl::RefreshInternalIterator(const ReadOptions& options,
+                                       ColumnFamilyData* cfd,
+                                       Iterator** iter,
+                                       IterState** state,
+                                       SequenceNumber* latest_snapshot) {
+  Iterator* old_iter;
+  {
+    MutexLock l(&mutex_);
+    if (cfd->dropped) {
+      return Status::InvalidArgument("column family has been dropped");
+    }
+    if ((*state)->mem == cfd->mem && (*state)->imm == cfd->imm &&
+        (*state)->version == cfd->versions->current()) {
+      // The memtable iterator of *iter sees new entries as they are added,
+      // so a newer sequence number is all it takes.
+      *latest_snapshot = versions_->LastSequence();
+      return Status::OK();
+    }
+    old_iter = *iter;
+    uint32_t ignored_seed;
+    *iter = NewInternalIterator(options, cfd, latest_snapshot, &ignored_seed,
+                                state);
+  }
+  delete old_iter;  // Acquires mutex_ to release the old state
+  return Status::OK();
+}
+
 Iterator* DBImpl::TEST_NewInternalIterator() {
   SequenceNumber ignored;
   uint32_t ignored_seed;
-  return NewInternalIterator(ReadOptions(), &ignored, &ignored_seed);
+  IterState* ignored_state;
+  MutexLock l(&mutex_);
+  return NewInternalIterator(ReadOptions(), default_cf_, &ignored,
+                             &ignored_seed, &ignored_state);
 }
 
 int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
@@ -1106,11 +2076,57 @@ int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
   return versions_->MaxNextLevelOverlappingBytes();
 }
 
+ColumnFamilyData* DBImpl::GetColumnFamily(ColumnFamilyHandle* column_family) {
+  mutex_.AssertHeld();
+  ColumnFamilyData* cfd =
+      reinterpret_cast<ColumnFamilyHandleImpl*>(column_family)->cfd();
+  return cfd->dropped ? NULL : cfd;
+}
+
 Status DBImpl::Get(const ReadOptions& options,
                    const Slice& key,
                    std::string* value) {
+  return Get(options, default_handle_, key, value);
+}
+
+Status DBImpl::Get(const ReadOptions& options,
+                   ColumnFamilyHandle* column_family,
+                   const Slice& key,
+                   std::string* value) {
+  ColumnFamilyData* cfd;
+  {
+    MutexLock l(&mutex_);
+    cfd = GetColumnFamily(column_family);
+    if (cfd == NULL) {
+      return Status::InvalidArgument("column family has been dropped");
+    }
+  }
+  // Memtable hits are copied straight into *value
+  PinnableSlice pinnable(value);
+  Status s = GetImpl(options, cfd, key, &pinnable);
+  if (s.ok() && pinnable.IsPinned()) {
+    value->assign(pinnable.data(), pinnable.size());
+  }
+  return s;
+}
+
+Status DBImpl::Get(const ReadOptions& options,
+                   const Slice& key,
+                   PinnableSlice* value) {
+  return GetImpl(options, default_cf_, key, value);
+}
+
+Status DBImpl::GetImpl(const ReadOptions& options,
+                       ColumnFamilyData* cfd,
+                       const Slice& key,
+                       PinnableSlice* value) {
+  value->Reset();
+  Statistics* const statistics = options_.statistics;
+  const uint64_t start_micros = (statistics != NULL) ? env_->NowMicros() : 0;
   Status s;
+  PerfTimer mutex_timer(&CurrentPerfContext()->db_mutex_lock_nanos);
   MutexLock l(&mutex_);
+  mutex_timer.Stop();
   SequenceNumber snapshot;
   if (options.snapshot != NULL) {
     snapshot = reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_;
@@ -1118,12 +2134,16 @@ Status DBImpl::Get(const ReadOptions& options,
     snapshot = versions_->LastSequence();
   }
 
-  MemTable* mem = mem_;
-  MemTable* imm = imm_;
-  Version* current = versions_->current();
+  if (cfd->dropped) {
+    return Status::InvalidArgument("column family has been dropped");
+  }
+  MemTable* mem = cfd->mem;
+  MemTable* imm = cfd->imm;
+  Version* current = cfd->versions->current();
   mem->Ref();
   if (imm != NULL) imm->Ref();
   current->Ref();
+  cfd->Ref();
 
   bool have_stat_update = false;
   Version::GetStats stats;
@@ -1133,15 +2153,30 @@ Status DBImpl::Get(const ReadOptions& options,
     mutex_.Unlock();
     // First look in the memtable, then in the immutable memtable (if any).
     LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, &s)) {
-      // Done
-    } else if (imm != NULL && imm->Get(lkey, value, &s)) {
+    PerfTimer memtable_timer(&CurrentPerfContext()->get_from_memtable_time);
+    PERF_COUNTER_ADD(get_from_memtable_count, 1);
+    bool found = mem->Get(lkey, value->GetSelf(), &s);
+    if (!found && imm != NULL) {
+      PERF_COUNTER_ADD(get_from_memtable_count, 1);
+      found = imm->Get(lkey, value->GetSelf(), &s);
+    }
+    memtable_timer.Stop();
+    if (found) {
       // Done
+      RecordTick(statistics, kMemtableHit);
     } else {
+      RecordTick(statistics, kMemtableMiss);
+      PERF_TIMER_GUARD(get_from_output_files_time);
       s = current->Get(options, lkey, value, &stats);
       have_stat_update = true;
     }
+    mutex_timer.Start();
     mutex_.Lock();
+    mutex_timer.Stop();
+  }
+  if (s.ok() && !value->IsPinned()) {
+    // Found in a memtable
+    value->PinSelf();
   }
 
   if (have_stat_update && current->UpdateStats(stats)) {
@@ -1150,24 +2185,51 @@ Status DBImpl::Get(const ReadOptions& options,
   mem->Unref();
   if (imm != NULL) imm->Unref();
   current->Unref();
+  cfd->Unref();
+
+  if (statistics != NULL) {
+    if (s.ok()) {
+      statistics->RecordTick(kNumberKeysRead, 1);
+      statistics->RecordTick(kBytesRead, value->size());
+    }
+    statistics->MeasureTime(kDbGetMicros, env_->NowMicros() - start_micros);
+  }
   return s;
 }
 
 Iterator* DBImpl::NewIterator(const ReadOptions& options) {
+  return NewIterator(options, default_handle_);
+}
+
+Iterator* DBImpl::NewIterator(const ReadOptions& options,
+                              ColumnFamilyHandle* column_family) {
   SequenceNumber latest_snapshot;
   uint32_t seed;
-  Iterator* iter = NewInternalIterator(options, &latest_snapshot, &seed);
+  ColumnFamilyData* cfd;
+  Iterator* iter;
+  IterState* state;
+  {
+    MutexLock l(&mutex_);
+    cfd = GetColumnFamily(column_family);
+    if (cfd == NULL) {
+      return NewErrorIterator(
+          Status::InvalidArgument("column family has been dropped"));
+    }
+    iter = NewInternalIterator(options, cfd, &latest_snapshot, &seed,
+                               &state);
+  }
   return NewDBIterator(
-      this, user_comparator(), iter,
-      (options.snapshot != NULL
+      this, cfd, options, cfd->internal_comparator.user_comparator(), iter,
+      state,
+      (options.snapshot != NULL && !options.tailing
        ? reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_
        : latest_snapshot),
       seed);
 }
 
-void DBImpl::RecordReadSample(Slice key) {
+void DBImpl::RecordReadSample(ColumnFamilyData* cfd, Slice key) {
   MutexLock l(&mutex_);
-  if (versions_->current()->RecordReadSample(key)) {
+  if (!cfd->dropped && cfd->versions->current()->RecordReadSample(key)) {
     MaybeScheduleCompaction();
   }
 }
@@ -1191,18 +2253,96 @@ Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
   return DB::Delete(options, key);
 }
 
+Status DBImpl::Put(const WriteOptions& o, ColumnFamilyHandle* column_family,
+                   const Slice& key, const Slice& val) {
+  {
+    MutexLock l(&mutex_);
+    if (GetColumnFamily(column_family) == NULL) {
+      return Status::InvalidArgument("column family has been dropped");
+    }
+  }
+  return DB::Put(o, column_family, key, val);
+}
+
+Status DBImpl::Delete(const WriteOptions& options,
+                      ColumnFamilyHandle* column_family, const Slice& key) {
+  {
+    MutexLock l(&mutex_);
+    if (GetColumnFamily(column_family) == NULL) {
+      return Status::InvalidArgument("column family has been dropped");
+    }
+  }
+  return DB::Delete(options, column_family, key);
+}
+
+// The memtables that the updates of a write batch go to: those of the
+// default column family and of the column families in "ids".  Holds a
+// reference to every one of them so that they stay alive while the batch
+// is applied without holding mutex_.
+class DBImpl::WriteMemTables
+    : public WriteBatchInternal::ColumnFamilyMemTables {
+ public:
+  // REQUIRES: mutex_ is held
+  WriteMemTables(ColumnFamilyData* default_cf,
+                 const ColumnFamilyMap& column_families,
+                 const std::vector<uint32_t>& ids) {
+    Add(0, default_cf->mem);
+    for (size_t i = 0; i < ids.size(); i++) {
+      ColumnFamilyMap::const_iterator it = column_families.find(ids[i]);
+      if (it != column_families.end()) {
+        Add(it->first, it->second->mem);
+      }
+    }
+  }
+
+  // REQUIRES: mutex_ is held
+  void Release() {
+    for (size_t i = 0; i < mems_.size(); i++) {
+      mems_[i].second->Unref();
+    }
+    mems_.clear();
+  }
+
+  virtual MemTable* GetMemTable(uint32_t id) {
+    // Few column families are expected, so a linear search is fine.
+    for (size_t i = 0; i < mems_.size(); i++) {
+      if (mems_[i].first == id) {
+        return mems_[i].second;
+      }
+    }
+    // The column family has been dropped
+    return NULL;
+  }
+
+ private:
+  void Add(uint32_t id, MemTable* mem) {
+    mem->Ref();
+    mems_.push_back(std::make_pair(id, mem));
+  }
+
+  std::vector<std::pair<uint32_t, MemTable*> > mems_;
+};
+
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
+  Statistics* const statistics = options_.statistics;
+  const uint64_t start_micros = (statistics != NULL) ? env_->NowMicros() : 0;
   Writer w(&mutex_);
   w.batch = my_batch;
   w.sync = options.sync;
   w.done = false;
+  if (my_batch != NULL) {
+    WriteBatchInternal::AddColumnFamilies(my_batch, &w.column_families);
+  }
 
-  MutexLock l(&mutex_);
+  mutex_.Lock();
   writers_.push_back(&w);
   while (!w.done && &w != writers_.front()) {
     w.cv.Wait();
   }
   if (w.done) {
+    mutex_.Unlock();
+    DeliverEvents();
+    MeasureTime(statistics, kDbWriteMicros, env_->NowMicros() - start_micros);
     return w.status;
   }
 
@@ -1214,13 +2354,43 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
     WriteBatch* updates = BuildBatchGroup(&last_writer);
     WriteBatchInternal::SetSequence(updates, last_sequence + 1);
     last_sequence += WriteBatchInternal::Count(updates);
+    if (statistics != NULL) {
+      statistics->RecordTick(kNumberKeysWritten,
+                             WriteBatchInternal::Count(updates));
+      statistics->RecordTick(kBytesWritten,
+                             WriteBatchInternal::ByteSize(updates));
+    }
+    uint64_t delay_micros = 0;
+    if (write_controller_.IsDelayed()) {
+      delay_micros = write_controller_.GetDelay(
+          env_->NowMicros(), WriteBatchInternal::ByteSize(updates));
+    }
+    // Only reference the memtables that the group writes to
+    std::vector<uint32_t> ids;
+    for (std::deque<Writer*>::iterator it = writers_.begin(); ; ++it) {
+      const std::vector<uint32_t>& cfs = (*it)->column_families;
+      for (size_t i = 0; i < cfs.size(); i++) {
+        if (std::find(ids.begin(), ids.end(), cfs[i]) == ids.end()) {
+          ids.push_back(cfs[i]);
+        }
+      }
+      if (*it == last_writer) break;
+    }
+    WriteMemTables memtables(default_cf_, column_families_, ids);
 
-    // Add to log and apply to memtable.  We can release the lock
+    // Add to log and apply to memtables.  We can release the lock
     // during this phase since &w is currently responsible for logging
     // and protects against concurrent loggers and concurrent writes
-    // into mem_.
+    // into the memtables.
     {
       mutex_.Unlock();
+      if (delay_micros > 0) {
+        // Writers queued behind &w are delayed as well.  This also hands
+        // over some CPU to the compaction thread in case it is sharing
+        // the same core as the writer.
+        env_->SleepForMicroseconds(static_cast<int>(delay_micros));
+        RecordTick(statistics, kStallMicros, delay_micros);
+      }
       status = log_->AddRecord(WriteBatchInternal::Contents(updates));
       bool sync_error = false;
       if (status.ok() && options.sync) {
@@ -1229,8 +2399,8 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
           sync_error = true;
         }
       }
-      if (status.ok()) {
-        status = WriteBatchInternal::InsertInto(updates, mem_);
+      if (status.ok() && !options_.inplace_update_support) {
+        status = WriteBatchInternal::InsertInto(updates, &memtables);
       }
       mutex_.Lock();
       if (sync_error) {
@@ -1240,6 +2410,16 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
         RecordBackgroundError(status);
       }
     }
+    if (status.ok() && options_.inplace_update_support) {
+      // Snapshots are only created while mutex_ is held, so apply the
+      // batch under mutex_ to ensure that no snapshot appears between
+      // choosing which entries may be overwritten and overwriting them.
+      const SequenceNumber inplace_min_sequence =
+          snapshots_.empty() ? 0 : snapshots_.newest()->number_ + 1;
+      status = WriteBatchInternal::InsertInto(updates, &memtables,
+                                              inplace_min_sequence);
+    }
+    memtables.Release();
     if (updates == tmp_batch_) tmp_batch_->Clear();
 
     versions_->SetLastSequence(last_sequence);
@@ -1260,7 +2440,12 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
   if (!writers_.empty()) {
     writers_.front()->cv.Signal();
   }
+  mutex_.Unlock();
 
+  // Events such as stall changes were queued while this writer led the
+  // write queue, where a listener that writes would deadlock
+  DeliverEvents();
+  MeasureTime(statistics, kDbWriteMicros, env_->NowMicros() - start_micros);
   return status;
 }
 
@@ -1313,46 +2498,71 @@ WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
   return result;
 }
 
+// Wait for background work, accounting the time as a write stall.
+void DBImpl::WaitForBackgroundWork() {
+  mutex_.AssertHeld();
+  if (options_.statistics == NULL) {
+    bg_cv_.Wait();
+  } else {
+    const uint64_t start_micros = env_->NowMicros();
+    bg_cv_.Wait();
+    options_.statistics->RecordTick(kStallMicros,
+                                    env_->NowMicros() - start_micros);
+  }
+}
+
 // REQUIRES: mutex_ is held
 // REQUIRES: this thread is currently at the front of the writer queue
 Status DBImpl::MakeRoomForWrite(bool force) {
   mutex_.AssertHeld();
   assert(!writers_.empty());
-  bool allow_delay = !force;
   Status s;
   while (true) {
+    // All memtables that hold updates are switched together with the
+    // log, so that the memtables of every column family only hold
+    // updates of the current log.  This is what allows a memtable
+    // compaction to drop all earlier logs from its column family.
+    bool full = force;
+    bool imm_pending = false;
+    int level0_files = 0;
+    for (ColumnFamilyMap::iterator it = column_families_.begin();
+         it != column_families_.end(); ++it) {
+      ColumnFamilyData* cfd = it->second;
+      if (cfd->mem->ApproximateMemoryUsage() > cfd->options.write_buffer_size) {
+        full = true;
+      }
+      if (cfd == default_cf_ || !cfd->mem->IsEmpty()) {
+        imm_pending = imm_pending || (cfd->imm != NULL);
+        level0_files = std::max(level0_files,
+                                cfd->versions->NumLevelFiles(0));
+      }
+    }
+    const bool too_many_level0_files =
+        (level0_files >= config::kL0_StopWritesTrigger);
+
     if (!bg_error_.ok()) {
       // Yield previous error
       s = bg_error_;
       break;
-    } else if (
-        allow_delay &&
-        versions_->NumLevelFiles(0) >= config::kL0_SlowdownWritesTrigger) {
-      // We are getting close to hitting a hard limit on the number of
-      // L0 files.  Rather than delaying a single write by several
-      // seconds when we hit the hard limit, start delaying each
-      // individual write by 1ms to reduce latency variance.  Also,
-      // this delay hands over some CPU to the compaction thread in
-      // case it is sharing the same core as the writer.
-      mutex_.Unlock();
-      env_->SleepForMicroseconds(1000);
-      allow_delay = false;  // Do not delay a single write more than once
-      mutex_.Lock();
-    } else if (!force &&
-               (mem_->ApproximateMemoryUsage() <= options_.write_buffer_size)) {
-      // There is room in current memtable
+    } else if (!full) {
+      // There is room in the current memtables
       break;
-    } else if (imm_ != NULL) {
+    } else if (stall_condition_ != kStallStopped &&
+               (imm_pending || too_many_level0_files)) {
+      // Report the stall before waiting
+      SetStallCondition(kStallStopped);
+    } else if (imm_pending) {
       // We have filled up the current memtable, but the previous
       // one is still being compacted, so we wait.
       Log(options_.info_log, "Current memtable full; waiting...\n");
-      bg_cv_.Wait();
-    } else if (versions_->NumLevelFiles(0) >= config::kL0_StopWritesTrigger) {
+      WaitForBackgroundWork();
+    } else if (too_many_level0_files) {
       // There are too many level-0 files.
       Log(options_.info_log, "Too many L0 files; waiting...\n");
-      bg_cv_.Wait();
+      WaitForBackgroundWork();
     } else {
-      // Attempt to switch to a new memtable and trigger compaction of old
+      // Attempt to switch to a new log and memtables and trigger
+      // compaction of the old ones
       assert(versions_->PrevLogNumber() == 0);
       uint64_t new_log_number = versions_->NewFileNumber();
       WritableFile* lfile = NULL;
@@ -1367,21 +2577,68 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       logfile_ = lfile;
       logfile_number_ = new_log_number;
       log_ = new log::Writer(lfile);
-      imm_ = mem_;
-      has_imm_.Release_Store(imm_);
-      mem_ = new MemTable(internal_comparator_);
-      mem_->Ref();
+      for (ColumnFamilyMap::iterator it = column_families_.begin();
+           it != column_families_.end(); ++it) {
+        ColumnFamilyData* cfd = it->second;
+        if (cfd == default_cf_ || !cfd->mem->IsEmpty()) {
+          cfd->imm = cfd->mem;
+          cfd->mem = new MemTable(cfd->internal_comparator,
+                                  options_.inplace_update_support);
+          cfd->mem->Ref();
+        }
+      }
+      UpdateHasImm();
       force = false;   // Do not force another compaction if have room
       MaybeScheduleCompaction();
     }
   }
+
+  // We may be getting close to hitting a hard limit on the number of L0
+  // files or falling behind on compactions.  Rather than delaying a
+  // single write by several seconds when we hit the hard limit, Write()
+  // throttles writes to a rate the compactions can sustain.
+  int level0_files = 0;
+  uint64_t pending_compaction_bytes = 0;
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    VersionSet* versions = it->second->versions;
+    level0_files = std::max(level0_files, versions->NumLevelFiles(0));
+    pending_compaction_bytes += versions->PendingCompactionBytes();
+  }
+  write_controller_.Update(level0_files, pending_compaction_bytes);
+  SetStallCondition(write_controller_.IsDelayed() ? kStallDelayed
+                                                  : kStallNormal);
   return s;
 }
 
+void DBImpl::SetStallCondition(WriteStallCondition condition) {
+  mutex_.AssertHeld();
+  if (condition == stall_condition_) {
+    return;
+  }
+  WriteStallInfo info;
+  info.db_name = dbname_;
+  info.condition = condition;
+  info.prev_condition = stall_condition_;
+  stall_condition_ = condition;
+  NotifyOnStallConditionChanged(info);
+}
+
 bool DBImpl::GetProperty(const Slice& property, std::string* value) {
+  return GetProperty(default_handle_, property, value);
+}
+
+bool DBImpl::GetProperty(ColumnFamilyHandle* column_family,
+                         const Slice& property, std::string* value) {
   value->clear();
 
   MutexLock l(&mutex_);
+  ColumnFamilyData* cfd = GetColumnFamily(column_family);
+  if (cfd == NULL) {
+    return false;
+  }
+  VersionSet* const versions = cfd->versions;
+  const CompactionStats* const stats = cfd->stats;
   Slice in = property;
   Slice prefix("leveldb.");
   if (!in.starts_with(prefix)) return false;
@@ -1396,7 +2653,7 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
     } else {
       char buf[100];
       snprintf(buf, sizeof(buf), "%d",
-               versions_->NumLevelFiles(static_cast<int>(level)));
+               versions->NumLevelFiles(static_cast<int>(level)));
       *value = buf;
       return true;
     }
@@ -1409,31 +2666,70 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
              );
     value->append(buf);
     for (int level = 0; level < config::kNumLevels; level++) {
-      int files = versions_->NumLevelFiles(level);
-      if (stats_[level].micros > 0 || files > 0) {
+      int files = versions->NumLevelFiles(level);
+      if (stats[level].micros > 0 || files > 0) {
         snprintf(
             buf, sizeof(buf),
             "%3d %8d %8.0f %9.0f %8.0f %9.0f\n",
             level,
             files,
-            versions_->NumLevelBytes(level) / 1048576.0,
-            stats_[level].micros / 1e6,
-            stats_[level].bytes_read / 1048576.0,
-            stats_[level].bytes_written / 1048576.0);
+            versions->NumLevelBytes(level) / 1048576.0,
+            stats[level].micros / 1e6,
+            stats[level].bytes_read / 1048576.0,
+            stats[level].bytes_written / 1048576.0);
         value->append(buf);
       }
     }
+    int64_t written_bytes = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      written_bytes += stats[level].bytes_written;
+    }
+    const int64_t flushed_bytes = cfd->flushed_bytes;
+    snprintf(buf, sizeof(buf),
+             "Write amplification: %.2f (%.0f MB flushed, %.0f MB written)\n",
+             flushed_bytes > 0 ?
+                 static_cast<double>(written_bytes) / flushed_bytes : 0.0,
+             flushed_bytes / 1048576.0,
+             written_bytes / 1048576.0);
+    value->append(buf);
+    return true;
+  } else if (in == "delayed-write-rate") {
+    char buf[50];
+    snprintf(buf, sizeof(buf), "%llu",
+             static_cast<unsigned long long>(
+                 write_controller_.delayed_write_rate()));
+    value->append(buf);
+    return true;
+  } else if (in == "statistics") {
+    if (options_.statistics == NULL) {
+      return false;
+    }
+    value->append(options_.statistics->ToString());
+    return true;
+  } else if (in == "prewarm-progress") {
+    char buf[50];
+    snprintf(buf, sizeof(buf), "%llu/%llu",
+             static_cast<unsigned long long>(prewarm_done_),
+             static_cast<unsigned long long>(prewarm_files_.size()));
+    value->append(buf);
+    return true;
+  } else if (in == "pending-compaction-bytes") {
+    char buf[50];
+    snprintf(buf, sizeof(buf), "%llu",
+             static_cast<unsigned long long>(
+                 versions->PendingCompactionBytes()));
+    value->append(buf);
     return true;
   } else if (in == "sstables") {
-    *value = versions_->current()->DebugString();
+    *value = versions->current()->DebugString();
     return true;
   } else if (in == "approximate-memory-usage") {
-    size_t total_usage = options_.block_cache->TotalCharge();
-    if (mem_) {
-      total_usage += mem_->ApproximateMemoryUsage();
+    size_t total_usage = cfd->options.block_cache->TotalCharge();
+    if (cfd->mem) {
+      total_usage += cfd->mem->ApproximateMemoryUsage();
     }
-    if (imm_) {
-      total_usage += imm_->ApproximateMemoryUsage();
+    if (cfd->imm) {
+      total_usage += cfd->imm->ApproximateMemoryUsage();
     }
     char buf[50];
     snprintf(buf, sizeof(buf), "%llu",
@@ -1471,6 +2767,123 @@ void DBImpl::GetApproximateSizes(
   }
 }
 
+void DBImpl::PauseBackgroundWork() {
+  mutex_.AssertHeld();
+  while (bg_compaction_scheduled_) {
+    bg_cv_.Wait();
+  }
+  bg_compaction_scheduled_ = true;
+}
+
+void DBImpl::ContinueBackgroundWork() {
+  mutex_.AssertHeld();
+  assert(bg_compaction_scheduled_);
+  bg_compaction_scheduled_ = false;
+  MaybeScheduleCompaction();
+  bg_cv_.SignalAll();
+}
+
+Status DBImpl::CreateColumnFamily(const Options& options,
+                                  const std::string& name,
+                                  ColumnFamilyHandle** handle) {
+  *handle = NULL;
+  MutexLock l(&mutex_);
+  for (ColumnFamilyMap::iterator it = column_families_.begin();
+       it != column_families_.end(); ++it) {
+    if (it->second->name == name) {
+      return Status::InvalidArgument(name, "column family exists");
+    }
+  }
+  PauseBackgroundWork();
+
+  // The column family exists once it is recorded in the descriptor of
+  // the default column family.  A directory left behind by a failure
+  // before that point is deleted by the next DB::Open().
+  const uint32_t id = versions_->MaxColumnFamily() + 1;
+  ColumnFamilyData* cfd = new ColumnFamilyData(
+      id, name, ColumnFamilyDirName(dbname_, id), options_, options,
+      table_cache_, &dropped_dirs_);
+  cfd->Ref();
+  cfd->dropped = true;  // Delete the files unless creation succeeds
+  env_->CreateDir(cfd->dir);
+  Status s = NewDB(cfd->dir, cfd->internal_comparator.user_comparator(),
+                   logfile_number_);
+  if (s.ok()) {
+    bool ignored;
+    s = cfd->versions->Recover(&ignored);
+  }
+  if (s.ok()) {
+    VersionEdit edit;
+    s = LogAndApply(cfd, &edit);
+  }
+  if (s.ok()) {
+    VersionEdit edit;
+    edit.AddColumnFamily(id, name);
+    edit.SetMaxColumnFamily(id);
+    s = LogAndApply(default_cf_, &edit);
+  }
+  if (s.ok()) {
+    cfd->dropped = false;
+    cfd->mem = new MemTable(cfd->internal_comparator,
+                            options_.inplace_update_support);
+    cfd->mem->Ref();
+    column_families_[id] = cfd;
+    *handle = new ColumnFamilyHandleImpl(cfd, this, &mutex_);
+    Log(options_.info_log, "Created column family %s with id %u",
+        name.c_str(), static_cast<unsigned int>(id));
+  } else {
+    cfd->Unref();
+  }
+
+  ContinueBackgroundWork();
+  return s;
+}
+
+Status DBImpl::DropColumnFamily(ColumnFamilyHandle* column_family) {
+  MutexLock l(&mutex_);
+  ColumnFamilyData* cfd = GetColumnFamily(column_family);
+  if (cfd == NULL) {
+    return Status::InvalidArgument("column family has been dropped");
+  }
+  if (cfd == default_cf_) {
+    return Status::InvalidArgument("cannot drop the default column family");
+  }
+  PauseBackgroundWork();
+
+  VersionEdit edit;
+  edit.DropColumnFamily(cfd->id);
+  Status s = LogAndApply(default_cf_, &edit);
+  if (s.ok()) {
+    // The files are deleted when the last handle or iterator that
+    // refers to the column family goes away.
+    cfd->dropped = true;
+    column_families_.erase(cfd->id);
+    UpdateHasImm();
+    Log(options_.info_log, "Dropped column family %s",
+        cfd->name.c_str());
+    cfd->Unref();
+  }
+
+  ContinueBackgroundWork();
+  return s;
+}
+
+void DBImpl::DeleteDroppedColumnFamilyDirs() {
+  std::vector<std::string> dirs;
+  mutex_.Lock();
+  dirs.swap(dropped_dirs_);
+  mutex_.Unlock();
+  for (size_t i = 0; i < dirs.size(); i++) {
+    Log(options_.info_log, "Delete dropped column family dir %s",
+        dirs[i].c_str());
+    DestroyColumnFamilyDir(env_, dirs[i]);
+  }
+}
+
+ColumnFamilyHandle* DBImpl::DefaultColumnFamily() const {
+  return default_handle_;
+}
+
 // Default implementations of convenience methods that subclasses of DB
 // can call if they wish
 Status DB::Put(const WriteOptions& opt, const Slice& key, const Slice& value) {
@@ -1485,45 +2898,157 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
   return Write(opt, &batch);
 }
 
+Status DB::Get(const ReadOptions& options, const Slice& key,
+               PinnableSlice* value) {
+  value->Reset();
+  Status s = Get(options, key, value->GetSelf());
+  if (s.ok()) {
+    value->PinSelf();
+  }
+  return s;
+}
+
+Status DB::CreateCheckpoint(const std::string& checkpoint_dir) {
+  return Status::NotSupported("CreateCheckpoint", checkpoint_dir);
+}
+
+Status DB::CreateColumnFamily(const Options& options, const std::string& name,
+                              ColumnFamilyHandle** handle) {
+  *handle = NULL;
+  return Status::NotSupported("CreateColumnFamily", name);
+}
+
+Status DB::DropColumnFamily(ColumnFamilyHandle* column_family) {
+  return Status::NotSupported("DropColumnFamily");
+}
+
+ColumnFamilyHandle* DB::DefaultColumnFamily() const {
+  return NULL;
+}
+
+Status DB::Put(const WriteOptions& opt, ColumnFamilyHandle* column_family,
+               const Slice& key, const Slice& value) {
+  WriteBatch batch;
+  batch.Put(column_family, key, value);
+  return Write(opt, &batch);
+}
+
+Status DB::Delete(const WriteOptions& opt, ColumnFamilyHandle* column_family,
+                  const Slice& key) {
+  WriteBatch batch;
+  batch.Delete(column_family, key);
+  return Write(opt, &batch);
+}
+
+Status DB::Get(const ReadOptions& options, ColumnFamilyHandle* column_family,
+               const Slice& key, std::string* value) {
+  return Status::NotSupported("column families");
+}
+
+Iterator* DB::NewIterator(const ReadOptions& options,
+                          ColumnFamilyHandle* column_family) {
+  return NewErrorIterator(Status::NotSupported("column families"));
+}
+
+bool DB::GetProperty(ColumnFamilyHandle* column_family,
+                     const Slice& property, std::string* value) {
+  return false;
+}
+
+void DB::CompactRange(ColumnFamilyHandle* column_family,
+                      const Slice* begin, const Slice* end) {
+}
+
 DB::~DB() { }
 
+ColumnFamilyHandle::~ColumnFamilyHandle() { }
+
+EventListener::~EventListener() { }
+
+Status DB::Open(const Options& options, const std::string& dbname,
+                DB** dbptr) {
+  std::vector<ColumnFamilyDescriptor> column_families;
+  std::vector<ColumnFamilyHandle*> handles;
+  return Open(options, dbname, column_families, &handles, dbptr);
+}
+
 Status DB::Open(const Options& options, const std::string& dbname,
+                const std::vector<ColumnFamilyDescriptor>& column_families,
+                std::vector<ColumnFamilyHandle*>* handles,
                 DB** dbptr) {
   *dbptr = NULL;
+  handles->clear();
 
   DBImpl* impl = new DBImpl(options, dbname);
   impl->mutex_.Lock();
-  VersionEdit edit;
+  std::map<uint32_t, VersionEdit> edits;
   // Recover handles create_if_missing, error_if_exists
   bool save_manifest = false;
-  Status s = impl->Recover(&edit, &save_manifest);
-  if (s.ok() && impl->mem_ == NULL) {
-    // Create new log and a corresponding memtable.
+  Status s = impl->Recover(column_families, &edits, &save_manifest);
+  if (s.ok() && impl->log_ == NULL) {
+    // Create new log and the corresponding memtables.
     uint64_t new_log_number = impl->versions_->NewFileNumber();
     WritableFile* lfile;
     s = options.env->NewWritableFile(LogFileName(dbname, new_log_number),
                                      &lfile);
     if (s.ok()) {
-      edit.SetLogNumber(new_log_number);
+      edits[0].SetLogNumber(new_log_number);
       impl->logfile_ = lfile;
       impl->logfile_number_ = new_log_number;
       impl->log_ = new log::Writer(lfile);
-      impl->mem_ = new MemTable(impl->internal_comparator_);
-      impl->mem_->Ref();
+    }
+  }
+  if (s.ok()) {
+    for (DBImpl::ColumnFamilyMap::iterator it = impl->column_families_.begin();
+         it != impl->column_families_.end(); ++it) {
+      ColumnFamilyData* cfd = it->second;
+      if (cfd->mem == NULL) {
+        cfd->mem = new MemTable(cfd->internal_comparator,
+                                impl->options_.inplace_update_support);
+        cfd->mem->Ref();
+      }
     }
   }
   if (s.ok() && save_manifest) {
-    edit.SetPrevLogNumber(0);  // No older logs needed after recovery.
-    edit.SetLogNumber(impl->logfile_number_);
-    s = impl->versions_->LogAndApply(&edit, &impl->mutex_);
+    VersionEdit* edit = &edits[0];
+    edit->SetPrevLogNumber(0);  // No older logs needed after recovery.
+    edit->SetLogNumber(impl->logfile_number_);
+    s = impl->LogAndApply(impl->default_cf_, edit);
+  }
+  // The descriptors of the other column families are rewritten on every
+  // open, since they may name logs that were just replayed.
+  for (DBImpl::ColumnFamilyMap::iterator it = impl->column_families_.begin();
+       s.ok() && it != impl->column_families_.end(); ++it) {
+    ColumnFamilyData* cfd = it->second;
+    if (cfd != impl->default_cf_) {
+      VersionEdit* edit = &edits[cfd->id];
+      edit->SetLogNumber(impl->logfile_number_);
+      s = impl->LogAndApply(cfd, edit);
+    }
   }
   if (s.ok()) {
+    for (size_t i = 0; i < column_families.size(); i++) {
+      ColumnFamilyData* cfd = NULL;
+      for (DBImpl::ColumnFamilyMap::iterator it =
+               impl->column_families_.begin();
+           it != impl->column_families_.end(); ++it) {
+        if (it->second->name == column_families[i].name) {
+          cfd = it->second;
+        }
+      }
+      handles->push_back(
+          new ColumnFamilyHandleImpl(cfd, impl, &impl->mutex_));
+    }
     impl->DeleteObsoleteFiles();
     impl->MaybeScheduleCompaction();
+    if (impl->options_.prewarm_tables) {
+      impl->StartPrewarm();
+    }
   }
   impl->mutex_.Unlock();
+  impl->DeliverEvents();
   if (s.ok()) {
-    assert(impl->mem_ != NULL);
+    assert(impl->default_cf_->mem != NULL);
     *dbptr = impl;
   } else {
     delete impl;
@@ -1531,6 +3056,29 @@ Status DB::Open(const Options& options, const std::string& dbname,
   return s;
 }
 
+Status DB::ListColumnFamilies(const Options& options, const std::string& name,
+                              std::vector<std::string>* column_families) {
+  column_families->clear();
+  Options opts = options;
+  opts.reuse_logs = false;  // Do not keep the descriptor open
+  const InternalKeyComparator icmp(options.comparator);
+  TableCache table_cache(name, &opts, 1);
+  VersionSet versions(name, &opts, &table_cache, &icmp);
+  bool ignored;
+  Status s = versions.Recover(&ignored);
+  if (s.ok()) {
+    column_families->push_back(kDefaultColumnFamilyName);
+    const std::map<uint32_t, std::string>& registered =
+        versions.ColumnFamilies();
+    for (std::map<uint32_t, std::string>::const_iterator it =
+             registered.begin();
+         it != registered.end(); ++it) {
+      column_families->push_back(it->second);
+    }
+  }
+  return s;
+}
+
 Snapshot::~Snapshot() {
 }
 
@@ -1549,13 +3097,17 @@ Status DestroyDB(const std::string& dbname, const Options& options) {
   if (result.ok()) {
     uint64_t number;
     FileType type;
+    uint32_t id;
     for (size_t i = 0; i < filenames.size(); i++) {
+      Status del;
       if (ParseFileName(filenames[i], &number, &type) &&
           type != kDBLockFile) {  // Lock file will be deleted at end
-        Status del = env->DeleteFile(dbname + "/" + filenames[i]);
-        if (result.ok() && !del.ok()) {
-          result = del;
-        }
+        del = env->DeleteFile(dbname + "/" + filenames[i]);
+      } else if (ParseColumnFamilyDirName(filenames[i], &id)) {
+        del = DestroyColumnFamilyDir(env, dbname + "/" + filenames[i]);
+      }
+      if (result.ok() && !del.ok()) {
+        result = del;
       }
     }
     env->UnlockFile(lock);  // Ignore error since state is already gone
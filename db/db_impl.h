@@ -6,19 +6,24 @@
 #define STORAGE_LEVELDB_DB_DB_IMPL_H_
 
 #include <deque>
+#include <map>
 #include <set>
+#include "db/column_family.h"
 #include "db/dbformat.h"
 #include "db/log_writer.h"
 #include "db/snapshot.h"
+#include "db/write_controller.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/listener.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
 
 namespace leveldb {
 
+struct FileMetaData;
+struct IterState;
 class MemTable;
-class TableCache;
 class Version;
 class VersionEdit;
 class VersionSet;
@@ -35,21 +40,51 @@ class DBImpl : public DB {
   virtual Status Get(const ReadOptions& options,
                      const Slice& key,
                      std::string* value);
+  virtual Status Get(const ReadOptions& options,
+                     const Slice& key,
+                     PinnableSlice* value);
   virtual Iterator* NewIterator(const ReadOptions&);
   virtual const Snapshot* GetSnapshot();
   virtual void ReleaseSnapshot(const Snapshot* snapshot);
   virtual bool GetProperty(const Slice& property, std::string* value);
   virtual void GetApproximateSizes(const Range* range, int n, uint64_t* sizes);
   virtual void CompactRange(const Slice* begin, const Slice* end);
+  virtual Status CreateCheckpoint(const std::string& checkpoint_dir);
+  virtual Status CreateColumnFamily(const Options& options,
+                                    const std::string& name,
+                                    ColumnFamilyHandle** handle);
+  virtual Status DropColumnFamily(ColumnFamilyHandle* column_family);
+  virtual ColumnFamilyHandle* DefaultColumnFamily() const;
+  virtual Status Put(const WriteOptions& options,
+                     ColumnFamilyHandle* column_family,
+                     const Slice& key,
+                     const Slice& value);
+  virtual Status Delete(const WriteOptions& options,
+                        ColumnFamilyHandle* column_family,
+                        const Slice& key);
+  virtual Status Get(const ReadOptions& options,
+                     ColumnFamilyHandle* column_family,
+                     const Slice& key, std::string* value);
+  virtual Iterator* NewIterator(const ReadOptions& options,
+                                ColumnFamilyHandle* column_family);
+  virtual bool GetProperty(ColumnFamilyHandle* column_family,
+                           const Slice& property, std::string* value);
+  virtual void CompactRange(ColumnFamilyHandle* column_family,
+                            const Slice* begin, const Slice* end);
 
   // Extra methods (for testing) that are not in the public DB interface
 
   // Compact any files in the named level that overlap [*begin,*end]
   void TEST_CompactRange(int level, const Slice* begin, const Slice* end);
 
-  // Force current memtable contents to be compacted.
+  // Force current memtable contents of every column family to be
+  // compacted.
   Status TEST_CompactMemTable();
 
+  // Wait until no background compaction is scheduled.  Returns the
+  // background error, if any.
+  Status TEST_WaitForCompactions();
+
   // Return an internal iterator over the current state of the database.
   // The keys of this iterator are internal keys (see format.h).
   // The returned iterator should be deleted when no longer needed.
@@ -59,47 +94,157 @@ class DBImpl : public DB {
   // file at a level >= 1.
   int64_t TEST_MaxNextLevelOverlappingBytes();
 
-  // Record a sample of bytes read at the specified internal key.
-  // Samples are taken approximately once every config::kReadBytesPeriod
-  // bytes.
-  void RecordReadSample(Slice key);
+  // Record a sample of bytes read at the specified internal key of the
+  // column family "cfd".  Samples are taken approximately once every
+  // config::kReadBytesPeriod bytes.
+  void RecordReadSample(ColumnFamilyData* cfd, Slice key);
+
+  // Bring "*iter", an internal iterator of the column family "cfd" that
+  // reads from "*state", up to date.  If the memtables or the files of
+  // "cfd" have changed since "*iter" was created, "*iter" is deleted and
+  // replaced by a new internal iterator, and "*state" is updated to match.
+  // Otherwise "*iter" already sees all updates.  In both cases the latest
+  // sequence number is stored in "*latest_snapshot".
+  Status RefreshInternalIterator(const ReadOptions& options,
+                                 ColumnFamilyData* cfd,
+                                 Iterator** iter,
+                                 IterState** state,
+                                 SequenceNumber* latest_snapshot);
+
+  // Delete the directories of the dropped column families whose last
+  // reference has gone away.
+  // REQUIRES: mutex_ is not held
+  void DeleteDroppedColumnFamilyDirs();
 
  private:
   friend class DB;
   struct CompactionState;
+  struct RecoveryFlush;
   struct Writer;
+  class WriteMemTables;
+  class RecoveryMemTables;
+
+  typedef std::map<uint32_t, ColumnFamilyData*> ColumnFamilyMap;
 
   Iterator* NewInternalIterator(const ReadOptions&,
+                                ColumnFamilyData* cfd,
                                 SequenceNumber* latest_snapshot,
-                                uint32_t* seed);
-
-  Status NewDB();
-
-  // Recover the descriptor from persistent storage.  May do a significant
-  // amount of work to recover recently logged updates.  Any changes to
-  // be made to the descriptor are added to *edit.
-  Status Recover(VersionEdit* edit, bool* save_manifest)
+                                uint32_t* seed,
+                                IterState** state);
+
+  Status GetImpl(const ReadOptions& options, ColumnFamilyData* cfd,
+                 const Slice& key, PinnableSlice* value);
+
+  // Return the column family of "column_family", or NULL if it has been
+  // dropped.
+  ColumnFamilyData* GetColumnFamily(ColumnFamilyHandle* column_family);
+
+  // Create an empty descriptor for the column family stored in "dir"
+  // whose first log has the number "log_number".
+  Status NewDB(const std::string& dir, const Comparator* user_comparator,
+               uint64_t log_number);
+
+  // Recover the descriptors from persistent storage and open the column
+  // families in "column_families".  May do a significant amount of work
+  // to recover recently logged updates.  Any changes to be made to the
+  // descriptor of a column family are added to (*edits)[id].
+  Status Recover(const std::vector<ColumnFamilyDescriptor>& column_families,
+                 std::map<uint32_t, VersionEdit>* edits, bool* save_manifest)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   void MaybeIgnoreError(Status* s) const;
 
   // Delete any unneeded files and stale in-memory entries.
   void DeleteObsoleteFiles();
+  void DeleteObsoleteFiles(ColumnFamilyData* cfd, uint64_t min_log,
+                           std::vector<TableFileDeletionInfo>* deleted);
 
-  // Compact the in-memory write buffer to disk.  Switches to a new
-  // log-file/memtable and writes a new descriptor iff successful.
+  // Compact the memtable of every column family to disk and wait until
+  // that is done.
+  Status FlushMemTable();
+
+  // Compact the in-memory write buffer of "cfd" to disk.  Switches to a
+  // new log-file/memtable and writes a new descriptor iff successful.
   // Errors are recorded in bg_error_.
-  void CompactMemTable() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void CompactMemTable(ColumnFamilyData* cfd) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Return a column family with an immutable memtable, or NULL if there
+  // is none.
+  ColumnFamilyData* PickMemTableToCompact() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Return a column family that needs a compaction, or NULL if there is
+  // none.
+  ColumnFamilyData* PickCompactionColumnFamily()
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Recompute has_imm_ from the immutable memtables of all column
+  // families.
+  void UpdateHasImm() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Replay the log "log_number".  Memtables that fill up are written to
+  // level-0 tables by threads that are added to *flushes.
   Status RecoverLogFile(uint64_t log_number, bool last_log, bool* save_manifest,
-                        VersionEdit* edit, SequenceNumber* max_sequence)
+                        std::map<uint32_t, VersionEdit>* edits,
+                        SequenceNumber* max_sequence,
+                        std::vector<RecoveryFlush*>* flushes)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Start writing the memtable of "cfd" to a level-0 table in a new
+  // thread, and replace it with NULL.
+  void StartRecoveryFlush(ColumnFamilyData* cfd,
+                          std::vector<RecoveryFlush*>* flushes)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  static void RecoveryFlushWork(void* arg);
+
+  // Wait until at most "max_running" of *flushes are still running.
+  // The finished ones are removed from *flushes and their tables added
+  // to *edits.  Returns the first error of a finished flush.
+  Status FinishRecoveryFlushes(std::vector<RecoveryFlush*>* flushes,
+                               size_t max_running,
+                               std::map<uint32_t, VersionEdit>* edits)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // If "info" is non-NULL, describes the written table file in *info.
+  Status WriteLevel0Table(ColumnFamilyData* cfd, MemTable* mem,
+                          VersionEdit* edit, Version* base,
+                          FlushJobInfo* info)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // The two halves of WriteLevel0Table(): writing the contents of "mem"
+  // to the table meta->number, which does not need mutex_, and adding
+  // the table to *edit.
+  Status BuildLevel0Table(ColumnFamilyData* cfd, MemTable* mem,
+                          FileMetaData* meta);
+  Status FinishLevel0Table(ColumnFamilyData* cfd, const FileMetaData& meta,
+                           const Status& s, uint64_t start_micros,
+                           VersionEdit* edit, Version* base,
+                           FlushJobInfo* info)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base)
+  // Apply *edit to the descriptor of "cfd".
+  Status LogAndApply(ColumnFamilyData* cfd, VersionEdit* edit)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Keep background work from running while a column family is created
+  // or dropped, since VersionSet::LogAndApply() must not be called
+  // concurrently on the descriptor of the default column family.
+  void PauseBackgroundWork() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void ContinueBackgroundWork() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void ManualCompactRange(ColumnFamilyData* cfd, int level,
+                          const Slice* begin, const Slice* end);
+
+  // Start the threads that open the table files of the current versions.
+  void StartPrewarm() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  static void PrewarmWork(void* arg);
+  void Prewarm();
+
   Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Wait on bg_cv_ and account the time as a write stall.
+  void WaitForBackgroundWork() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void SetStallCondition(WriteStallCondition condition)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   WriteBatch* BuildBatchGroup(Writer** last_writer);
 
   void RecordBackgroundError(const Status& s);
@@ -117,6 +262,29 @@ class DBImpl : public DB {
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
   Status InstallCompactionResults(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void FillCompactionJobInfo(CompactionState* compact,
+                             CompactionJobInfo* info) const;
+
+  // Queue events for the listeners in options_.listeners.  The events
+  // are delivered by DeliverEvents().
+  void NotifyOnFlushCompleted(const FlushJobInfo& info)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void NotifyOnCompactionBegin(const CompactionJobInfo& info)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void NotifyOnCompactionCompleted(const CompactionJobInfo& info)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void NotifyOnStallConditionChanged(const WriteStallInfo& info)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void NotifyOnTableFilesDeleted(
+      const std::vector<TableFileDeletionInfo>& infos)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Invoke the listeners for the queued events.  Called by writers once
+  // they have left the writer queue and by the background thread between
+  // pieces of work, so that the listeners never run while mutex_ is held
+  // or while a write group is open.
+  // REQUIRES: mutex_ is not held
+  void DeliverEvents();
 
   // Constant after construction
   Env* const env_;
@@ -127,8 +295,9 @@ class DBImpl : public DB {
   bool owns_cache_;
   const std::string dbname_;
 
-  // table_cache_ provides its own synchronization
-  TableCache* table_cache_;
+  // Open tables of all column families, so that they share one limit on
+  // the number of open files.  Provides its own synchronization.
+  Cache* table_cache_;
 
   // Lock over the persistent DB state.  Non-NULL iff successfully acquired.
   FileLock* db_lock_;
@@ -137,9 +306,19 @@ class DBImpl : public DB {
   port::Mutex mutex_;
   port::AtomicPointer shutting_down_;
   port::CondVar bg_cv_;          // Signalled when background work finishes
-  MemTable* mem_;
-  MemTable* imm_;                // Memtable being compacted
-  port::AtomicPointer has_imm_;  // So bg thread can detect non-NULL imm_
+
+  // Column families by id, each holding a reference.  The default column
+  // family is default_cf_; its VersionSet is versions_.
+  ColumnFamilyMap column_families_;
+  ColumnFamilyData* default_cf_;
+  ColumnFamilyHandleImpl* default_handle_;
+
+  // Directories of deleted ColumnFamilyData objects of dropped column
+  // families.  Deleted without holding mutex_.
+  std::vector<std::string> dropped_dirs_;
+
+  // So bg thread can detect a non-NULL imm in some column family
+  port::AtomicPointer has_imm_;
   WritableFile* logfile_;
   uint64_t logfile_number_;
   log::Writer* log_;
@@ -151,15 +330,28 @@ class DBImpl : public DB {
 
   SnapshotList snapshots_;
 
-  // Set of table files to protect from deletion because they are
-  // part of ongoing compactions.
-  std::set<uint64_t> pending_outputs_;
-
   // Has a background compaction been scheduled or is running?
   bool bg_compaction_scheduled_;
 
+  // State of the table prewarming started by DB::Open() (see
+  // Options::prewarm_tables).  The prewarming threads hold references to
+  // the column families and Versions of the files so that they cannot
+  // go away while they are being opened.
+  struct PrewarmFile {
+    ColumnFamilyData* cfd;
+    uint64_t number;
+    uint64_t file_size;
+  };
+  std::vector<PrewarmFile> prewarm_files_;
+  std::vector<std::pair<ColumnFamilyData*, Version*> > prewarm_refs_;
+  size_t prewarm_next_;          // Index of the next file to open
+  size_t prewarm_done_;          // Files opened so far
+  int prewarm_threads_;          // Prewarming threads still running
+  uint64_t prewarm_data_bytes_;  // Data block bytes left to load
+
   // Information for a manual compaction
   struct ManualCompaction {
+    ColumnFamilyData* cfd;
     int level;
     bool done;
     const InternalKey* begin;   // NULL means beginning of key range
@@ -173,22 +365,32 @@ class DBImpl : public DB {
   // Have we encountered a background error in paranoid mode?
   Status bg_error_;
 
-  // Per level compaction stats.  stats_[level] stores the stats for
-  // compactions that produced data for the specified "level".
-  struct CompactionStats {
-    int64_t micros;
-    int64_t bytes_read;
-    int64_t bytes_written;
-
-    CompactionStats() : micros(0), bytes_read(0), bytes_written(0) { }
-
-    void Add(const CompactionStats& c) {
-      this->micros += c.micros;
-      this->bytes_read += c.bytes_read;
-      this->bytes_written += c.bytes_written;
-    }
+  // Throttles writes while compactions are falling behind
+  WriteController write_controller_;
+
+  // Stall condition last reported to options_.listeners
+  WriteStallCondition stall_condition_;
+
+  // A listener event waiting to be delivered by DeliverEvents()
+  struct ListenerEvent {
+    enum Type {
+      kFlushCompleted,
+      kCompactionBegin,
+      kCompactionCompleted,
+      kStallConditionChanged,
+      kTableFileDeleted
+    };
+    Type type;
+    FlushJobInfo flush;
+    CompactionJobInfo compaction;
+    WriteStallInfo stall;
+    TableFileDeletionInfo deletion;
   };
-  CompactionStats stats_[config::kNumLevels];
+  std::vector<ListenerEvent> pending_events_;
+  port::AtomicPointer has_pending_events_;  // !pending_events_.empty()
+
+  // Held while delivering events so that they are delivered in order
+  port::Mutex deliver_mutex_;
 
   // No copying allowed
   DBImpl(const DBImpl&);
@@ -12,6 +12,7 @@
 #include "port/port.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/perf_context_imp.h"
 #include "util/random.h"
 
 namespace leveldb {
@@ -48,11 +49,15 @@ class DBIter: public Iterator {
     kReverse
   };
 
-  DBIter(DBImpl* db, const Comparator* cmp, Iterator* iter, SequenceNumber s,
-         uint32_t seed)
+  DBIter(DBImpl* db, ColumnFamilyData* cfd, const ReadOptions& options,
+         const Comparator* cmp, Iterator* iter, IterState* state,
+         SequenceNumber s, uint32_t seed)
       : db_(db),
+        cfd_(cfd),
+        options_(options),
         user_comparator_(cmp),
         iter_(iter),
+        state_(state),
         sequence_(s),
         direction_(kForward),
         valid_(false),
@@ -84,8 +89,12 @@ class DBIter: public Iterator {
   virtual void Seek(const Slice& target);
   virtual void SeekToFirst();
   virtual void SeekToLast();
+  virtual Status Refresh();
 
  private:
+  // Rebind iter_ and sequence_ to the current state of the DB.
+  Status RefreshState();
+
   void FindNextUserEntry(bool skipping, std::string* skip);
   void FindPrevUserEntry();
   bool ParseKey(ParsedInternalKey* key);
@@ -109,9 +118,12 @@ class DBIter: public Iterator {
   }
 
   DBImpl* db_;
+  ColumnFamilyData* const cfd_;
+  const ReadOptions options_;
   const Comparator* const user_comparator_;
-  Iterator* const iter_;
-  SequenceNumber const sequence_;
+  Iterator* iter_;
+  IterState* state_;
+  SequenceNumber sequence_;
 
   Status status_;
   std::string saved_key_;     // == current key when direction_==kReverse
@@ -133,7 +145,7 @@ inline bool DBIter::ParseKey(ParsedInternalKey* ikey) {
   bytes_counter_ -= n;
   while (bytes_counter_ < 0) {
     bytes_counter_ += RandomPeriod();
-    db_->RecordReadSample(k);
+    db_->RecordReadSample(cfd_, k);
   }
   if (!ParseInternalKey(k, ikey)) {
     status_ = Status::Corruption("corrupted internal key in DBIter");
@@ -165,6 +177,15 @@ void DBIter::Next() {
   } else {
     // Store in saved_key_ the current key so we skip it below.
     SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
+
+    // iter_ is pointing to the current key; move past it so that it is
+    // not counted as a skipped entry.
+    iter_->Next();
+    if (!iter_->Valid()) {
+      valid_ = false;
+      saved_key_.clear();
+      return;
+    }
   }
 
   FindNextUserEntry(true, &saved_key_);
@@ -183,11 +204,13 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
           // they are hidden by this deletion.
           SaveKey(ikey.user_key, skip);
           skipping = true;
+          PERF_COUNTER_ADD(internal_delete_skipped_count, 1);
           break;
         case kTypeValue:
           if (skipping &&
               user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
             // Entry hidden
+            PERF_COUNTER_ADD(internal_key_skipped_count, 1);
           } else {
             valid_ = true;
             saved_key_.clear();
@@ -242,19 +265,21 @@ void DBIter::FindPrevUserEntry() {
           // We encountered a non-deleted value in entries for previous keys,
           break;
         }
-        value_type = ikey.type;
-        if (value_type == kTypeDeletion) {
-          saved_key_.clear();
-          ClearSavedValue();
-        } else {
+        if (ikey.type == kTypeValue) {
+          // Entries are visited from the oldest to the newest version of
+          // a user key.  Unless the previous entry was a deletion, it
+          // belongs to the same user key and saved_key_ is already set.
+          if (value_type == kTypeDeletion) {
+            SaveKey(ikey.user_key, &saved_key_);
+          }
           Slice raw_value = iter_->value();
           if (saved_value_.capacity() > raw_value.size() + 1048576) {
             std::string empty;
             swap(empty, saved_value_);
           }
-          SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
           saved_value_.assign(raw_value.data(), raw_value.size());
         }
+        value_type = ikey.type;
       }
       iter_->Prev();
     } while (iter_->Valid());
@@ -271,13 +296,42 @@ void DBIter::FindPrevUserEntry() {
   }
 }
 
+Status DBIter::RefreshState() {
+  SequenceNumber latest_snapshot;
+  Status s = db_->RefreshInternalIterator(options_, cfd_, &iter_, &state_,
+                                          &latest_snapshot);
+  if (s.ok() && (options_.snapshot == NULL || options_.tailing)) {
+    sequence_ = latest_snapshot;
+  }
+  return s;
+}
+
+Status DBIter::Refresh() {
+  Status s = RefreshState();
+  if (!s.ok()) {
+    return s;
+  }
+  status_ = Status::OK();
+  direction_ = kForward;
+  valid_ = false;
+  saved_key_.clear();
+  ClearSavedValue();
+  return s;
+}
+
 void DBIter::Seek(const Slice& target) {
+  if (options_.tailing) {
+    status_ = RefreshState();
+  }
   direction_ = kForward;
   ClearSavedValue();
   saved_key_.clear();
   AppendInternalKey(
       &saved_key_, ParsedInternalKey(target, sequence_, kValueTypeForSeek));
-  iter_->Seek(saved_key_);
+  {
+    PERF_TIMER_GUARD(seek_internal_seek_time);
+    iter_->Seek(saved_key_);
+  }
   if (iter_->Valid()) {
     FindNextUserEntry(false, &saved_key_ /* temporary storage */);
   } else {
@@ -286,6 +340,9 @@ void DBIter::Seek(const Slice& target) {
 }
 
 void DBIter::SeekToFirst() {
+  if (options_.tailing) {
+    status_ = RefreshState();
+  }
   direction_ = kForward;
   ClearSavedValue();
   iter_->SeekToFirst();
@@ -297,6 +354,9 @@ void DBIter::SeekToFirst() {
 }
 
 void DBIter::SeekToLast() {
+  if (options_.tailing) {
+    status_ = RefreshState();
+  }
   direction_ = kReverse;
   ClearSavedValue();
   iter_->SeekToLast();
@@ -307,11 +367,15 @@ void DBIter::SeekToLast() {
 
 Iterator* NewDBIterator(
     DBImpl* db,
+    ColumnFamilyData* cfd,
+    const ReadOptions& options,
     const Comparator* user_key_comparator,
     Iterator* internal_iter,
+    IterState* state,
     SequenceNumber sequence,
     uint32_t seed) {
-  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed);
+  return new DBIter(db, cfd, options, user_key_comparator, internal_iter,
+                    state, sequence, seed);
 }
 
 }  // namespace leveldb
@@ -12,14 +12,21 @@
 namespace leveldb {
 
 class DBImpl;
+struct ColumnFamilyData;
+struct IterState;
 
 // Return a new iterator that converts internal keys (yielded by
-// "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// "*internal_iter") of the column family "cfd" that were live at the
+// specified "sequence" number into appropriate user keys.
+// "*internal_iter" was created with "options", reads from "*state" and
+// must keep "cfd" alive.
 extern Iterator* NewDBIterator(
     DBImpl* db,
+    ColumnFamilyData* cfd,
+    const ReadOptions& options,
     const Comparator* user_key_comparator,
     Iterator* internal_iter,
+    IterState* state,
     SequenceNumber sequence,
     uint32_t seed);
 
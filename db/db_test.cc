@@ -4,6 +4,9 @@
 
 #include "leveldb/db.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/listener.h"
+#include "leveldb/perf_context.h"
+#include "leveldb/statistics.h"
 #include "db/db_impl.h"
 #include "db/filename.h"
 #include "db/version_set.h"
@@ -864,6 +867,90 @@ TEST(DBTest, IterMultiWithDelete) {
   } while (ChangeOptions());
 }
 
+TEST(DBTest, IterRefresh) {
+  do {
+    ASSERT_OK(Put("a", "va"));
+    const Snapshot* snapshot = db_->GetSnapshot();
+    ReadOptions snapshot_options;
+    snapshot_options.snapshot = snapshot;
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    Iterator* snapshot_iter = db_->NewIterator(snapshot_options);
+    ASSERT_OK(Put("b", "vb"));
+    iter->SeekToFirst();
+    ASSERT_EQ(IterStatus(iter), "a->va");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "(invalid)");
+
+    ASSERT_OK(iter->Refresh());
+    ASSERT_EQ(IterStatus(iter), "(invalid)");
+    iter->SeekToFirst();
+    ASSERT_EQ(IterStatus(iter), "a->va");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "b->vb");
+
+    // The files of the DB change underneath the iterator
+    ASSERT_OK(Put("c", "vc"));
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_OK(Delete("a"));
+    ASSERT_OK(iter->Refresh());
+    iter->SeekToLast();
+    ASSERT_EQ(IterStatus(iter), "c->vc");
+    iter->Prev();
+    ASSERT_EQ(IterStatus(iter), "b->vb");
+    iter->Prev();
+    ASSERT_EQ(IterStatus(iter), "(invalid)");
+
+    // An iterator that reads as of a snapshot keeps doing so
+    ASSERT_OK(snapshot_iter->Refresh());
+    snapshot_iter->SeekToFirst();
+    ASSERT_EQ(IterStatus(snapshot_iter), "a->va");
+    snapshot_iter->Next();
+    ASSERT_EQ(IterStatus(snapshot_iter), "(invalid)");
+
+    delete snapshot_iter;
+    delete iter;
+    db_->ReleaseSnapshot(snapshot);
+  } while (ChangeOptions());
+
+  Iterator* empty = NewEmptyIterator();
+  ASSERT_TRUE(empty->Refresh().IsNotSupportedError());
+  delete empty;
+}
+
+TEST(DBTest, TailingIterator) {
+  do {
+    ReadOptions options;
+    options.tailing = true;
+    Iterator* iter = db_->NewIterator(options);
+    iter->SeekToFirst();
+    ASSERT_EQ(IterStatus(iter), "(invalid)");
+
+    ASSERT_OK(Put("a", "va"));
+    iter->SeekToFirst();
+    ASSERT_EQ(IterStatus(iter), "a->va");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "(invalid)");
+
+    ASSERT_OK(Put("b", "vb"));
+    iter->Seek("a");
+    ASSERT_EQ(IterStatus(iter), "a->va");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "b->vb");
+
+    // New keys are seen across a memtable compaction
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_OK(Put("c", "vc"));
+    ASSERT_OK(Delete("a"));
+    iter->Seek("a");
+    ASSERT_EQ(IterStatus(iter), "b->vb");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "c->vc");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "(invalid)");
+    delete iter;
+  } while (ChangeOptions());
+}
+
 TEST(DBTest, Recover) {
   do {
     ASSERT_OK(Put("foo", "v1"));
@@ -976,6 +1063,58 @@ TEST(DBTest, RecoverWithLargeLog) {
   ASSERT_GT(NumTableFilesAtLevel(0), 1);
 }
 
+TEST(DBTest, RecoverWithManyTableFiles) {
+  // Leave a log many times as large as the write buffer used when it is
+  // recovered
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000000;
+  Reopen(&options);
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 4000; i++) {
+    values.push_back(RandomString(&rnd, 1000));
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  ASSERT_EQ(0, TotalTableFiles());
+
+  options.write_buffer_size = 100000;
+  Reopen(&options);
+  ASSERT_GT(TotalTableFiles(), 10);
+  for (int i = 0; i < 4000; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+}
+
+TEST(DBTest, PrewarmTables) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000;
+  Reopen(&options);
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 1000; i++) {
+    values.push_back(RandomString(&rnd, 1000));
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  ASSERT_GT(TotalTableFiles(), 1);
+
+  options.prewarm_tables = true;
+  options.prewarm_data_bytes = 1 << 20;
+  Reopen(&options);
+  int done = 0, total = 0;
+  for (int i = 0; i < 1000; i++) {
+    std::string progress;
+    ASSERT_TRUE(db_->GetProperty("leveldb.prewarm-progress", &progress));
+    ASSERT_EQ(2, sscanf(progress.c_str(), "%d/%d", &done, &total));
+    if (done == total) break;
+    env_->SleepForMicroseconds(10000);
+  }
+  ASSERT_GT(total, 1);
+  ASSERT_EQ(total, done);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+}
+
 TEST(DBTest, CompactionsGenerateMultipleFiles) {
   Options options = CurrentOptions();
   options.write_buffer_size = 100000000;        // Large write buffer
@@ -1021,6 +1160,575 @@ TEST(DBTest, RepeatedWritesToSameKey) {
   }
 }
 
+TEST(DBTest, InplaceUpdate) {
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.inplace_update_support = true;
+  options.write_buffer_size = 100000;  // Small write buffer
+  Reopen(&options);
+
+  // Rewriting fixed-size values should not grow the memtable, so no
+  // level-0 table is ever produced.
+  char buf[100];
+  for (int i = 0; i < 10000; i++) {
+    snprintf(buf, sizeof(buf), "%08d", i);
+    ASSERT_OK(Put("counter", buf));
+  }
+  ASSERT_EQ("00009999", Get("counter"));
+  ASSERT_EQ(0, TotalTableFiles());
+
+  // Shorter values are overwritten in place as well; larger values are
+  // appended as a new entry.
+  ASSERT_OK(Put("counter", "short"));
+  ASSERT_EQ("short", Get("counter"));
+  ASSERT_OK(Put("counter", std::string(200, 'x')));
+  ASSERT_EQ(std::string(200, 'x'), Get("counter"));
+
+  // Deleted keys are never resurrected by an in-place update
+  ASSERT_OK(Delete("counter"));
+  ASSERT_OK(Put("counter", "v1"));
+  ASSERT_EQ("v1", Get("counter"));
+
+  Reopen(&options);
+  ASSERT_EQ("v1", Get("counter"));
+  ASSERT_OK(Put("counter", "v2"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ("v2", Get("counter"));
+}
+
+TEST(DBTest, InplaceUpdateWithSnapshot) {
+  Options options = CurrentOptions();
+  options.inplace_update_support = true;
+  Reopen(&options);
+
+  ASSERT_OK(Put("foo", "v1"));
+  const Snapshot* s1 = db_->GetSnapshot();
+  ASSERT_OK(Put("foo", "v2"));
+  ASSERT_OK(Put("foo", "v3"));   // May overwrite "v2", but not "v1"
+  ASSERT_EQ("v1", Get("foo", s1));
+  ASSERT_EQ("v3", Get("foo"));
+  const Snapshot* s2 = db_->GetSnapshot();
+  ASSERT_OK(Put("foo", "v4"));
+  ASSERT_EQ("v1", Get("foo", s1));
+  ASSERT_EQ("v3", Get("foo", s2));
+  ASSERT_EQ("v4", Get("foo"));
+  db_->ReleaseSnapshot(s1);
+  db_->ReleaseSnapshot(s2);
+  ASSERT_EQ("[ v4, v3, v1 ]", AllEntriesFor("foo"));
+}
+
+TEST(DBTest, UniversalCompaction) {
+  Options options = CurrentOptions();
+  options.compaction_style = kCompactionStyleUniversal;
+  options.write_buffer_size = 100000;  // Small write buffer
+  Reopen(&options);
+
+  Random rnd(301);
+  const int kNumKeys = 200;
+  std::vector<std::string> values(kNumKeys);
+  for (int i = 0; i < 20000; i++) {
+    const int k = rnd.Uniform(kNumKeys);
+    if (rnd.OneIn(20)) {
+      ASSERT_OK(Delete(Key(k)));
+      values[k] = "NOT_FOUND";
+    } else {
+      values[k] = RandomString(&rnd, 500);
+      ASSERT_OK(Put(Key(k), values[k]));
+    }
+  }
+  dbfull()->TEST_CompactMemTable();
+
+  // Each level-0 file and each non-empty level is a sorted run
+  int runs = NumTableFilesAtLevel(0);
+  for (int level = 1; level < config::kNumLevels; level++) {
+    if (NumTableFilesAtLevel(level) > 0) runs++;
+  }
+  ASSERT_GT(runs, 0);
+  ASSERT_LE(runs, config::kL0_StopWritesTrigger);
+
+  std::string stats;
+  ASSERT_TRUE(db_->GetProperty("leveldb.stats", &stats));
+  ASSERT_TRUE(stats.find("Write amplification") != std::string::npos);
+
+  for (int pass = 0; pass < 2; pass++) {
+    for (int k = 0; k < kNumKeys; k++) {
+      if (values[k].empty()) continue;
+      ASSERT_EQ(values[k], Get(Key(k)));
+    }
+    Reopen(&options);
+  }
+}
+
+// Write keys [first,first+n) with 1000 byte values, flush them into a
+// level-0 file and wait for the compactions that follow.
+static void MakeSortedRun(DBTest* t, int first, int n) {
+  for (int i = first; i < first + n; i++) {
+    ASSERT_OK(t->Put(Key(i), std::string(1000, 'a' + (i % 26))));
+  }
+  ASSERT_OK(t->dbfull()->TEST_CompactMemTable());
+  ASSERT_OK(t->dbfull()->TEST_WaitForCompactions());
+}
+
+TEST(DBTest, UniversalCompactionPicker) {
+  Options options = CurrentOptions();
+  options.compaction_style = kCompactionStyleUniversal;
+  options.compression = kNoCompression;  // Run sizes follow key counts
+  Reopen(&options);
+
+  // Sorted runs are listed newest first; "s" is a run of 100 keys.
+  // Three runs do not trigger a compaction.
+  MakeSortedRun(this, 0, 100);
+  MakeSortedRun(this, 100, 100);
+  MakeSortedRun(this, 200, 100);
+  ASSERT_EQ("3", FilesPerLevel());
+
+  // [s, s, s, s]: the newer runs are three times the oldest, more than the
+  // allowed size amplification, so everything is merged into the last
+  // level
+  MakeSortedRun(this, 300, 100);
+  ASSERT_EQ("0,0,0,0,0,0,1", FilesPerLevel());
+
+  // [s, s, s, 4s]: the three newest runs have similar sizes and are merged
+  // into the empty level just above the oldest run
+  MakeSortedRun(this, 400, 100);
+  MakeSortedRun(this, 500, 100);
+  ASSERT_EQ("2,0,0,0,0,0,1", FilesPerLevel());
+  MakeSortedRun(this, 600, 100);
+  ASSERT_EQ("0,0,0,0,0,1,1", FilesPerLevel());
+
+  // [s, 2s, 3s, 4s]: no size amplification and no runs of similar size,
+  // but too many runs, so the two newest are merged into the empty level
+  // above the next older run
+  MakeSortedRun(this, 700, 200);
+  ASSERT_EQ("1,0,0,0,0,1,1", FilesPerLevel());
+  MakeSortedRun(this, 900, 100);
+  ASSERT_EQ("0,0,0,0,1,1,1", FilesPerLevel());
+
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_EQ(std::string(1000, 'a' + (i % 26)), Get(Key(i)));
+    }
+    Reopen(&options);
+  }
+}
+
+TEST(DBTest, DynamicLevelBytes) {
+  Options options = CurrentOptions();
+  options.dynamic_level_bytes = true;
+  options.write_buffer_size = 100000;  // Small write buffer
+  Reopen(&options);
+
+  // While the database is smaller than the level-1 target, level-0 is
+  // compacted straight into the last level.
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 1000; i++) {
+    values.push_back(RandomString(&rnd, 1000));
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  dbfull()->TEST_CompactMemTable();
+  for (int i = 0; i < 1000 &&
+           NumTableFilesAtLevel(0) >= config::kL0_CompactionTrigger; i++) {
+    env_->SleepForMicroseconds(10000);
+  }
+  for (int level = 1; level < config::kNumLevels - 1; level++) {
+    ASSERT_EQ(0, NumTableFilesAtLevel(level));
+  }
+  ASSERT_GT(NumTableFilesAtLevel(config::kNumLevels - 1), 0);
+
+  Reopen(&options);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+}
+
+TEST(DBTest, DirectIOForFlushAndCompaction) {
+  Options options = CurrentOptions();
+  options.use_direct_io_for_flush_and_compaction = true;
+  options.write_buffer_size = 100000;  // Small write buffer
+  Reopen(&options);
+
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 500; i++) {
+    values.push_back(RandomString(&rnd, 1000));
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  dbfull()->TEST_CompactMemTable();
+  dbfull()->CompactRange(NULL, NULL);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  for (int i = 0; i < 500; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+
+  Reopen(&options);
+  for (int i = 0; i < 500; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+}
+
+TEST(DBTest, CompactionReadahead) {
+  // Readahead buffers smaller than a block, a few blocks, and most files
+  const size_t kReadaheadSizes[] = { 1000, 10000, 100000 };
+  for (int r = 0; r < 3; r++) {
+    Options options = CurrentOptions();
+    options.compaction_readahead_size = kReadaheadSizes[r];
+    options.create_if_missing = true;
+    options.write_buffer_size = 100000;  // Small write buffer
+    DestroyAndReopen(&options);
+
+    Random rnd(301);
+    std::vector<std::string> values;
+    for (int i = 0; i < 500; i++) {
+      values.push_back(RandomString(&rnd, 1000));
+      ASSERT_OK(Put(Key(i), values[i]));
+    }
+    dbfull()->TEST_CompactMemTable();
+    dbfull()->CompactRange(NULL, NULL);
+
+    // The compaction outputs hold all of the data
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_EQ(Key(i), iter->key().ToString());
+      ASSERT_EQ(values[i], iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(500, i);
+    delete iter;
+  }
+}
+
+TEST(DBTest, IterPrefetch) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.write_buffer_size = 100000;
+  options.max_file_size = 100000;
+  options.block_size = 1024;
+  DestroyAndReopen(&options);
+
+  // Several files in a level, plus files in level-0 and the memtable
+  Random rnd(301);
+  const int kNumKeys = 2000;
+  std::vector<std::string> values(kNumKeys);
+  for (int i = 0; i < kNumKeys; i++) {
+    values[i] = RandomString(&rnd, 500);
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  dbfull()->CompactRange(NULL, NULL);
+  for (int i = 0; i < kNumKeys; i += 7) {
+    values[i] = RandomString(&rnd, 500);
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  ASSERT_GT(TotalTableFiles(), 2);
+
+  for (int prefetch = 1; prefetch <= 8; prefetch *= 2) {
+    ReadOptions read_options;
+    read_options.prefetch_blocks = prefetch;
+    Iterator* iter = db_->NewIterator(read_options);
+
+    // Full forward scan
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_EQ(Key(i), iter->key().ToString());
+      ASSERT_EQ(values[i], iter->value().ToString());
+    }
+    ASSERT_EQ(kNumKeys, i);
+
+    // Short scans from different positions, changing direction midway
+    for (int start = 0; start < kNumKeys; start += 331) {
+      iter->Seek(Key(start));
+      for (i = start; i < start + 100 && i < kNumKeys; i++) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(Key(i), iter->key().ToString());
+        ASSERT_EQ(values[i], iter->value().ToString());
+        iter->Next();
+      }
+      if (iter->Valid()) {
+        for (i--; i >= start; i--) {
+          iter->Prev();
+          ASSERT_EQ(Key(i), iter->key().ToString());
+        }
+      }
+    }
+    ASSERT_OK(iter->status());
+    delete iter;
+  }
+}
+
+TEST(DBTest, GetPinnable) {
+  do {
+    ASSERT_OK(Put("foo", "v1"));
+    ASSERT_OK(Put("bar", std::string(10000, 'b')));
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_OK(Put("baz", "v3"));
+
+    // Values in tables are pinned, values in the memtable are copied
+    PinnableSlice foo, bar, baz, missing;
+    ASSERT_OK(db_->Get(ReadOptions(), "foo", &foo));
+    ASSERT_TRUE(foo.IsPinned());
+    ASSERT_EQ("v1", foo.ToString());
+    ASSERT_OK(db_->Get(ReadOptions(), "bar", &bar));
+    ASSERT_EQ(std::string(10000, 'b'), bar.ToString());
+    ASSERT_OK(db_->Get(ReadOptions(), "baz", &baz));
+    ASSERT_TRUE(!baz.IsPinned());
+    ASSERT_EQ("v3", baz.ToString());
+    ASSERT_TRUE(db_->Get(ReadOptions(), "missing", &missing).IsNotFound());
+    ASSERT_EQ(0, missing.size());
+
+    // Pinned values outlive the files they were read from
+    ASSERT_OK(Put("foo", "v4"));
+    ASSERT_OK(Delete("bar"));
+    dbfull()->TEST_CompactMemTable();
+    dbfull()->CompactRange(NULL, NULL);
+    ASSERT_EQ("v1", foo.ToString());
+    ASSERT_EQ(std::string(10000, 'b'), bar.ToString());
+
+    // Slices can be reused
+    ASSERT_OK(db_->Get(ReadOptions(), "foo", &foo));
+    ASSERT_EQ("v4", foo.ToString());
+    ASSERT_TRUE(db_->Get(ReadOptions(), "bar", &bar).IsNotFound());
+    foo.Reset();
+    ASSERT_TRUE(!foo.IsPinned());
+  } while (ChangeOptions());
+}
+
+TEST(DBTest, Statistics) {
+  Statistics* statistics = CreateDBStatistics();
+  const FilterPolicy* filter_policy = NewBloomFilterPolicy(10);
+  Options options = CurrentOptions();
+  options.filter_policy = filter_policy;
+  options.statistics = statistics;
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+
+  ASSERT_OK(Put("bar", "v1"));
+  ASSERT_OK(Put("foo", "v2"));
+  ASSERT_EQ(2, statistics->GetTickerCount(kNumberKeysWritten));
+  ASSERT_GT(statistics->GetTickerCount(kBytesWritten), 0);
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ(1, statistics->GetTickerCount(kMemtableHit));
+
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_GT(statistics->GetTickerCount(kFlushWriteBytes), 0);
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ(1, statistics->GetTickerCount(kMemtableMiss));
+  ASSERT_EQ(1, statistics->GetTickerCount(kBlockCacheMiss));
+  ASSERT_EQ("v2", Get("foo"));
+  // Blocks read from mmap-ed files are not inserted into the cache
+  ASSERT_EQ(2, statistics->GetTickerCount(kBlockCacheHit) +
+               statistics->GetTickerCount(kBlockCacheMiss));
+  ASSERT_EQ(2, statistics->GetTickerCount(kGetHitL0) +
+               statistics->GetTickerCount(kGetHitL1) +
+               statistics->GetTickerCount(kGetHitL2AndUp));
+  ASSERT_EQ(3, statistics->GetTickerCount(kNumberKeysRead));
+
+  // "baz" falls within the table's key range but is rejected by the filter
+  ASSERT_EQ("NOT_FOUND", Get("baz"));
+  ASSERT_EQ(1, statistics->GetTickerCount(kBloomFilterUseful));
+  ASSERT_EQ(2, statistics->GetTickerCount(kBlockCacheHit) +
+               statistics->GetTickerCount(kBlockCacheMiss));
+
+  std::string property;
+  ASSERT_TRUE(db_->GetProperty("leveldb.statistics", &property));
+  ASSERT_NE(std::string::npos,
+            property.find("leveldb.memtable.hit COUNT : 1\n"));
+  ASSERT_NE(std::string::npos, property.find("leveldb.db.get.micros"));
+
+  statistics->Reset();
+  ASSERT_EQ(0, statistics->GetTickerCount(kMemtableHit));
+
+  Close();
+  delete statistics;
+  delete filter_policy;
+
+  // The property is unavailable without a Statistics object
+  options.statistics = NULL;
+  options.filter_policy = NULL;
+  Reopen(&options);
+  ASSERT_TRUE(!db_->GetProperty("leveldb.statistics", &property));
+}
+
+TEST(DBTest, PerfContext) {
+  const FilterPolicy* filter_policy = NewBloomFilterPolicy(10);
+  Options options = CurrentOptions();
+  options.filter_policy = filter_policy;
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+
+  ASSERT_OK(Put("bar", "v1"));
+  ASSERT_OK(Put("foo", "v2"));
+  dbfull()->TEST_CompactMemTable();
+
+  PerfContext* perf = GetPerfContext();
+  perf->Reset();
+  ASSERT_EQ(kDisablePerf, GetPerfLevel());
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ(0, perf->get_from_memtable_count);
+  ASSERT_EQ(0, perf->get_sst_files_consulted);
+  ASSERT_EQ("", perf->ToString());
+
+  SetPerfLevel(kEnableCount);
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ(1, perf->get_from_memtable_count);
+  ASSERT_EQ(1, perf->get_sst_files_consulted);
+  ASSERT_EQ(1, perf->bloom_filter_checked);
+  ASSERT_EQ(0, perf->bloom_filter_useful);
+  ASSERT_GE(perf->block_read_count + perf->block_cache_hit_count, 1);
+  ASSERT_EQ(0, perf->get_from_output_files_time);
+
+  // "baz" falls within the table's key range but is rejected by the filter
+  perf->Reset();
+  SetPerfLevel(kEnableTime);
+  ASSERT_EQ("NOT_FOUND", Get("baz"));
+  ASSERT_EQ(1, perf->bloom_filter_checked);
+  ASSERT_EQ(1, perf->bloom_filter_useful);
+  ASSERT_GT(perf->get_from_output_files_time, 0);
+  ASSERT_NE(std::string::npos,
+            perf->ToString().find("bloom_filter_useful = 1, "));
+
+  // Iterators count the deleted and overwritten entries they skip
+  ASSERT_OK(Put("a", "v1"));
+  ASSERT_OK(Put("a", "v2"));
+  ASSERT_OK(Put("b", "v1"));
+  ASSERT_OK(Delete("b"));
+  perf->Reset();
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  iter->Seek("a");
+  ASSERT_EQ(IterStatus(iter), "a->v2");
+  iter->Next();
+  ASSERT_EQ(IterStatus(iter), "bar->v1");
+  ASSERT_EQ(1, perf->internal_delete_skipped_count);
+  ASSERT_EQ(2, perf->internal_key_skipped_count);
+  delete iter;
+
+  SetPerfLevel(kDisablePerf);
+  Close();
+  delete filter_policy;
+}
+
+namespace {
+class TestListener : public EventListener {
+ public:
+  TestListener()
+      : flushes_(0),
+        compactions_begun_(0),
+        compactions_completed_(0),
+        files_deleted_(0) {
+  }
+
+  virtual void OnFlushCompleted(DB* db, const FlushJobInfo& info) {
+    CheckUnlocked(db);
+    ASSERT_GT(info.file_size, 0);
+    ASSERT_TRUE(!info.file_path.empty());
+    MutexLock l(&mu_);
+    flushes_++;
+  }
+
+  virtual void OnCompactionBegin(DB* db, const CompactionJobInfo& info) {
+    CheckUnlocked(db);
+    ASSERT_TRUE(!info.input_files.empty());
+    ASSERT_TRUE(info.output_files.empty());
+    MutexLock l(&mu_);
+    compactions_begun_++;
+  }
+
+  virtual void OnCompactionCompleted(DB* db, const CompactionJobInfo& info) {
+    CheckUnlocked(db);
+    ASSERT_OK(info.status);
+    ASSERT_TRUE(!info.input_files.empty());
+    ASSERT_TRUE(!info.output_files.empty());
+    ASSERT_GT(info.bytes_read, 0);
+    ASSERT_GT(info.bytes_written, 0);
+    MutexLock l(&mu_);
+    compactions_completed_++;
+  }
+
+  virtual void OnStallConditionChanged(DB* db, const WriteStallInfo& info) {
+    CheckUnlocked(db);
+    ASSERT_NE(info.condition, info.prev_condition);
+    MutexLock l(&mu_);
+    stalls_.push_back(info.condition);
+  }
+
+  virtual void OnTableFileDeleted(const TableFileDeletionInfo& info) {
+    ASSERT_OK(info.status);
+    MutexLock l(&mu_);
+    files_deleted_++;
+  }
+
+  int flushes() { MutexLock l(&mu_); return flushes_; }
+  int compactions_begun() { MutexLock l(&mu_); return compactions_begun_; }
+  int compactions_completed() {
+    MutexLock l(&mu_);
+    return compactions_completed_;
+  }
+  int files_deleted() { MutexLock l(&mu_); return files_deleted_; }
+  std::vector<WriteStallCondition> stalls() {
+    MutexLock l(&mu_);
+    return stalls_;
+  }
+
+ private:
+  // Would deadlock if the DB mutex was held by the calling thread
+  static void CheckUnlocked(DB* db) {
+    std::string value;
+    ASSERT_TRUE(db->GetProperty("leveldb.num-files-at-level0", &value));
+  }
+
+  port::Mutex mu_;
+  int flushes_;
+  int compactions_begun_;
+  int compactions_completed_;
+  int files_deleted_;
+  std::vector<WriteStallCondition> stalls_;
+};
+
+static void ReleaseSyncs(void* arg) {
+  SpecialEnv* env = reinterpret_cast<SpecialEnv*>(arg);
+  env->SleepForMicroseconds(100000);
+  env->delay_data_sync_.Release_Store(NULL);
+}
+}  // namespace
+
+TEST(DBTest, EventListener) {
+  TestListener listener;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.write_buffer_size = 100000;  // Small write buffer
+  options.listeners.push_back(&listener);
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+
+  ASSERT_OK(Put("a", "v1"));
+  ASSERT_OK(Put("z", "v1"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(1, listener.flushes());
+  ASSERT_OK(Put("a", "v2"));
+  ASSERT_OK(Put("z", "v2"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(2, listener.flushes());
+
+  const int deleted_before = listener.files_deleted();
+  dbfull()->CompactRange(NULL, NULL);
+  ASSERT_GE(listener.compactions_begun(), 1);
+  ASSERT_EQ(listener.compactions_begun(), listener.compactions_completed());
+  ASSERT_GT(listener.files_deleted(), deleted_before);
+
+  // Stop writes while the memtable compaction is blocked
+  ASSERT_TRUE(listener.stalls().empty());
+  env_->delay_data_sync_.Release_Store(env_);
+  ASSERT_OK(Put("k1", std::string(100000, 'x')));    // Fill memtable
+  ASSERT_OK(Put("k2", std::string(100000, 'y')));    // Trigger compaction
+  env_->StartThread(ReleaseSyncs, env_);
+  ASSERT_OK(Put("k3", std::string(100000, 'z')));    // Wait for compaction
+  std::vector<WriteStallCondition> stalls = listener.stalls();
+  ASSERT_EQ(2, stalls.size());
+  ASSERT_EQ(kStallStopped, stalls[0]);
+  ASSERT_EQ(kStallNormal, stalls[1]);
+  Close();
+}
+
 TEST(DBTest, SparseMerge) {
   Options options = CurrentOptions();
   options.compression = kNoCompression;
@@ -1228,6 +1936,9 @@ TEST(DBTest, HiddenValuesAreRemoved) {
   do {
     Random rnd(301);
     FillLevels("a", "z");
+    // Drain level-0 so that no automatic compaction is pending that could
+    // start while the snapshot below is held and preserve the hidden value.
+    dbfull()->TEST_CompactRange(0, NULL, NULL);
 
     std::string big = RandomString(&rnd, 50000);
     Put("foo", big);
@@ -1310,6 +2021,37 @@ TEST(DBTest, DeletionMarkers2) {
   ASSERT_EQ(AllEntriesFor("foo"), "[ ]");
 }
 
+TEST(DBTest, DeletionTriggeredCompaction) {
+  for (int enabled = 0; enabled < 2; enabled++) {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.deletion_compaction_ratio = enabled ? 0.5 : 0;
+    DestroyAndReopen(&options);
+
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_OK(Put(Key(i), "v"));
+    }
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+    ASSERT_EQ("0,0,1", FilesPerLevel());
+
+    // The deletion markers are pushed to level-1, above the live data
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_OK(Delete(Key(i)));
+    }
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+    for (int i = 0; i < 100 && TotalTableFiles() > 1; i++) {
+      DelayMilliseconds(10);
+    }
+    if (enabled) {
+      // Merged into level-2, where both the markers and the data they
+      // delete are dropped
+      ASSERT_EQ("", FilesPerLevel());
+    } else {
+      ASSERT_EQ("0,1,1", FilesPerLevel());
+    }
+  }
+}
+
 TEST(DBTest, OverlapInLevel0) {
   do {
     ASSERT_EQ(config::kMaxMemCompactLevel, 2) << "Fix test to match config";
@@ -1545,6 +2287,183 @@ TEST(DBTest, DBOpen_Options) {
   db = NULL;
 }
 
+TEST(DBTest, Checkpoint) {
+  Options options = CurrentOptions();
+  std::string checkpoint = dbname_ + "_checkpoint";
+  DestroyDB(checkpoint, options);
+
+  ColumnFamilyHandle* one;
+  ASSERT_OK(db_->CreateColumnFamily(options, "one", &one));
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Put("bar", "v1"));
+  ASSERT_OK(db_->Put(WriteOptions(), one, "foo", "one1"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("foo", "v2"));  // Only in the memtable
+  ASSERT_OK(Delete("bar"));
+  ASSERT_OK(db_->Put(WriteOptions(), one, "bar", "one2"));
+  ASSERT_OK(db_->CreateCheckpoint(checkpoint));
+  ASSERT_TRUE(db_->CreateCheckpoint(checkpoint).IsInvalidArgument());
+
+  // Later writes and compactions do not affect the checkpoint
+  ASSERT_OK(Put("foo", "v3"));
+  ASSERT_OK(Put("baz", "v1"));
+  ASSERT_OK(db_->Delete(WriteOptions(), one, "foo"));
+  dbfull()->CompactRange(NULL, NULL);
+  db_->CompactRange(one, NULL, NULL);
+
+  // The column family has a directory of its own in the checkpoint
+  ASSERT_TRUE(env_->FileExists(ColumnFamilyDirName(checkpoint, 1)));
+  DB* db2 = NULL;
+  options.create_if_missing = false;
+  std::vector<ColumnFamilyDescriptor> column_families;
+  column_families.push_back(ColumnFamilyDescriptor("one", options));
+  std::vector<ColumnFamilyHandle*> handles;
+  ASSERT_OK(DB::Open(options, checkpoint, column_families, &handles, &db2));
+  ASSERT_EQ(1, handles.size());
+  std::string value;
+  ASSERT_OK(db2->Get(ReadOptions(), "foo", &value));
+  ASSERT_EQ("v2", value);
+  ASSERT_TRUE(db2->Get(ReadOptions(), "bar", &value).IsNotFound());
+  ASSERT_TRUE(db2->Get(ReadOptions(), "baz", &value).IsNotFound());
+  ASSERT_OK(db2->Get(ReadOptions(), handles[0], "foo", &value));
+  ASSERT_EQ("one1", value);
+  ASSERT_OK(db2->Get(ReadOptions(), handles[0], "bar", &value));
+  ASSERT_EQ("one2", value);
+
+  // Nor do writes to the checkpoint affect the database
+  ASSERT_OK(db2->Put(WriteOptions(), "bar", "v4"));
+  ASSERT_OK(db2->Put(WriteOptions(), handles[0], "baz", "one4"));
+  delete handles[0];
+  delete db2;
+  ASSERT_EQ("v3", Get("foo"));
+  ASSERT_EQ("NOT_FOUND", Get("bar"));
+  ASSERT_EQ("v1", Get("baz"));
+  ASSERT_TRUE(db_->Get(ReadOptions(), one, "foo", &value).IsNotFound());
+  ASSERT_TRUE(db_->Get(ReadOptions(), one, "baz", &value).IsNotFound());
+  delete one;
+  DestroyDB(checkpoint, options);
+}
+
+TEST(DBTest, ColumnFamilies) {
+  Options options = CurrentOptions();
+  std::vector<std::string> names;
+  ASSERT_OK(DB::ListColumnFamilies(options, dbname_, &names));
+  ASSERT_EQ(1, names.size());
+  ASSERT_EQ(kDefaultColumnFamilyName, names[0]);
+
+  ColumnFamilyHandle* one;
+  ColumnFamilyHandle* dup;
+  ASSERT_OK(db_->CreateColumnFamily(options, "one", &one));
+  ASSERT_TRUE(db_->CreateColumnFamily(options, "one", &dup)
+              .IsInvalidArgument());
+  ASSERT_EQ("one", one->GetName());
+  ASSERT_EQ(1, one->GetID());
+  ASSERT_EQ(0, db_->DefaultColumnFamily()->GetID());
+
+  // The key spaces are independent
+  std::string value;
+  ASSERT_OK(Put("foo", "v0"));
+  ASSERT_OK(db_->Put(WriteOptions(), one, "foo", "v1"));
+  ASSERT_OK(db_->Get(ReadOptions(), one, "foo", &value));
+  ASSERT_EQ("v1", value);
+  ASSERT_EQ("v0", Get("foo"));
+  dbfull()->TEST_CompactMemTable();
+
+  // A batch may update several column families
+  WriteBatch batch;
+  batch.Put(one, "bar", "v2");
+  batch.Delete(db_->DefaultColumnFamily(), "foo");
+  ASSERT_OK(db_->Write(WriteOptions(), &batch));
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+  Iterator* iter = db_->NewIterator(ReadOptions(), one);
+  iter->SeekToFirst();
+  ASSERT_EQ("bar->v2", IterStatus(iter));
+  iter->Next();
+  ASSERT_EQ("foo->v1", IterStatus(iter));
+  iter->Next();
+  ASSERT_EQ("(invalid)", IterStatus(iter));
+  delete iter;
+
+  // All column families must be named when reopening
+  delete one;
+  Close();
+  ASSERT_TRUE(DB::Open(options, dbname_, &db_).IsInvalidArgument());
+  std::vector<ColumnFamilyDescriptor> column_families;
+  column_families.push_back(ColumnFamilyDescriptor("two", options));
+  std::vector<ColumnFamilyHandle*> handles;
+  ASSERT_TRUE(DB::Open(options, dbname_, column_families, &handles, &db_)
+              .IsInvalidArgument());
+  column_families[0].name = "one";
+  ASSERT_OK(DB::Open(options, dbname_, column_families, &handles, &db_));
+  ASSERT_EQ(1, handles.size());
+  one = handles[0];
+  ASSERT_OK(db_->Get(ReadOptions(), one, "bar", &value));
+  ASSERT_EQ("v2", value);
+  ASSERT_OK(db_->Get(ReadOptions(), one, "foo", &value));
+  ASSERT_EQ("v1", value);
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+  ASSERT_OK(DB::ListColumnFamilies(options, dbname_, &names));
+  ASSERT_EQ(2, names.size());
+  ASSERT_EQ("one", names[1]);
+
+  // A dropped column family is gone along with its files
+  ASSERT_OK(db_->DropColumnFamily(one));
+  ASSERT_TRUE(db_->Get(ReadOptions(), one, "foo", &value)
+              .IsInvalidArgument());
+  ASSERT_TRUE(db_->DropColumnFamily(db_->DefaultColumnFamily())
+              .IsInvalidArgument());
+  delete one;
+  ASSERT_TRUE(!env_->FileExists(ColumnFamilyDirName(dbname_, 1)));
+  Reopen();
+
+  // Ids are not reused
+  ColumnFamilyHandle* three;
+  ASSERT_OK(db_->CreateColumnFamily(options, "three", &three));
+  ASSERT_EQ(2, three->GetID());
+  delete three;
+}
+
+TEST(DBTest, ColumnFamilyOptions) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000;
+  ColumnFamilyHandle* small;
+  ASSERT_OK(db_->CreateColumnFamily(options, "small", &small));
+
+  // The column family with the small write buffer fills up and is flushed
+  Random rnd(301);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(db_->Put(WriteOptions(), small, Key(i),
+                       RandomString(&rnd, 10000)));
+    ASSERT_OK(Put(Key(i), "v"));
+  }
+  int small_files = 0;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    std::string property;
+    ASSERT_TRUE(db_->GetProperty(
+        small, "leveldb.num-files-at-level" + NumberToString(level),
+        &property));
+    small_files += atoi(property.c_str());
+  }
+  ASSERT_GT(small_files, 0);
+
+  // Recovery from the shared log keeps the updates apart
+  delete small;
+  Close();
+  std::vector<ColumnFamilyDescriptor> column_families;
+  column_families.push_back(ColumnFamilyDescriptor("small", options));
+  std::vector<ColumnFamilyHandle*> handles;
+  ASSERT_OK(DB::Open(CurrentOptions(), dbname_, column_families, &handles,
+                     &db_));
+  small = handles[0];
+  std::string value;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(db_->Get(ReadOptions(), small, Key(i), &value));
+    ASSERT_EQ(10000, value.size());
+    ASSERT_EQ("v", Get(Key(i)));
+  }
+  delete small;
+}
+
 TEST(DBTest, Locking) {
   DB* db2 = NULL;
   Status s = DB::Open(CurrentOptions(), dbname_, &db2);
@@ -38,6 +38,18 @@ static const int kL0_StopWritesTrigger = 12;
 // space if the same key space is being repeatedly overwritten.
 static const int kMaxMemCompactLevel = 2;
 
+// Writes are slowed down once the compactions needed to bring every level
+// under its size limit would have to rewrite this many bytes.
+static const int kPendingCompactionBytesSlowdownTrigger = 256 * 1048576;
+
+// Universal compaction merges a sorted run into the preceding (newer)
+// runs when it is at most this many percent larger than their total size.
+static const int kUniversalSizeRatioPercent = 1;
+
+// Universal compaction merges all sorted runs once the runs other than
+// the oldest one add up to more than this percentage of the oldest run.
+static const int kUniversalMaxSizeAmplificationPercent = 200;
+
 // Approximate gap in bytes between samples of data read during iteration.
 static const int kReadBytesPeriod = 1048576;
 
@@ -0,0 +1,309 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/file_list.h"
+
+#include <algorithm>
+#include "db/version_edit.h"
+
+namespace leveldb {
+
+// Chunks are split when they grow to twice this many files, and merged
+// with a neighbour when they shrink below a quarter of it.
+static const size_t kChunkFiles = 256;
+
+struct FileList::Chunk {
+  int refs;
+  bool holds_files;    // Does the chunk hold references to its files?
+  uint64_t file_size;  // Sum of the sizes of the files
+  std::vector<FileMetaData*> files;
+};
+
+// Orders files by smallest key and then by number, or just by number
+// if icmp is NULL.
+struct FileList::Order {
+  const InternalKeyComparator* icmp;
+
+  bool operator()(const FileMetaData* a, const FileMetaData* b) const {
+    if (icmp != NULL) {
+      int r = icmp->Compare(a->smallest, b->smallest);
+      if (r != 0) {
+        return (r < 0);
+      }
+    }
+    return (a->number < b->number);
+  }
+};
+
+static void UnrefFile(FileMetaData* f) {
+  assert(f->refs > 0);
+  f->refs--;
+  if (f->refs <= 0) {
+    delete f;
+  }
+}
+
+FileList::FileList() : size_(0), total_file_size_(0) {
+}
+
+FileList::FileList(const FileList& other) {
+  CopyFrom(other);
+}
+
+FileList& FileList::operator=(const FileList& other) {
+  if (this != &other) {
+    Clear();
+    CopyFrom(other);
+  }
+  return *this;
+}
+
+FileList::~FileList() {
+  Clear();
+}
+
+void FileList::Clear() {
+  for (size_t i = 0; i < by_key_.size(); i++) {
+    Unref(by_key_[i]);
+  }
+  for (size_t i = 0; i < by_number_.size(); i++) {
+    Unref(by_number_[i]);
+  }
+  by_key_.clear();
+  by_number_.clear();
+  offsets_.clear();
+  size_ = 0;
+  total_file_size_ = 0;
+}
+
+void FileList::CopyFrom(const FileList& other) {
+  by_key_ = other.by_key_;
+  by_number_ = other.by_number_;
+  offsets_ = other.offsets_;
+  size_ = other.size_;
+  total_file_size_ = other.total_file_size_;
+  for (size_t i = 0; i < by_key_.size(); i++) {
+    by_key_[i]->refs++;
+  }
+  for (size_t i = 0; i < by_number_.size(); i++) {
+    by_number_[i]->refs++;
+  }
+}
+
+FileMetaData* FileList::operator[](size_t i) const {
+  assert(i < size_);
+  const size_t c =
+      std::upper_bound(offsets_.begin(), offsets_.end(), i) -
+      offsets_.begin() - 1;
+  return by_key_[c]->files[i - offsets_[c]];
+}
+
+void FileList::AppendTo(std::vector<FileMetaData*>* files) const {
+  files->reserve(files->size() + size_);
+  for (size_t i = 0; i < by_key_.size(); i++) {
+    files->insert(files->end(),
+                  by_key_[i]->files.begin(), by_key_[i]->files.end());
+  }
+}
+
+FileMetaData* FileList::FindByNumber(uint64_t number) const {
+  // Find the last chunk whose first file is not after "number"
+  size_t left = 0;
+  size_t right = by_number_.size();
+  while (left < right) {
+    size_t mid = (left + right) / 2;
+    if (number < by_number_[mid]->files[0]->number) {
+      right = mid;
+    } else {
+      left = mid + 1;
+    }
+  }
+  if (left == 0) {
+    return NULL;
+  }
+  const std::vector<FileMetaData*>& files = by_number_[left - 1]->files;
+  left = 0;
+  right = files.size();
+  while (left < right) {
+    size_t mid = (left + right) / 2;
+    if (files[mid]->number < number) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  if (left < files.size() && files[left]->number == number) {
+    return files[left];
+  }
+  return NULL;
+}
+
+void FileList::Apply(const InternalKeyComparator& icmp,
+                     const std::set<uint64_t>& deleted,
+                     const std::vector<FileMetaData*>& added) {
+  Order by_key;
+  by_key.icmp = &icmp;
+  Order by_number;
+  by_number.icmp = NULL;
+
+  for (std::set<uint64_t>::const_iterator it = deleted.begin();
+       it != deleted.end(); ++it) {
+    FileMetaData* f = FindByNumber(*it);
+    if (f != NULL) {
+      Remove(&by_number_, f, by_number);
+      Remove(&by_key_, f, by_key);  // May delete f
+    }
+  }
+  for (size_t i = 0; i < added.size(); i++) {
+    Insert(&by_key_, added[i], by_key, true);
+    Insert(&by_number_, added[i], by_number, false);
+  }
+
+  offsets_.resize(by_key_.size());
+  size_ = 0;
+  total_file_size_ = 0;
+  for (size_t i = 0; i < by_key_.size(); i++) {
+    offsets_[i] = size_;
+    size_ += by_key_[i]->files.size();
+    total_file_size_ += by_key_[i]->file_size;
+  }
+}
+
+void FileList::Unref(Chunk* chunk) {
+  assert(chunk->refs > 0);
+  chunk->refs--;
+  if (chunk->refs == 0) {
+    if (chunk->holds_files) {
+      for (size_t i = 0; i < chunk->files.size(); i++) {
+        UnrefFile(chunk->files[i]);
+      }
+    }
+    delete chunk;
+  }
+}
+
+FileList::Chunk* FileList::MutableChunk(std::vector<Chunk*>* chunks,
+                                        size_t i) {
+  Chunk* chunk = (*chunks)[i];
+  if (chunk->refs > 1) {
+    // Other lists share the chunk, so change a copy of it
+    Chunk* copy = new Chunk(*chunk);
+    copy->refs = 1;
+    if (copy->holds_files) {
+      for (size_t j = 0; j < copy->files.size(); j++) {
+        copy->files[j]->refs++;
+      }
+    }
+    chunk->refs--;
+    (*chunks)[i] = copy;
+    chunk = copy;
+  }
+  return chunk;
+}
+
+void FileList::MergeChunks(std::vector<Chunk*>* chunks, size_t i) {
+  Chunk* chunk = MutableChunk(chunks, i);
+  Chunk* next = (*chunks)[i + 1];
+  if (chunk->holds_files) {
+    for (size_t j = 0; j < next->files.size(); j++) {
+      next->files[j]->refs++;
+    }
+  }
+  chunk->files.insert(chunk->files.end(),
+                      next->files.begin(), next->files.end());
+  chunk->file_size += next->file_size;
+  Unref(next);
+  chunks->erase(chunks->begin() + i + 1);
+}
+
+size_t FileList::FindChunk(const std::vector<Chunk*>& chunks,
+                           const FileMetaData* f, const Order& order) {
+  // Find the last chunk whose first file is not after "f"
+  size_t left = 0;
+  size_t right = chunks.size();
+  while (left < right) {
+    size_t mid = (left + right) / 2;
+    if (order(f, chunks[mid]->files[0])) {
+      right = mid;
+    } else {
+      left = mid + 1;
+    }
+  }
+  return (left > 0) ? left - 1 : 0;
+}
+
+void FileList::Insert(std::vector<Chunk*>* chunks, FileMetaData* f,
+                      const Order& order, bool holds_files) {
+  if (chunks->empty()) {
+    Chunk* chunk = new Chunk;
+    chunk->refs = 1;
+    chunk->holds_files = holds_files;
+    chunk->file_size = f->file_size;
+    chunk->files.push_back(f);
+    if (holds_files) {
+      f->refs++;
+    }
+    chunks->push_back(chunk);
+    return;
+  }
+
+  const size_t i = FindChunk(*chunks, f, order);
+  Chunk* chunk = MutableChunk(chunks, i);
+  chunk->files.insert(
+      std::upper_bound(chunk->files.begin(), chunk->files.end(), f, order),
+      f);
+  chunk->file_size += f->file_size;
+  if (holds_files) {
+    f->refs++;
+  }
+
+  if (chunk->files.size() >= 2 * kChunkFiles) {
+    // Split the chunk in two halves
+    Chunk* next = new Chunk;
+    next->refs = 1;
+    next->holds_files = holds_files;
+    next->files.assign(chunk->files.begin() + kChunkFiles,
+                       chunk->files.end());
+    next->file_size = 0;
+    for (size_t j = 0; j < next->files.size(); j++) {
+      next->file_size += next->files[j]->file_size;
+    }
+    chunk->files.resize(kChunkFiles);
+    chunk->file_size -= next->file_size;
+    chunks->insert(chunks->begin() + i + 1, next);
+  }
+}
+
+void FileList::Remove(std::vector<Chunk*>* chunks, FileMetaData* f,
+                      const Order& order) {
+  const size_t i = FindChunk(*chunks, f, order);
+  const std::vector<FileMetaData*>& files = (*chunks)[i]->files;
+  const size_t pos =
+      std::lower_bound(files.begin(), files.end(), f, order) - files.begin();
+  assert(pos < files.size() && files[pos] == f);
+
+  Chunk* chunk = MutableChunk(chunks, i);
+  chunk->files.erase(chunk->files.begin() + pos);
+  chunk->file_size -= f->file_size;
+  if (chunk->holds_files) {
+    UnrefFile(f);
+  }
+
+  if (chunk->files.empty()) {
+    Unref(chunk);
+    chunks->erase(chunks->begin() + i);
+  } else if (chunk->files.size() < kChunkFiles / 4) {
+    // Keep the number of chunks proportional to the number of files
+    if (i + 1 < chunks->size() &&
+        chunk->files.size() + (*chunks)[i + 1]->files.size() <= kChunkFiles) {
+      MergeChunks(chunks, i);
+    } else if (i > 0 &&
+               (*chunks)[i - 1]->files.size() + chunk->files.size() <=
+               kChunkFiles) {
+      MergeChunks(chunks, i - 1);
+    }
+  }
+}
+
+}  // namespace leveldb
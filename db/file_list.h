@@ -0,0 +1,94 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A FileList holds the files of one level of a Version, sorted by
+// smallest key (ties are broken by file number).
+//
+// A level may hold a very large number of files, while every edit of the
+// tree changes only a handful of them.  So that building a new Version
+// does not take time proportional to the number of files, a FileList
+// keeps its files in immutable chunks of bounded size that are shared
+// with the list it was copied from.  Copying a list copies just the
+// chunk pointers, and Apply() replaces only the chunks that hold changed
+// files.  A second set of chunks, sorted by file number, finds the files
+// that an edit deletes.
+//
+// A list holds a reference to each of its files.  Copying, modifying and
+// destroying lists requires external synchronization (the same as the
+// reference counts of the files), but a list that is no longer modified
+// may be read by any number of threads.
+
+#ifndef STORAGE_LEVELDB_DB_FILE_LIST_H_
+#define STORAGE_LEVELDB_DB_FILE_LIST_H_
+
+#include <set>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include "db/dbformat.h"
+
+namespace leveldb {
+
+struct FileMetaData;
+
+class FileList {
+ public:
+  FileList();
+  FileList(const FileList& other);
+  FileList& operator=(const FileList& other);
+  ~FileList();
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Return the file at position "i".  Takes time logarithmic in the
+  // number of chunks.
+  // REQUIRES: i < size()
+  FileMetaData* operator[](size_t i) const;
+
+  // Return the sum of the sizes of the files.
+  uint64_t TotalFileSize() const { return total_file_size_; }
+
+  // Append the files in order to *files.
+  void AppendTo(std::vector<FileMetaData*>* files) const;
+
+  // Return the file numbered "number", or NULL if there is none.
+  FileMetaData* FindByNumber(uint64_t number) const;
+
+  // Remove the files whose numbers are in "deleted" and then insert the
+  // files in "added".  Numbers of files that are not in the list are
+  // ignored.  Takes time proportional to the number of changed files
+  // times the chunk size, plus the number of chunks.
+  // REQUIRES: no file in "added" is in the list after the removal.
+  void Apply(const InternalKeyComparator& icmp,
+             const std::set<uint64_t>& deleted,
+             const std::vector<FileMetaData*>& added);
+
+ private:
+  struct Chunk;
+  struct Order;
+
+  static void Unref(Chunk* chunk);
+  static Chunk* MutableChunk(std::vector<Chunk*>* chunks, size_t i);
+  static void MergeChunks(std::vector<Chunk*>* chunks, size_t i);
+  static size_t FindChunk(const std::vector<Chunk*>& chunks,
+                          const FileMetaData* f, const Order& order);
+  static void Insert(std::vector<Chunk*>* chunks, FileMetaData* f,
+                     const Order& order, bool holds_files);
+  static void Remove(std::vector<Chunk*>* chunks, FileMetaData* f,
+                     const Order& order);
+
+  void Clear();
+  void CopyFrom(const FileList& other);
+
+  std::vector<Chunk*> by_key_;      // Chunks holding references to files
+  std::vector<Chunk*> by_number_;   // The same files, sorted by number
+  std::vector<size_t> offsets_;     // Position of the first file of by_key_
+  size_t size_;
+  uint64_t total_file_size_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_FILE_LIST_H_
@@ -0,0 +1,156 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/file_list.h"
+
+#include <algorithm>
+#include <map>
+#include "db/version_edit.h"
+#include "util/logging.h"
+#include "util/random.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class FileListTest {
+ public:
+  InternalKeyComparator icmp_;
+  // The files of the model, by number.  The test holds a reference to
+  // each of them so that they can be checked after the lists are gone.
+  std::map<uint64_t, FileMetaData*> files_;
+
+  FileListTest() : icmp_(BytewiseComparator()) { }
+
+  ~FileListTest() {
+    for (std::map<uint64_t, FileMetaData*>::iterator it = files_.begin();
+         it != files_.end(); ++it) {
+      ASSERT_EQ(1, it->second->refs);
+      delete it->second;
+    }
+  }
+
+  FileMetaData* NewFile(uint64_t number) {
+    FileMetaData* f = new FileMetaData;
+    f->refs = 1;
+    f->number = number;
+    f->file_size = number * 10;
+    // Keys are unrelated to the numbers, so the two orders differ
+    std::string key = NumberToString((number * 7919) % 100003);
+    f->smallest = InternalKey(key, 100, kTypeValue);
+    f->largest = InternalKey(key, 100, kTypeValue);
+    files_[number] = f;
+    return f;
+  }
+
+  // Check "list" against the files of "expected".
+  void Check(const FileList& list, const std::set<uint64_t>& expected) {
+    std::vector<FileMetaData*> want;
+    uint64_t total = 0;
+    for (std::set<uint64_t>::const_iterator it = expected.begin();
+         it != expected.end(); ++it) {
+      want.push_back(files_[*it]);
+      total += files_[*it]->file_size;
+    }
+    std::sort(want.begin(), want.end(), BySmallestKey(&icmp_));
+
+    ASSERT_EQ(want.size(), list.size());
+    ASSERT_EQ(want.empty(), list.empty());
+    ASSERT_EQ(total, list.TotalFileSize());
+    std::vector<FileMetaData*> got;
+    list.AppendTo(&got);
+    ASSERT_TRUE(want == got);
+    for (size_t i = 0; i < want.size(); i++) {
+      ASSERT_TRUE(want[i] == list[i]);
+      ASSERT_TRUE(want[i] == list.FindByNumber(want[i]->number));
+    }
+  }
+
+ private:
+  struct BySmallestKey {
+    const InternalKeyComparator* icmp;
+    explicit BySmallestKey(const InternalKeyComparator* c) : icmp(c) { }
+    bool operator()(FileMetaData* a, FileMetaData* b) const {
+      int r = icmp->Compare(a->smallest, b->smallest);
+      return (r != 0) ? (r < 0) : (a->number < b->number);
+    }
+  };
+};
+
+TEST(FileListTest, Empty) {
+  FileList list;
+  Check(list, std::set<uint64_t>());
+  ASSERT_TRUE(list.FindByNumber(1) == NULL);
+}
+
+TEST(FileListTest, AddAndDelete) {
+  FileList list;
+  std::set<uint64_t> live;
+  Random rnd(301);
+  uint64_t next_number = 1;
+  for (int round = 0; round < 50; round++) {
+    std::set<uint64_t> deleted;
+    std::vector<FileMetaData*> added;
+    const int num_added = rnd.Uniform(200);
+    for (int i = 0; i < num_added; i++) {
+      added.push_back(NewFile(next_number));
+      live.insert(next_number);
+      next_number++;
+    }
+    // Delete fewer files than were added in early rounds so that the list
+    // grows across several chunks, and more in later rounds
+    const int num_deleted = rnd.Uniform(round < 25 ? 100 : 400);
+    for (int i = 0; i < num_deleted && !live.empty(); i++) {
+      std::set<uint64_t>::iterator it =
+          live.lower_bound(1 + rnd.Uniform(next_number));
+      if (it == live.end()) it = live.begin();
+      // Files added by this edit are never deleted by it
+      if (*it >= next_number - num_added) continue;
+      deleted.insert(*it);
+      live.erase(it);
+    }
+    deleted.insert(next_number + 1000);  // Not in the list
+    list.Apply(icmp_, deleted, added);
+    Check(list, live);
+  }
+}
+
+TEST(FileListTest, CopyOnWrite) {
+  FileList base;
+  std::set<uint64_t> base_files;
+  std::vector<FileMetaData*> added;
+  for (uint64_t number = 1; number <= 2000; number++) {
+    added.push_back(NewFile(number));
+    base_files.insert(number);
+  }
+  base.Apply(icmp_, std::set<uint64_t>(), added);
+  Check(base, base_files);
+
+  // Changing a copy leaves the original alone
+  FileList copy = base;
+  std::set<uint64_t> copy_files = base_files;
+  std::set<uint64_t> deleted;
+  for (uint64_t number = 1; number <= 2000; number += 3) {
+    deleted.insert(number);
+    copy_files.erase(number);
+  }
+  added.clear();
+  added.push_back(NewFile(2001));
+  copy_files.insert(2001);
+  copy.Apply(icmp_, deleted, added);
+  Check(copy, copy_files);
+  Check(base, base_files);
+
+  // And the other way around
+  FileList other;
+  other = copy;
+  base.Apply(icmp_, base_files, std::vector<FileMetaData*>());
+  Check(base, std::set<uint64_t>());
+  Check(other, copy_files);
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
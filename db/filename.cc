@@ -69,6 +69,30 @@ std::string OldInfoLogFileName(const std::string& dbname) {
   return dbname + "/LOG.old";
 }
 
+std::string ColumnFamilyDirName(const std::string& dbname, uint32_t id) {
+  assert(id > 0);
+  char buf[100];
+  snprintf(buf, sizeof(buf), "/cf-%06u", static_cast<unsigned int>(id));
+  return dbname + buf;
+}
+
+// Column family directories have the form:
+//    dbname/cf-[0-9]+
+bool ParseColumnFamilyDirName(const std::string& fname, uint32_t* id) {
+  Slice rest(fname);
+  if (!rest.starts_with("cf-")) {
+    return false;
+  }
+  rest.remove_prefix(3);
+  uint64_t num;
+  if (!ConsumeDecimalNumber(&rest, &num) || !rest.empty() ||
+      num == 0 || num > 0xffffffffu) {
+    return false;
+  }
+  *id = static_cast<uint32_t>(num);
+  return true;
+}
+
 
 // Owned filenames have the form:
 //    dbname/CURRENT
@@ -67,6 +67,17 @@ extern std::string InfoLogFileName(const std::string& dbname);
 // Return the name of the old info log file for "dbname".
 extern std::string OldInfoLogFileName(const std::string& dbname);
 
+// Return the name of the directory that holds the files of the column
+// family with the specified id in the db named by "dbname".  The result
+// will be prefixed with "dbname".
+extern std::string ColumnFamilyDirName(const std::string& dbname,
+                                       uint32_t id);
+
+// If filename names a column family directory, store its id in *id and
+// return true.  Else return false.
+extern bool ParseColumnFamilyDirName(const std::string& filename,
+                                     uint32_t* id);
+
 // If filename is a leveldb file, store the type of the file in *type.
 // The number encoded in the filename is stored in *number.  If the
 // filename was successfully parsed, returns true.  Else return false.
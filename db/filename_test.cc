@@ -114,6 +114,17 @@ TEST(FileNameTest, Construction) {
   ASSERT_TRUE(ParseFileName(fname.c_str() + 4, &number, &type));
   ASSERT_EQ(999, number);
   ASSERT_EQ(kTempFile, type);
+
+  uint32_t id;
+  fname = ColumnFamilyDirName("foo", 7);
+  ASSERT_EQ("foo/", std::string(fname.data(), 4));
+  ASSERT_TRUE(ParseColumnFamilyDirName(fname.c_str() + 4, &id));
+  ASSERT_EQ(7, id);
+  ASSERT_TRUE(!ParseFileName(fname.c_str() + 4, &number, &type));
+  ASSERT_TRUE(!ParseColumnFamilyDirName("cf-", &id));
+  ASSERT_TRUE(!ParseColumnFamilyDirName("cf-0", &id));
+  ASSERT_TRUE(!ParseColumnFamilyDirName("cf-12x", &id));
+  ASSERT_TRUE(!ParseColumnFamilyDirName("000012.ldb", &id));
 }
 
 }  // namespace leveldb
@@ -8,6 +8,8 @@
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
 #include "util/coding.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
@@ -18,14 +20,27 @@ static Slice GetLengthPrefixedSlice(const char* data) {
   return Slice(p, len);
 }
 
-MemTable::MemTable(const InternalKeyComparator& cmp)
+MemTable::MemTable(const InternalKeyComparator& cmp, bool inplace_update)
     : comparator_(cmp),
       refs_(0),
-      table_(comparator_, &arena_) {
+      table_(comparator_, &arena_),
+      update_locks_(inplace_update ? new port::Mutex[kNumUpdateLocks] : NULL) {
 }
 
 MemTable::~MemTable() {
   assert(refs_ == 0);
+  delete[] update_locks_;
+}
+
+bool MemTable::IsEmpty() const {
+  Table::Iterator iter(&table_);
+  iter.SeekToFirst();
+  return !iter.Valid();
+}
+
+port::Mutex* MemTable::UpdateLock(const Slice& user_key) {
+  return &update_locks_[Hash(user_key.data(), user_key.size(), 0) %
+                        kNumUpdateLocks];
 }
 
 size_t MemTable::ApproximateMemoryUsage() { return arena_.MemoryUsage(); }
@@ -50,7 +65,7 @@ static const char* EncodeKey(std::string* scratch, const Slice& target) {
 
 class MemTableIterator: public Iterator {
  public:
-  explicit MemTableIterator(MemTable::Table* table) : iter_(table) { }
+  explicit MemTableIterator(MemTable* mem) : mem_(mem), iter_(&mem->table_) { }
 
   virtual bool Valid() const { return iter_.Valid(); }
   virtual void Seek(const Slice& k) { iter_.Seek(EncodeKey(&tmp_, k)); }
@@ -61,14 +76,25 @@ class MemTableIterator: public Iterator {
   virtual Slice key() const { return GetLengthPrefixedSlice(iter_.key()); }
   virtual Slice value() const {
     Slice key_slice = GetLengthPrefixedSlice(iter_.key());
-    return GetLengthPrefixedSlice(key_slice.data() + key_slice.size());
+    if (mem_->update_locks_ == NULL) {
+      return GetLengthPrefixedSlice(key_slice.data() + key_slice.size());
+    }
+    // Update() may rewrite the value at any time, so return a copy that
+    // was taken under its lock.
+    Slice user_key(key_slice.data(), key_slice.size() - 8);
+    MutexLock l(mem_->UpdateLock(user_key));
+    Slice v = GetLengthPrefixedSlice(key_slice.data() + key_slice.size());
+    value_.assign(v.data(), v.size());
+    return value_;
   }
 
   virtual Status status() const { return Status::OK(); }
 
  private:
+  MemTable* mem_;
   MemTable::Table::Iterator iter_;
   std::string tmp_;       // For passing to EncodeKey
+  mutable std::string value_;  // Copy of the value with in-place updates
 
   // No copying allowed
   MemTableIterator(const MemTableIterator&);
@@ -76,7 +102,7 @@ class MemTableIterator: public Iterator {
 };
 
 Iterator* MemTable::NewIterator() {
-  return new MemTableIterator(&table_);
+  return new MemTableIterator(this);
 }
 
 void MemTable::Add(SequenceNumber s, ValueType type,
@@ -105,6 +131,48 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   table_.Insert(buf);
 }
 
+bool MemTable::Update(const Slice& key, const Slice& value,
+                      SequenceNumber min_sequence) {
+  assert(update_locks_ != NULL);
+  LookupKey lkey(key, kMaxSequenceNumber);
+  Table::Iterator iter(&table_);
+  iter.Seek(lkey.memtable_key().data());
+  if (!iter.Valid()) {
+    return false;
+  }
+
+  // The first entry at or after (key, kMaxSequenceNumber) is the newest
+  // entry for key if the memtable holds one.  See Get() for the format.
+  const char* entry = iter.key();
+  uint32_t key_length;
+  const char* key_ptr = GetVarint32Ptr(entry, entry+5, &key_length);
+  if (comparator_.comparator.user_comparator()->Compare(
+          Slice(key_ptr, key_length - 8), key) != 0) {
+    return false;
+  }
+  const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+  if (static_cast<ValueType>(tag & 0xff) != kTypeValue ||
+      (tag >> 8) < min_sequence) {
+    return false;
+  }
+
+  // Only overwrite if the new value fits and its length prefix has the
+  // same encoded size, so that nothing after the prefix has to move.
+  char* len_ptr = const_cast<char*>(key_ptr) + key_length;
+  uint32_t old_size;
+  char* val_ptr = const_cast<char*>(
+      GetVarint32Ptr(len_ptr, len_ptr + 5, &old_size));
+  const uint32_t new_size = static_cast<uint32_t>(value.size());
+  if (new_size > old_size || VarintLength(new_size) != VarintLength(old_size)) {
+    return false;
+  }
+
+  MutexLock l(UpdateLock(key));
+  EncodeVarint32(len_ptr, new_size);
+  memcpy(val_ptr, value.data(), new_size);
+  return true;
+}
+
 bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
   Slice memkey = key.memtable_key();
   Table::Iterator iter(&table_);
@@ -129,8 +197,14 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
       const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
       switch (static_cast<ValueType>(tag & 0xff)) {
         case kTypeValue: {
-          Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
-          value->assign(v.data(), v.size());
+          if (update_locks_ != NULL) {
+            MutexLock l(UpdateLock(key.user_key()));
+            Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+            value->assign(v.data(), v.size());
+          } else {
+            Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+            value->assign(v.data(), v.size());
+          }
           return true;
         }
         case kTypeDeletion:
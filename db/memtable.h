@@ -9,6 +9,7 @@
 #include "leveldb/db.h"
 #include "db/dbformat.h"
 #include "db/skiplist.h"
+#include "port/port.h"
 #include "util/arena.h"
 
 namespace leveldb {
@@ -21,7 +22,12 @@ class MemTable {
  public:
   // MemTables are reference counted.  The initial reference count
   // is zero and the caller must call Ref() at least once.
-  explicit MemTable(const InternalKeyComparator& comparator);
+  //
+  // If "inplace_update" is true the memtable supports Update() and
+  // synchronizes Get() and the values read by its iterators against
+  // concurrent in-place overwrites.
+  explicit MemTable(const InternalKeyComparator& comparator,
+                    bool inplace_update = false);
 
   // Increase reference count.
   void Ref() { ++refs_; }
@@ -39,6 +45,10 @@ class MemTable {
   // data structure. It is safe to call when MemTable is being modified.
   size_t ApproximateMemoryUsage();
 
+  // Returns true iff no entry has been added to the memtable.  It is safe
+  // to call when MemTable is being modified.
+  bool IsEmpty() const;
+
   // Return an iterator that yields the contents of the memtable.
   //
   // The caller must ensure that the underlying MemTable remains live
@@ -54,6 +64,17 @@ class MemTable {
            const Slice& key,
            const Slice& value);
 
+  // If the newest entry for key is a value with sequence number
+  // >= min_sequence, and the new value fits in the space of the old one,
+  // overwrite the old value in place and return true.  The entry keeps
+  // its original sequence number.  Else, return false and leave the
+  // memtable unchanged; the caller should then Add() the value.
+  //
+  // REQUIRES: the memtable was constructed with inplace_update == true.
+  // REQUIRES: external synchronization against Add() and Update().
+  bool Update(const Slice& key, const Slice& value,
+              SequenceNumber min_sequence);
+
   // If memtable contains a value for key, store it in *value and return true.
   // If memtable contains a deletion for key, store a NotFound() error
   // in *status and return true.
@@ -73,10 +94,16 @@ class MemTable {
 
   typedef SkipList<const char*, KeyComparator> Table;
 
+  // Update() rewrites value bytes that concurrent readers may be copying,
+  // so both sides hold the lock chosen by hashing the user key.
+  enum { kNumUpdateLocks = 16 };
+  port::Mutex* UpdateLock(const Slice& user_key);
+
   KeyComparator comparator_;
   int refs_;
   Arena arena_;
   Table table_;
+  port::Mutex* update_locks_;  // NULL unless in-place updates are enabled
 
   // No copying allowed
   MemTable(const MemTable&);
@@ -8,6 +8,7 @@
 #include "leveldb/env.h"
 #include "leveldb/table.h"
 #include "util/coding.h"
+#include "util/readahead_file.h"
 
 namespace leveldb {
 
@@ -23,6 +24,15 @@ static void DeleteEntry(const Slice& key, void* value) {
   delete tf;
 }
 
+static void DeleteTableAndFile(void* arg1, void* arg2) {
+  delete reinterpret_cast<Table*>(arg1);
+  delete reinterpret_cast<RandomAccessFile*>(arg2);
+}
+
+static void DeleteReadaheadFile(void* arg1, void* arg2) {
+  delete reinterpret_cast<RandomAccessFile*>(arg1);
+}
+
 static void UnrefEntry(void* arg1, void* arg2) {
   Cache* cache = reinterpret_cast<Cache*>(arg1);
   Cache::Handle* h = reinterpret_cast<Cache::Handle*>(arg2);
@@ -35,18 +45,39 @@ TableCache::TableCache(const std::string& dbname,
     : env_(options->env),
       dbname_(dbname),
       options_(options),
-      cache_(NewLRUCache(entries)) {
+      cache_(NewLRUCache(entries)),
+      owns_cache_(true),
+      id_(0) {
+}
+
+TableCache::TableCache(const std::string& dbname,
+                       const Options* options,
+                       Cache* cache,
+                       uint32_t id)
+    : env_(options->env),
+      dbname_(dbname),
+      options_(options),
+      cache_(cache),
+      owns_cache_(false),
+      id_(id) {
 }
 
 TableCache::~TableCache() {
-  delete cache_;
+  if (owns_cache_) {
+    delete cache_;
+  }
+}
+
+void TableCache::EncodeKey(uint64_t file_number, char* buf) const {
+  EncodeFixed64(buf, file_number);
+  EncodeFixed32(buf + 8, id_);
 }
 
 Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
                              Cache::Handle** handle) {
   Status s;
-  char buf[sizeof(file_number)];
-  EncodeFixed64(buf, file_number);
+  char buf[kKeySize];
+  EncodeKey(file_number, buf);
   Slice key(buf, sizeof(buf));
   *handle = cache_->Lookup(key);
   if (*handle == NULL) {
@@ -93,34 +124,105 @@ Iterator* TableCache::NewIterator(const ReadOptions& options,
     return NewErrorIterator(s);
   }
 
-  Table* table = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
-  Iterator* result = table->NewIterator(options);
+  TableAndFile* tf = reinterpret_cast<TableAndFile*>(cache_->Value(handle));
+  Iterator* result = tf->table->NewIterator(options);
   result->RegisterCleanup(&UnrefEntry, cache_, handle);
   if (tableptr != NULL) {
-    *tableptr = table;
+    *tableptr = tf->table;
   }
   return result;
 }
 
+Iterator* TableCache::NewCompactionIterator(const ReadOptions& options,
+                                            uint64_t file_number,
+                                            uint64_t file_size) {
+  if (!options_->use_direct_io_for_flush_and_compaction) {
+    if (options_->compaction_readahead_size == 0) {
+      return NewIterator(options, file_number, file_size);
+    }
+
+    // Read the data blocks through a readahead buffer that belongs to this
+    // iterator.  The index and filter blocks of the cached table are still
+    // used; the cache handle keeps the file open.
+    Cache::Handle* handle = NULL;
+    Status s = FindTable(file_number, file_size, &handle);
+    if (!s.ok()) {
+      return NewErrorIterator(s);
+    }
+    TableAndFile* tf =
+        reinterpret_cast<TableAndFile*>(cache_->Value(handle));
+    RandomAccessFile* file = NewReadaheadRandomAccessFile(
+        tf->file, file_size, options_->compaction_readahead_size);
+    Iterator* result = tf->table->NewIterator(options, file);
+    result->RegisterCleanup(&DeleteReadaheadFile, file, NULL);
+    result->RegisterCleanup(&UnrefEntry, cache_, handle);
+    return result;
+  }
+
+  std::string fname = TableFileName(dbname_, file_number);
+  RandomAccessFile* file = NULL;
+  Table* table = NULL;
+  Status s = env_->NewDirectRandomAccessFile(fname, &file);
+  if (!s.ok()) {
+    std::string old_fname = SSTTableFileName(dbname_, file_number);
+    if (env_->NewDirectRandomAccessFile(old_fname, &file).ok()) {
+      s = Status::OK();
+    }
+  }
+  if (s.ok()) {
+    s = Table::Open(*options_, file, file_size, &table);
+  }
+  if (!s.ok()) {
+    assert(table == NULL);
+    delete file;
+    return NewErrorIterator(s);
+  }
+
+  Iterator* result = table->NewIterator(options);
+  result->RegisterCleanup(&DeleteTableAndFile, table, file);
+  return result;
+}
+
 Status TableCache::Get(const ReadOptions& options,
                        uint64_t file_number,
                        uint64_t file_size,
                        const Slice& k,
                        void* arg,
-                       void (*saver)(void*, const Slice&, const Slice&)) {
+                       void (*saver)(void*, const Slice&, const Slice&),
+                       Cleanable* pin) {
   Cache::Handle* handle = NULL;
   Status s = FindTable(file_number, file_size, &handle);
   if (s.ok()) {
     Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
-    s = t->InternalGet(options, k, arg, saver);
+    s = t->InternalGet(options, k, arg, saver, pin);
+    if (pin != NULL) {
+      // Blocks read from a memory-mapped file point into the mapping,
+      // which lives as long as the table is cached.
+      pin->RegisterCleanup(&UnrefEntry, cache_, handle);
+    } else {
+      cache_->Release(handle);
+    }
+  }
+  return s;
+}
+
+Status TableCache::Prewarm(uint64_t file_number, uint64_t file_size,
+                           uint64_t data_bytes) {
+  Cache::Handle* handle = NULL;
+  Status s = FindTable(file_number, file_size, &handle);
+  if (s.ok()) {
+    if (data_bytes > 0) {
+      Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+      t->LoadDataBlocks(data_bytes);
+    }
     cache_->Release(handle);
   }
   return s;
 }
 
 void TableCache::Evict(uint64_t file_number) {
-  char buf[sizeof(file_number)];
-  EncodeFixed64(buf, file_number);
+  char buf[kKeySize];
+  EncodeKey(file_number, buf);
   cache_->Erase(Slice(buf, sizeof(buf)));
 }
 
@@ -21,6 +21,15 @@ class Env;
 class TableCache {
  public:
   TableCache(const std::string& dbname, const Options* options, int entries);
+
+  // Keep the open tables in "cache", which may be shared by several
+  // TableCaches so that they share one limit on the number of open
+  // files.  "id" tells the entries of the sharing TableCaches apart and
+  // must be unique among them.  Does not take ownership of "cache"; the
+  // caller should Evict() the tables it no longer needs.
+  TableCache(const std::string& dbname, const Options* options,
+             Cache* cache, uint32_t id);
+
   ~TableCache();
 
   // Return an iterator for the specified file number (the corresponding
@@ -35,14 +44,34 @@ class TableCache {
                         uint64_t file_size,
                         Table** tableptr = NULL);
 
+  // Return an iterator for reading the specified file as a compaction
+  // input.  If options.use_direct_io_for_flush_and_compaction is set, the
+  // file is opened with Env::NewDirectRandomAccessFile() outside of the
+  // cache and closed when the iterator is deleted, so that compactions do
+  // not evict data cached by the operating system for foreground reads.
+  // Otherwise the cached table is used, and its data blocks are read
+  // through a buffer of Options::compaction_readahead_size bytes unless
+  // that is zero.
+  Iterator* NewCompactionIterator(const ReadOptions& options,
+                                  uint64_t file_number,
+                                  uint64_t file_size);
+
   // If a seek to internal key "k" in specified file finds an entry,
-  // call (*handle_result)(arg, found_key, found_value).
+  // call (*handle_result)(arg, found_key, found_value).  If "pin" is
+  // non-NULL and an entry is found, the entry's memory stays valid until
+  // "pin" runs its cleanups.
   Status Get(const ReadOptions& options,
              uint64_t file_number,
              uint64_t file_size,
              const Slice& k,
              void* arg,
-             void (*handle_result)(void*, const Slice&, const Slice&));
+             void (*handle_result)(void*, const Slice&, const Slice&),
+             Cleanable* pin);
+
+  // Open the specified file unless it is already open, and read up to
+  // "data_bytes" bytes of its data blocks into the block cache.
+  Status Prewarm(uint64_t file_number, uint64_t file_size,
+                 uint64_t data_bytes);
 
   // Evict any entry for the specified file number
   void Evict(uint64_t file_number);
@@ -52,6 +81,11 @@ class TableCache {
   const std::string dbname_;
   const Options* options_;
   Cache* cache_;
+  const bool owns_cache_;
+  const uint32_t id_;
+
+  enum { kKeySize = 12 };
+  void EncodeKey(uint64_t file_number, char* buf) const;
 
   Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**);
 };
@@ -20,7 +20,11 @@ enum Tag {
   kDeletedFile          = 6,
   kNewFile              = 7,
   // 8 was used for large value refs
-  kPrevLogNumber        = 9
+  kPrevLogNumber        = 9,
+  kColumnFamily         = 10,
+  kDropColumnFamily     = 11,
+  kMaxColumnFamily      = 12,
+  kNewFileWithStats     = 13
 };
 
 void VersionEdit::Clear() {
@@ -29,13 +33,18 @@ void VersionEdit::Clear() {
   prev_log_number_ = 0;
   last_sequence_ = 0;
   next_file_number_ = 0;
+  max_column_family_ = 0;
   has_comparator_ = false;
   has_log_number_ = false;
   has_prev_log_number_ = false;
   has_next_file_number_ = false;
   has_last_sequence_ = false;
+  has_max_column_family_ = false;
+  file_stats_ = false;
   deleted_files_.clear();
   new_files_.clear();
+  new_column_families_.clear();
+  dropped_column_families_.clear();
 }
 
 void VersionEdit::EncodeTo(std::string* dst) const {
@@ -76,12 +85,32 @@ void VersionEdit::EncodeTo(std::string* dst) const {
 
   for (size_t i = 0; i < new_files_.size(); i++) {
     const FileMetaData& f = new_files_[i].second;
-    PutVarint32(dst, kNewFile);
+    // Files with unknown entry counts use the older, shorter record
+    const bool has_stats = (file_stats_ && f.num_entries > 0);
+    PutVarint32(dst, has_stats ? kNewFileWithStats : kNewFile);
     PutVarint32(dst, new_files_[i].first);  // level
     PutVarint64(dst, f.number);
     PutVarint64(dst, f.file_size);
     PutLengthPrefixedSlice(dst, f.smallest.Encode());
     PutLengthPrefixedSlice(dst, f.largest.Encode());
+    if (has_stats) {
+      PutVarint64(dst, f.num_entries);
+      PutVarint64(dst, f.num_deletions);
+    }
+  }
+
+  if (has_max_column_family_) {
+    PutVarint32(dst, kMaxColumnFamily);
+    PutVarint32(dst, max_column_family_);
+  }
+  for (size_t i = 0; i < new_column_families_.size(); i++) {
+    PutVarint32(dst, kColumnFamily);
+    PutVarint32(dst, new_column_families_[i].first);
+    PutLengthPrefixedSlice(dst, new_column_families_[i].second);
+  }
+  for (size_t i = 0; i < dropped_column_families_.size(); i++) {
+    PutVarint32(dst, kDropColumnFamily);
+    PutVarint32(dst, dropped_column_families_[i]);
   }
 }
 
@@ -115,6 +144,7 @@ Status VersionEdit::DecodeFrom(const Slice& src) {
   // Temporary storage for parsing
   int level;
   uint64_t number;
+  uint32_t id;
   FileMetaData f;
   Slice str;
   InternalKey key;
@@ -192,6 +222,48 @@ Status VersionEdit::DecodeFrom(const Slice& src) {
         }
         break;
 
+      case kNewFileWithStats:
+        if (GetLevel(&input, &level) &&
+            GetVarint64(&input, &f.number) &&
+            GetVarint64(&input, &f.file_size) &&
+            GetInternalKey(&input, &f.smallest) &&
+            GetInternalKey(&input, &f.largest) &&
+            GetVarint64(&input, &f.num_entries) &&
+            GetVarint64(&input, &f.num_deletions)) {
+          new_files_.push_back(std::make_pair(level, f));
+          f.num_entries = 0;
+          f.num_deletions = 0;
+          file_stats_ = true;
+        } else {
+          msg = "new-file entry";
+        }
+        break;
+
+      case kColumnFamily:
+        if (GetVarint32(&input, &id) &&
+            GetLengthPrefixedSlice(&input, &str)) {
+          new_column_families_.push_back(std::make_pair(id, str.ToString()));
+        } else {
+          msg = "column family";
+        }
+        break;
+
+      case kDropColumnFamily:
+        if (GetVarint32(&input, &id)) {
+          dropped_column_families_.push_back(id);
+        } else {
+          msg = "dropped column family";
+        }
+        break;
+
+      case kMaxColumnFamily:
+        if (GetVarint32(&input, &max_column_family_)) {
+          has_max_column_family_ = true;
+        } else {
+          msg = "max column family";
+        }
+        break;
+
       default:
         msg = "unknown tag";
         break;
@@ -258,6 +330,26 @@ std::string VersionEdit::DebugString() const {
     r.append(f.smallest.DebugString());
     r.append(" .. ");
     r.append(f.largest.DebugString());
+    if (f.num_entries > 0) {
+      r.append(" entries: ");
+      AppendNumberTo(&r, f.num_entries);
+      r.append(" deletions: ");
+      AppendNumberTo(&r, f.num_deletions);
+    }
+  }
+  if (has_max_column_family_) {
+    r.append("\n  MaxColumnFamily: ");
+    AppendNumberTo(&r, max_column_family_);
+  }
+  for (size_t i = 0; i < new_column_families_.size(); i++) {
+    r.append("\n  ColumnFamily: ");
+    AppendNumberTo(&r, new_column_families_[i].first);
+    r.append(" ");
+    r.append(new_column_families_[i].second);
+  }
+  for (size_t i = 0; i < dropped_column_families_.size(); i++) {
+    r.append("\n  DropColumnFamily: ");
+    AppendNumberTo(&r, dropped_column_families_[i]);
   }
   r.append("\n}\n");
   return r;
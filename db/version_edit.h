@@ -21,8 +21,12 @@ struct FileMetaData {
   uint64_t file_size;         // File size in bytes
   InternalKey smallest;       // Smallest internal key served by table
   InternalKey largest;        // Largest internal key served by table
+  uint64_t num_entries;       // Entries in the table; 0 if unknown
+  uint64_t num_deletions;     // Deletion markers among num_entries
 
-  FileMetaData() : refs(0), allowed_seeks(1 << 30), file_size(0) { }
+  FileMetaData()
+      : refs(0), allowed_seeks(1 << 30), file_size(0),
+        num_entries(0), num_deletions(0) { }
 };
 
 class VersionEdit {
@@ -71,11 +75,46 @@ class VersionEdit {
     new_files_.push_back(std::make_pair(level, f));
   }
 
+  // Add the file described by "f", including its entry counts, at the
+  // specified level.  The counts are only encoded if SetFileStats(true)
+  // was called.
+  // REQUIRES: This version has not been saved (see VersionSet::SaveTo)
+  void AddFile(int level, const FileMetaData& f) {
+    AddFile(level, f.number, f.file_size, f.smallest, f.largest);
+    new_files_.back().second.num_entries = f.num_entries;
+    new_files_.back().second.num_deletions = f.num_deletions;
+  }
+
   // Delete the specified "file" from the specified "level".
   void DeleteFile(int level, uint64_t file) {
     deleted_files_.insert(std::make_pair(level, file));
   }
 
+  // Record the creation of the column family "name" with the given id.
+  // Only used in the descriptor of the default column family.
+  void AddColumnFamily(uint32_t id, const std::string& name) {
+    new_column_families_.push_back(std::make_pair(id, name));
+  }
+
+  // Record that the column family with the given id was dropped.
+  void DropColumnFamily(uint32_t id) {
+    dropped_column_families_.push_back(id);
+  }
+
+  // Record the largest column family id ever used, so that ids of
+  // dropped column families are not reused.
+  void SetMaxColumnFamily(uint32_t id) {
+    has_max_column_family_ = true;
+    max_column_family_ = id;
+  }
+
+  // Encode the entry counts of new files.  Off by default, since older
+  // versions of leveldb cannot read the records that hold them.  Decoding
+  // an edit that holds such records turns it on.
+  void SetFileStats(bool file_stats) {
+    file_stats_ = file_stats;
+  }
+
   void EncodeTo(std::string* dst) const;
   Status DecodeFrom(const Slice& src);
 
@@ -91,15 +130,20 @@ class VersionEdit {
   uint64_t prev_log_number_;
   uint64_t next_file_number_;
   SequenceNumber last_sequence_;
+  uint32_t max_column_family_;
   bool has_comparator_;
   bool has_log_number_;
   bool has_prev_log_number_;
   bool has_next_file_number_;
   bool has_last_sequence_;
+  bool has_max_column_family_;
+  bool file_stats_;
 
   std::vector< std::pair<int, InternalKey> > compact_pointers_;
   DeletedFileSet deleted_files_;
   std::vector< std::pair<int, FileMetaData> > new_files_;
+  std::vector< std::pair<uint32_t, std::string> > new_column_families_;
+  std::vector<uint32_t> dropped_column_families_;
 };
 
 }  // namespace leveldb
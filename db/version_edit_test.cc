@@ -37,6 +37,35 @@ TEST(VersionEditTest, EncodeDecode) {
   edit.SetNextFile(kBig + 200);
   edit.SetLastSequence(kBig + 1000);
   TestEncodeDecode(edit);
+
+  edit.AddColumnFamily(7, "seven");
+  edit.DropColumnFamily(5);
+  edit.SetMaxColumnFamily(7);
+  TestEncodeDecode(edit);
+
+  // Files with entry counts interleaved with files without them
+  edit.SetFileStats(true);
+  FileMetaData f;
+  f.number = kBig + 800;
+  f.file_size = kBig + 801;
+  f.smallest = InternalKey("bar", kBig + 802, kTypeDeletion);
+  f.largest = InternalKey("baz", kBig + 803, kTypeValue);
+  f.num_entries = kBig + 804;
+  f.num_deletions = kBig + 805;
+  edit.AddFile(5, f);
+  edit.AddFile(5, kBig + 806, kBig + 807,
+               InternalKey("qux", kBig + 808, kTypeValue),
+               InternalKey("quz", kBig + 809, kTypeValue));
+  TestEncodeDecode(edit);
+
+  // Without SetFileStats(true) the counts are not encoded
+  VersionEdit plain;
+  plain.AddFile(5, f);
+  std::string encoded;
+  plain.EncodeTo(&encoded);
+  VersionEdit parsed;
+  ASSERT_OK(parsed.DecodeFrom(encoded));
+  ASSERT_EQ(std::string::npos, parsed.DebugString().find("entries"));
 }
 
 }  // namespace leveldb
@@ -17,6 +17,8 @@
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
 #include "util/logging.h"
+#include "util/perf_context_imp.h"
+#include "util/statistics.h"
 
 namespace leveldb {
 
@@ -70,22 +72,13 @@ Version::~Version() {
   prev_->next_ = next_;
   next_->prev_ = prev_;
 
-  // Drop references to files
-  for (int level = 0; level < config::kNumLevels; level++) {
-    for (size_t i = 0; i < files_[level].size(); i++) {
-      FileMetaData* f = files_[level][i];
-      assert(f->refs > 0);
-      f->refs--;
-      if (f->refs <= 0) {
-        delete f;
-      }
-    }
-  }
+  // The references to the files are dropped along with files_
 }
 
-int FindFile(const InternalKeyComparator& icmp,
-             const std::vector<FileMetaData*>& files,
-             const Slice& key) {
+template <typename FileListType>
+static int FindFileInList(const InternalKeyComparator& icmp,
+                          const FileListType& files,
+                          const Slice& key) {
   uint32_t left = 0;
   uint32_t right = files.size();
   while (left < right) {
@@ -104,6 +97,18 @@ int FindFile(const InternalKeyComparator& icmp,
   return right;
 }
 
+int FindFile(const InternalKeyComparator& icmp,
+             const std::vector<FileMetaData*>& files,
+             const Slice& key) {
+  return FindFileInList(icmp, files, key);
+}
+
+int FindFile(const InternalKeyComparator& icmp,
+             const FileList& files,
+             const Slice& key) {
+  return FindFileInList(icmp, files, key);
+}
+
 static bool AfterFile(const Comparator* ucmp,
                       const Slice* user_key, const FileMetaData* f) {
   // NULL user_key occurs before all keys and is therefore never after *f
@@ -118,10 +123,11 @@ static bool BeforeFile(const Comparator* ucmp,
           ucmp->Compare(*user_key, f->smallest.user_key()) < 0);
 }
 
-bool SomeFileOverlapsRange(
+template <typename FileListType>
+static bool SomeFileOverlapsRangeInList(
     const InternalKeyComparator& icmp,
     bool disjoint_sorted_files,
-    const std::vector<FileMetaData*>& files,
+    const FileListType& files,
     const Slice* smallest_user_key,
     const Slice* largest_user_key) {
   const Comparator* ucmp = icmp.user_comparator();
@@ -155,15 +161,37 @@ bool SomeFileOverlapsRange(
   return !BeforeFile(ucmp, largest_user_key, files[index]);
 }
 
+bool SomeFileOverlapsRange(
+    const InternalKeyComparator& icmp,
+    bool disjoint_sorted_files,
+    const std::vector<FileMetaData*>& files,
+    const Slice* smallest_user_key,
+    const Slice* largest_user_key) {
+  return SomeFileOverlapsRangeInList(icmp, disjoint_sorted_files, files,
+                                     smallest_user_key, largest_user_key);
+}
+
+bool SomeFileOverlapsRange(
+    const InternalKeyComparator& icmp,
+    bool disjoint_sorted_files,
+    const FileList& files,
+    const Slice* smallest_user_key,
+    const Slice* largest_user_key) {
+  return SomeFileOverlapsRangeInList(icmp, disjoint_sorted_files, files,
+                                     smallest_user_key, largest_user_key);
+}
+
 // An internal iterator.  For a given version/level pair, yields
 // information about the files in the level.  For a given entry, key()
 // is the largest key that occurs in the file, and value() is an
 // 16-byte value containing the file number and file size, both
-// encoded using EncodeFixed64.
+// encoded using EncodeFixed64.  FileListType is the FileList of a
+// Version or the std::vector of the input files of a compaction.
+template <typename FileListType>
 class Version::LevelFileNumIterator : public Iterator {
  public:
   LevelFileNumIterator(const InternalKeyComparator& icmp,
-                       const std::vector<FileMetaData*>* flist)
+                       const FileListType* flist)
       : icmp_(icmp),
         flist_(flist),
         index_(flist->size()) {        // Marks as invalid
@@ -203,7 +231,7 @@ class Version::LevelFileNumIterator : public Iterator {
   virtual Status status() const { return Status::OK(); }
  private:
   const InternalKeyComparator icmp_;
-  const std::vector<FileMetaData*>* const flist_;
+  const FileListType* const flist_;
   uint32_t index_;
 
   // Backing store for value().  Holds the file number and size.
@@ -227,8 +255,22 @@ static Iterator* GetFileIterator(void* arg,
 Iterator* Version::NewConcatenatingIterator(const ReadOptions& options,
                                             int level) const {
   return NewTwoLevelIterator(
-      new LevelFileNumIterator(vset_->icmp_, &files_[level]),
-      &GetFileIterator, vset_->table_cache_, options);
+      new LevelFileNumIterator<FileList>(vset_->icmp_, &files_[level]),
+      &GetFileIterator, vset_->table_cache_, options, vset_->env_);
+}
+
+static Iterator* GetCompactionFileIterator(void* arg,
+                                           const ReadOptions& options,
+                                           const Slice& file_value) {
+  TableCache* cache = reinterpret_cast<TableCache*>(arg);
+  if (file_value.size() != 16) {
+    return NewErrorIterator(
+        Status::Corruption("FileReader invoked with unexpected value"));
+  } else {
+    return cache->NewCompactionIterator(options,
+                                        DecodeFixed64(file_value.data()),
+                                        DecodeFixed64(file_value.data() + 8));
+  }
 }
 
 void Version::AddIterators(const ReadOptions& options,
@@ -262,11 +304,13 @@ struct Saver {
   SaverState state;
   const Comparator* ucmp;
   Slice user_key;
-  std::string* value;
+  PinnableSlice* value;
+  bool read_block;  // True iff the lookup found an entry in a data block
 };
 }
 static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
   Saver* s = reinterpret_cast<Saver*>(arg);
+  s->read_block = true;
   ParsedInternalKey parsed_key;
   if (!ParseInternalKey(ikey, &parsed_key)) {
     s->state = kCorrupt;
@@ -274,7 +318,7 @@ static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
     if (s->ucmp->Compare(parsed_key.user_key, s->user_key) == 0) {
       s->state = (parsed_key.type == kTypeValue) ? kFound : kDeleted;
       if (s->state == kFound) {
-        s->value->assign(v.data(), v.size());
+        s->value->PinSlice(v);
       }
     }
   }
@@ -331,11 +375,12 @@ void Version::ForEachOverlapping(Slice user_key, Slice internal_key,
 
 Status Version::Get(const ReadOptions& options,
                     const LookupKey& k,
-                    std::string* value,
+                    PinnableSlice* value,
                     GetStats* stats) {
   Slice ikey = k.internal_key();
   Slice user_key = k.user_key();
   const Comparator* ucmp = vset_->icmp_.user_comparator();
+  Statistics* const statistics = vset_->options_->statistics;
   Status s;
 
   stats->seek_file = NULL;
@@ -353,13 +398,13 @@ Status Version::Get(const ReadOptions& options,
     if (num_files == 0) continue;
 
     // Get the list of files to search in this level
-    FileMetaData* const* files = &files_[level][0];
+    FileMetaData* const* files;
     if (level == 0) {
       // Level-0 files may overlap each other.  Find all files that
       // overlap user_key and process them in order from newest to oldest.
       tmp.reserve(num_files);
       for (uint32_t i = 0; i < num_files; i++) {
-        FileMetaData* f = files[i];
+        FileMetaData* f = files_[level][i];
         if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0 &&
             ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
           tmp.push_back(f);
@@ -377,7 +422,7 @@ Status Version::Get(const ReadOptions& options,
         files = NULL;
         num_files = 0;
       } else {
-        tmp2 = files[index];
+        tmp2 = files_[level][index];
         if (ucmp->Compare(user_key, tmp2->smallest.user_key()) < 0) {
           // All of "tmp2" is past any data for user_key
           files = NULL;
@@ -399,14 +444,26 @@ Status Version::Get(const ReadOptions& options,
       FileMetaData* f = files[i];
       last_file_read = f;
       last_file_read_level = level;
+      PERF_COUNTER_ADD(get_sst_files_consulted, 1);
 
       Saver saver;
       saver.state = kNotFound;
       saver.ucmp = ucmp;
       saver.user_key = user_key;
       saver.value = value;
+      saver.read_block = false;
       s = vset_->table_cache_->Get(options, f->number, f->file_size,
-                                   ikey, &saver, SaveValue);
+                                   ikey, &saver, SaveValue, value);
+      if (saver.state != kFound) {
+        // Release the block and table pinned by the lookup
+        value->Reset();
+      }
+      if (saver.read_block && saver.state == kNotFound &&
+          vset_->options_->filter_policy != NULL) {
+        // The filter let through a key that the table does not contain
+        // (useful lookups are counted by the table itself).
+        RecordTick(statistics, kBloomFilterFalsePositive);
+      }
       if (!s.ok()) {
         return s;
       }
@@ -414,6 +471,8 @@ Status Version::Get(const ReadOptions& options,
         case kNotFound:
           break;      // Keep searching in other files
         case kFound:
+          RecordTick(statistics, level == 0 ? kGetHitL0 :
+                     level == 1 ? kGetHitL1 : kGetHitL2AndUp);
           return s;
         case kDeleted:
           s = Status::NotFound(Slice());  // Use empty error message for speed
@@ -429,6 +488,10 @@ Status Version::Get(const ReadOptions& options,
 }
 
 bool Version::UpdateStats(const GetStats& stats) {
+  if (vset_->options_->compaction_style != kCompactionStyleLevel) {
+    // Seek-triggered compactions would split up sorted runs
+    return false;
+  }
   FileMetaData* f = stats.seek_file;
   if (f != NULL) {
     f->allowed_seeks--;
@@ -503,6 +566,12 @@ int Version::PickLevelForMemTableOutput(
     const Slice& smallest_user_key,
     const Slice& largest_user_key) {
   int level = 0;
+  if (vset_->options_->compaction_style != kCompactionStyleLevel ||
+      vset_->options_->dynamic_level_bytes) {
+    // Every memtable compaction adds a new sorted run in level-0, and
+    // with dynamic level sizes the levels above the base level stay empty
+    return level;
+  }
   if (!OverlapInLevel(0, &smallest_user_key, &largest_user_key)) {
     // Push to next level if there is no overlap in next level,
     // and the #bytes overlapping in the level after that are limited.
@@ -581,7 +650,7 @@ std::string Version::DebugString() const {
     r.append("--- level ");
     AppendNumberTo(&r, level);
     r.append(" ---\n");
-    const std::vector<FileMetaData*>& files = files_[level];
+    const FileList& files = files_[level];
     for (size_t i = 0; i < files.size(); i++) {
       r.push_back(' ');
       AppendNumberTo(&r, files[i]->number);
@@ -709,67 +778,46 @@ class VersionSet::Builder {
 
   // Save the current state in *v.
   void SaveTo(Version* v) {
-    BySmallestKey cmp;
-    cmp.internal_comparator = &vset_->icmp_;
     for (int level = 0; level < config::kNumLevels; level++) {
-      // Merge the set of added files with the set of pre-existing files.
-      // Drop any deleted files.  Store the result in *v.
-      const std::vector<FileMetaData*>& base_files = base_->files_[level];
-      std::vector<FileMetaData*>::const_iterator base_iter = base_files.begin();
-      std::vector<FileMetaData*>::const_iterator base_end = base_files.end();
-      const FileSet* added = levels_[level].added_files;
-      v->files_[level].reserve(base_files.size() + added->size());
-      for (FileSet::const_iterator added_iter = added->begin();
-           added_iter != added->end();
-           ++added_iter) {
-        // Add all smaller files listed in base_
-        for (std::vector<FileMetaData*>::const_iterator bpos
-                 = std::upper_bound(base_iter, base_end, *added_iter, cmp);
-             base_iter != bpos;
-             ++base_iter) {
-          MaybeAddFile(v, level, *base_iter);
+      // Apply the added and deleted files to a copy of the list of
+      // *base_.  The copy shares all unchanged chunks of files with it.
+      const LevelState& state = levels_[level];
+      std::vector<FileMetaData*> added;
+      for (FileSet::const_iterator it = state.added_files->begin();
+           it != state.added_files->end();
+           ++it) {
+        if (state.deleted_files.count((*it)->number) == 0) {
+          added.push_back(*it);
         }
-
-        MaybeAddFile(v, level, *added_iter);
-      }
-
-      // Add remaining base files
-      for (; base_iter != base_end; ++base_iter) {
-        MaybeAddFile(v, level, *base_iter);
       }
+      FileList* files = &v->files_[level];
+      *files = base_->files_[level];
+      files->Apply(vset_->icmp_, state.deleted_files, added);
 
 #ifndef NDEBUG
-      // Make sure there is no overlap in levels > 0
+      // Make sure there is no overlap in levels > 0.  Only the added
+      // files can overlap their neighbours.
       if (level > 0) {
-        for (uint32_t i = 1; i < v->files_[level].size(); i++) {
-          const InternalKey& prev_end = v->files_[level][i-1]->largest;
-          const InternalKey& this_begin = v->files_[level][i]->smallest;
-          if (vset_->icmp_.Compare(prev_end, this_begin) >= 0) {
-            fprintf(stderr, "overlapping ranges in same level %s vs. %s\n",
-                    prev_end.DebugString().c_str(),
-                    this_begin.DebugString().c_str());
-            abort();
+        for (size_t j = 0; j < added.size(); j++) {
+          const uint32_t index =
+              FindFile(vset_->icmp_, *files, added[j]->largest.Encode());
+          for (uint32_t i = std::max<uint32_t>(index, 1);
+               i <= index + 1 && i < files->size();
+               i++) {
+            const InternalKey& prev_end = (*files)[i-1]->largest;
+            const InternalKey& this_begin = (*files)[i]->smallest;
+            if (vset_->icmp_.Compare(prev_end, this_begin) >= 0) {
+              fprintf(stderr, "overlapping ranges in same level %s vs. %s\n",
+                      prev_end.DebugString().c_str(),
+                      this_begin.DebugString().c_str());
+              abort();
+            }
           }
         }
       }
 #endif
     }
   }
-
-  void MaybeAddFile(Version* v, int level, FileMetaData* f) {
-    if (levels_[level].deleted_files.count(f->number) > 0) {
-      // File is deleted: do nothing
-    } else {
-      std::vector<FileMetaData*>* files = &v->files_[level];
-      if (level > 0 && !files->empty()) {
-        // Must not overlap
-        assert(vset_->icmp_.Compare((*files)[files->size()-1]->largest,
-                                    f->smallest) < 0);
-      }
-      f->refs++;
-      files->push_back(f);
-    }
-  }
 };
 
 VersionSet::VersionSet(const std::string& dbname,
@@ -786,6 +834,7 @@ VersionSet::VersionSet(const std::string& dbname,
       last_sequence_(0),
       log_number_(0),
       prev_log_number_(0),
+      max_column_family_(0),
       descriptor_file_(NULL),
       descriptor_log_(NULL),
       dummy_versions_(this),
@@ -829,6 +878,10 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
     edit->SetPrevLogNumber(prev_log_number_);
   }
 
+  // Only the deletion-triggered compactions use the entry counts of
+  // files, so keep the descriptor readable by older versions without them
+  edit->SetFileStats(options_->deletion_compaction_ratio > 0);
+
   edit->SetNextFile(next_file_number_);
   edit->SetLastSequence(last_sequence_);
 
@@ -888,6 +941,7 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
     AppendVersion(v);
     log_number_ = edit->log_number_;
     prev_log_number_ = edit->prev_log_number_;
+    ApplyColumnFamilies(*edit);
   } else {
     delete v;
     if (!new_manifest_file.empty()) {
@@ -958,6 +1012,7 @@ Status VersionSet::Recover(bool *save_manifest) {
 
       if (s.ok()) {
         builder.Apply(&edit);
+        ApplyColumnFamilies(edit);
       }
 
       if (edit.has_log_number_) {
@@ -1055,6 +1110,20 @@ bool VersionSet::ReuseManifest(const std::string& dscname,
   return true;
 }
 
+void VersionSet::ApplyColumnFamilies(const VersionEdit& edit) {
+  for (size_t i = 0; i < edit.new_column_families_.size(); i++) {
+    const uint32_t id = edit.new_column_families_[i].first;
+    column_families_[id] = edit.new_column_families_[i].second;
+    max_column_family_ = std::max(max_column_family_, id);
+  }
+  for (size_t i = 0; i < edit.dropped_column_families_.size(); i++) {
+    column_families_.erase(edit.dropped_column_families_[i]);
+  }
+  if (edit.has_max_column_family_) {
+    max_column_family_ = std::max(max_column_family_, edit.max_column_family_);
+  }
+}
+
 void VersionSet::MarkFileNumberUsed(uint64_t number) {
   if (next_file_number_ <= number) {
     next_file_number_ = number + 1;
@@ -1062,6 +1131,78 @@ void VersionSet::MarkFileNumberUsed(uint64_t number) {
 }
 
 void VersionSet::Finalize(Version* v) {
+  if (options_->compaction_style == kCompactionStyleUniversal) {
+    // Every level-0 file and every non-empty higher level is a sorted
+    // run.  Compact once there are too many runs to merge on reads.
+    int runs = v->files_[0].size();
+    for (int level = 1; level < config::kNumLevels; level++) {
+      if (!v->files_[level].empty()) {
+        runs++;
+      }
+    }
+    v->compaction_level_ = 0;
+    v->compaction_score_ =
+        runs / static_cast<double>(config::kL0_CompactionTrigger);
+    return;
+  }
+
+  uint64_t level_bytes[config::kNumLevels];
+  for (int level = 0; level < config::kNumLevels; level++) {
+    level_bytes[level] = v->files_[level].TotalFileSize();
+  }
+  if (options_->dynamic_level_bytes) {
+    // Every level is one tenth of the size of the next one, ending with
+    // the largest level.  Level-0 data goes straight to the base level,
+    // the smallest level with a target of at least MaxBytesForLevel(1).
+    const double base_bytes = MaxBytesForLevel(options_, 1);
+    uint64_t largest = 0;
+    int first_non_empty = config::kNumLevels - 1;
+    for (int level = config::kNumLevels - 1; level >= 1; level--) {
+      if (level_bytes[level] > 0) {
+        first_non_empty = level;
+      }
+      largest = std::max(largest, level_bytes[level]);
+    }
+
+    double target = std::max(static_cast<double>(largest), base_bytes);
+    int base_level = config::kNumLevels - 1;
+    v->max_bytes_for_level_[base_level] = target;
+    // Data left above the computed base level (e.g. written before
+    // dynamic sizing was enabled) is drained by giving those levels
+    // correspondingly small targets.
+    while (base_level > 1 &&
+           (target / 10 >= base_bytes || base_level > first_non_empty)) {
+      target /= 10;
+      base_level--;
+      v->max_bytes_for_level_[base_level] = target;
+    }
+    for (int level = 0; level < base_level; level++) {
+      v->max_bytes_for_level_[level] = 0;
+    }
+    v->base_level_ = base_level;
+  } else {
+    v->base_level_ = 1;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      v->max_bytes_for_level_[level] = MaxBytesForLevel(options_, level);
+    }
+  }
+
+  // Estimate the work needed to bring every level under its limit: all
+  // of level-0 once it has to be compacted, plus the excess bytes of
+  // every other level.
+  uint64_t pending_bytes = 0;
+  if (v->files_[0].size() >= config::kL0_CompactionTrigger) {
+    pending_bytes += level_bytes[0];
+  }
+  for (int level = std::max(v->base_level_, 1);
+       level < config::kNumLevels - 1; level++) {
+    if (level_bytes[level] > v->max_bytes_for_level_[level]) {
+      pending_bytes += level_bytes[level] -
+          static_cast<uint64_t>(v->max_bytes_for_level_[level]);
+    }
+  }
+  v->pending_compaction_bytes_ = pending_bytes;
+
   // Precomputed best level for next compaction
   int best_level = -1;
   double best_score = -1;
@@ -1082,11 +1223,13 @@ void VersionSet::Finalize(Version* v) {
       // overwrites/deletions).
       score = v->files_[level].size() /
           static_cast<double>(config::kL0_CompactionTrigger);
+    } else if (level < v->base_level_) {
+      // Empty by construction; level-0 is compacted past these levels
+      score = 0;
     } else {
       // Compute the ratio of current size to size limit.
-      const uint64_t level_bytes = TotalFileSize(v->files_[level]);
-      score =
-          static_cast<double>(level_bytes) / MaxBytesForLevel(options_, level);
+      score = static_cast<double>(level_bytes[level]) /
+          v->max_bytes_for_level_[level];
     }
 
     if (score > best_score) {
@@ -1097,33 +1240,71 @@ void VersionSet::Finalize(Version* v) {
 
   v->compaction_level_ = best_level;
   v->compaction_score_ = best_score;
-}
 
-Status VersionSet::WriteSnapshot(log::Writer* log) {
-  // TODO: Break up into multiple records to reduce memory usage on recovery?
+  // Files at the last level are left alone: they have nowhere to go, and
+  // whatever deletion markers they still hold are protected by snapshots.
+  v->deletion_file_to_compact_ = NULL;
+  v->deletion_file_to_compact_level_ = -1;
+  const double deletion_ratio = options_->deletion_compaction_ratio;
+  if (deletion_ratio > 0) {
+    double best_ratio = deletion_ratio;
+    for (int level = 0; level < config::kNumLevels - 1; level++) {
+      for (size_t i = 0; i < v->files_[level].size(); i++) {
+        FileMetaData* f = v->files_[level][i];
+        if (f->num_entries == 0) {
+          continue;  // Unknown
+        }
+        const double ratio = static_cast<double>(f->num_deletions) /
+            f->num_entries;
+        if (ratio >= best_ratio) {
+          best_ratio = ratio;
+          v->deletion_file_to_compact_ = f;
+          v->deletion_file_to_compact_level_ = level;
+        }
+      }
+    }
+  }
+}
 
+void VersionSet::AddCurrentState(VersionEdit* edit) const {
   // Save metadata
-  VersionEdit edit;
-  edit.SetComparatorName(icmp_.user_comparator()->Name());
+  edit->SetComparatorName(icmp_.user_comparator()->Name());
+  edit->SetFileStats(options_->deletion_compaction_ratio > 0);
 
   // Save compaction pointers
   for (int level = 0; level < config::kNumLevels; level++) {
     if (!compact_pointer_[level].empty()) {
       InternalKey key;
       key.DecodeFrom(compact_pointer_[level]);
-      edit.SetCompactPointer(level, key);
+      edit->SetCompactPointer(level, key);
     }
   }
 
   // Save files
   for (int level = 0; level < config::kNumLevels; level++) {
-    const std::vector<FileMetaData*>& files = current_->files_[level];
+    const FileList& files = current_->files_[level];
     for (size_t i = 0; i < files.size(); i++) {
       const FileMetaData* f = files[i];
-      edit.AddFile(level, f->number, f->file_size, f->smallest, f->largest);
+      edit->AddFile(level, *f);
     }
   }
 
+  // Save column families
+  if (max_column_family_ > 0) {
+    edit->SetMaxColumnFamily(max_column_family_);
+  }
+  for (std::map<uint32_t, std::string>::const_iterator it =
+           column_families_.begin();
+       it != column_families_.end(); ++it) {
+    edit->AddColumnFamily(it->first, it->second);
+  }
+}
+
+Status VersionSet::WriteSnapshot(log::Writer* log) {
+  // TODO: Break up into multiple records to reduce memory usage on recovery?
+  VersionEdit edit;
+  AddCurrentState(&edit);
+
   std::string record;
   edit.EncodeTo(&record);
   return log->AddRecord(record);
@@ -1153,7 +1334,7 @@ const char* VersionSet::LevelSummary(LevelSummaryStorage* scratch) const {
 uint64_t VersionSet::ApproximateOffsetOf(Version* v, const InternalKey& ikey) {
   uint64_t result = 0;
   for (int level = 0; level < config::kNumLevels; level++) {
-    const std::vector<FileMetaData*>& files = v->files_[level];
+    const FileList& files = v->files_[level];
     for (size_t i = 0; i < files.size(); i++) {
       if (icmp_.Compare(files[i]->largest, ikey) <= 0) {
         // Entire file is before "ikey", so just add the file size
@@ -1182,23 +1363,27 @@ uint64_t VersionSet::ApproximateOffsetOf(Version* v, const InternalKey& ikey) {
   return result;
 }
 
+void Version::AddLiveFiles(std::set<uint64_t>* live) const {
+  for (int level = 0; level < config::kNumLevels; level++) {
+    const FileList& files = files_[level];
+    for (size_t i = 0; i < files.size(); i++) {
+      live->insert(files[i]->number);
+    }
+  }
+}
+
 void VersionSet::AddLiveFiles(std::set<uint64_t>* live) {
   for (Version* v = dummy_versions_.next_;
        v != &dummy_versions_;
        v = v->next_) {
-    for (int level = 0; level < config::kNumLevels; level++) {
-      const std::vector<FileMetaData*>& files = v->files_[level];
-      for (size_t i = 0; i < files.size(); i++) {
-        live->insert(files[i]->number);
-      }
-    }
+    v->AddLiveFiles(live);
   }
 }
 
 int64_t VersionSet::NumLevelBytes(int level) const {
   assert(level >= 0);
   assert(level < config::kNumLevels);
-  return TotalFileSize(current_->files_[level]);
+  return current_->files_[level].TotalFileSize();
 }
 
 int64_t VersionSet::MaxNextLevelOverlappingBytes() {
@@ -1263,22 +1448,24 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   // Level-0 files have to be merged together.  For other levels,
   // we will make a concatenating iterator per level.
   // TODO(opt): use concatenating iterator for level-0 if there is no overlap
-  const int space = (c->level() == 0 ? c->inputs_[0].size() + 1 : 2);
+  const int space = (c->level() == 0 ? c->inputs_[0].size() : 0) +
+                    c->num_input_levels();
   Iterator** list = new Iterator*[space];
   int num = 0;
-  for (int which = 0; which < 2; which++) {
+  for (int which = 0; which < c->num_input_levels(); which++) {
     if (!c->inputs_[which].empty()) {
       if (c->level() + which == 0) {
         const std::vector<FileMetaData*>& files = c->inputs_[which];
         for (size_t i = 0; i < files.size(); i++) {
-          list[num++] = table_cache_->NewIterator(
+          list[num++] = table_cache_->NewCompactionIterator(
               options, files[i]->number, files[i]->file_size);
         }
       } else {
         // Create concatenating iterator for the files from this level
         list[num++] = NewTwoLevelIterator(
-            new Version::LevelFileNumIterator(icmp_, &c->inputs_[which]),
-            &GetFileIterator, table_cache_, options);
+            new Version::LevelFileNumIterator<std::vector<FileMetaData*> >(
+                icmp_, &c->inputs_[which]),
+            &GetCompactionFileIterator, table_cache_, options, env_);
       }
     }
   }
@@ -1289,12 +1476,19 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
 }
 
 Compaction* VersionSet::PickCompaction() {
+  if (options_->compaction_style == kCompactionStyleUniversal) {
+    return PickUniversalCompaction();
+  }
+
   Compaction* c;
   int level;
 
   // We prefer compactions triggered by too much data in a level over
-  // the compactions triggered by seeks.
+  // the compactions triggered by deletion markers, and those over the
+  // compactions triggered by seeks.
   const bool size_compaction = (current_->compaction_score_ >= 1);
+  const bool deletion_compaction =
+      (current_->deletion_file_to_compact_ != NULL);
   const bool seek_compaction = (current_->file_to_compact_ != NULL);
   if (size_compaction) {
     level = current_->compaction_level_;
@@ -1315,6 +1509,11 @@ Compaction* VersionSet::PickCompaction() {
       // Wrap-around to the beginning of the key space
       c->inputs_[0].push_back(current_->files_[level][0]);
     }
+  } else if (deletion_compaction) {
+    level = current_->deletion_file_to_compact_level_;
+    c = new Compaction(options_, level);
+    c->deletion_compaction_ = true;
+    c->inputs_[0].push_back(current_->deletion_file_to_compact_);
   } else if (seek_compaction) {
     level = current_->file_to_compact_level_;
     c = new Compaction(options_, level);
@@ -1328,6 +1527,7 @@ Compaction* VersionSet::PickCompaction() {
 
   // Files in level 0 may overlap each other, so pick up all overlapping ones
   if (level == 0) {
+    c->output_level_ = current_->base_level_;
     InternalKey smallest, largest;
     GetRange(c->inputs_[0], &smallest, &largest);
     // Note that the next call will discard the file we placed in
@@ -1344,22 +1544,24 @@ Compaction* VersionSet::PickCompaction() {
 
 void VersionSet::SetupOtherInputs(Compaction* c) {
   const int level = c->level();
+  const int output_level = c->output_level();
+  std::vector<FileMetaData*>& parents = c->inputs_[output_level - level];
   InternalKey smallest, largest;
   GetRange(c->inputs_[0], &smallest, &largest);
 
-  current_->GetOverlappingInputs(level+1, &smallest, &largest, &c->inputs_[1]);
+  current_->GetOverlappingInputs(output_level, &smallest, &largest, &parents);
 
   // Get entire range covered by compaction
   InternalKey all_start, all_limit;
-  GetRange2(c->inputs_[0], c->inputs_[1], &all_start, &all_limit);
+  GetRange2(c->inputs_[0], parents, &all_start, &all_limit);
 
   // See if we can grow the number of inputs in "level" without
-  // changing the number of "level+1" files we pick up.
-  if (!c->inputs_[1].empty()) {
+  // changing the number of "output_level" files we pick up.
+  if (!parents.empty()) {
     std::vector<FileMetaData*> expanded0;
     current_->GetOverlappingInputs(level, &all_start, &all_limit, &expanded0);
     const int64_t inputs0_size = TotalFileSize(c->inputs_[0]);
-    const int64_t inputs1_size = TotalFileSize(c->inputs_[1]);
+    const int64_t inputs1_size = TotalFileSize(parents);
     const int64_t expanded0_size = TotalFileSize(expanded0);
     if (expanded0.size() > c->inputs_[0].size() &&
         inputs1_size + expanded0_size <
@@ -1367,14 +1569,14 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
       InternalKey new_start, new_limit;
       GetRange(expanded0, &new_start, &new_limit);
       std::vector<FileMetaData*> expanded1;
-      current_->GetOverlappingInputs(level+1, &new_start, &new_limit,
+      current_->GetOverlappingInputs(output_level, &new_start, &new_limit,
                                      &expanded1);
-      if (expanded1.size() == c->inputs_[1].size()) {
+      if (expanded1.size() == parents.size()) {
         Log(options_->info_log,
             "Expanding@%d %d+%d (%ld+%ld bytes) to %d+%d (%ld+%ld bytes)\n",
             level,
             int(c->inputs_[0].size()),
-            int(c->inputs_[1].size()),
+            int(parents.size()),
             long(inputs0_size), long(inputs1_size),
             int(expanded0.size()),
             int(expanded1.size()),
@@ -1382,16 +1584,16 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
         smallest = new_start;
         largest = new_limit;
         c->inputs_[0] = expanded0;
-        c->inputs_[1] = expanded1;
-        GetRange2(c->inputs_[0], c->inputs_[1], &all_start, &all_limit);
+        parents = expanded1;
+        GetRange2(c->inputs_[0], parents, &all_start, &all_limit);
       }
     }
   }
 
   // Compute the set of grandparent files that overlap this compaction
-  // (parent == level+1; grandparent == level+2)
-  if (level + 2 < config::kNumLevels) {
-    current_->GetOverlappingInputs(level + 2, &all_start, &all_limit,
+  // (parent == output_level; grandparent == output_level+1)
+  if (output_level + 1 < config::kNumLevels) {
+    current_->GetOverlappingInputs(output_level + 1, &all_start, &all_limit,
                                    &c->grandparents_);
   }
 
@@ -1410,6 +1612,128 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
   c->edit_.SetCompactPointer(level, largest);
 }
 
+namespace {
+// A sorted run is either a single level-0 file or a whole level > 0.
+struct SortedRun {
+  int level;
+  uint64_t size;
+};
+}  // namespace
+
+Compaction* VersionSet::PickUniversalCompaction() {
+  Version* const v = current_;
+  if (v->compaction_score_ < 1) {
+    return NULL;
+  }
+
+  // Collect sorted runs from newest to oldest
+  std::vector<SortedRun> runs;
+  const size_t num_level0_runs = v->files_[0].size();
+  std::vector<FileMetaData*> level0;
+  v->files_[0].AppendTo(&level0);
+  std::sort(level0.begin(), level0.end(), NewestFirst);
+  for (size_t i = 0; i < level0.size(); i++) {
+    SortedRun r = { 0, level0[i]->file_size };
+    runs.push_back(r);
+  }
+  for (int level = 1; level < config::kNumLevels; level++) {
+    if (!v->files_[level].empty()) {
+      SortedRun r = { level, v->files_[level].TotalFileSize() };
+      runs.push_back(r);
+    }
+  }
+  assert(runs.size() >= 2);
+
+  // Runs [start,end) will be merged.
+  size_t start = 0;
+  size_t end = 0;
+  const char* reason;
+
+  // (1) Too much space is taken by data that the oldest run may shadow:
+  // merge everything.
+  uint64_t newer_bytes = 0;
+  for (size_t i = 0; i + 1 < runs.size(); i++) {
+    newer_bytes += runs[i].size;
+  }
+  if (newer_bytes * 100 >
+      config::kUniversalMaxSizeAmplificationPercent * runs.back().size) {
+    end = runs.size();
+    reason = "size amplification";
+  }
+
+  // (2) Merge runs of similar size, starting with the newest ones.
+  // Level-0 files can only be merged together with all newer level-0
+  // files since their order is given by file number.
+  for (size_t i = 0; end == 0 && i < runs.size(); i++) {
+    if (i > 0 && i < num_level0_runs) continue;
+    uint64_t candidate_bytes = runs[i].size;
+    size_t j = i + 1;
+    while (j < runs.size() &&
+           candidate_bytes * (100 + config::kUniversalSizeRatioPercent) / 100
+               >= runs[j].size) {
+      candidate_bytes += runs[j].size;
+      j++;
+    }
+    if (j - i >= 2) {
+      start = i;
+      end = j;
+      reason = "size ratio";
+    }
+  }
+
+  // (3) Otherwise reduce the number of runs below the trigger by merging
+  // the newest ones.
+  if (end == 0) {
+    end = runs.size() - config::kL0_CompactionTrigger + 2;
+    reason = "sorted run count";
+  }
+
+  // A merge that touches level-0 must consume all of level-0 so that its
+  // output can be placed in a level, which keeps level-0 ordered by age.
+  if (start < num_level0_runs && end < num_level0_runs) {
+    end = num_level0_runs;
+  }
+
+  // The output replaces the oldest input run.  A level-0-only merge goes
+  // to the empty level just above the next older run, if there is one.
+  int output_level;
+  if (runs[end - 1].level > 0) {
+    output_level = runs[end - 1].level;
+  } else if (end == runs.size()) {
+    output_level = config::kNumLevels - 1;
+  } else if (runs[end].level > 1) {
+    output_level = runs[end].level - 1;
+  } else {
+    output_level = runs[end].level;
+    end++;
+  }
+
+  const int level = runs[start].level;
+  Compaction* c = new Compaction(options_, level);
+  c->output_level_ = output_level;
+  c->input_version_ = v;
+  c->input_version_->Ref();
+  for (int which = 0; which < c->num_input_levels(); which++) {
+    v->files_[level + which].AppendTo(&c->inputs_[which]);
+  }
+
+  std::vector<FileMetaData*> all;
+  for (int which = 0; which < c->num_input_levels(); which++) {
+    all.insert(all.end(), c->inputs_[which].begin(), c->inputs_[which].end());
+  }
+  InternalKey all_start, all_limit;
+  GetRange(all, &all_start, &all_limit);
+  if (output_level + 1 < config::kNumLevels) {
+    v->GetOverlappingInputs(output_level + 1, &all_start, &all_limit,
+                            &c->grandparents_);
+  }
+
+  Log(options_->info_log,
+      "Universal compaction (%s): %d of %d sorted runs, level %d..%d\n",
+      reason, int(end - start), int(runs.size()), level, output_level);
+  return c;
+}
+
 Compaction* VersionSet::CompactRange(
     int level,
     const InternalKey* begin,
@@ -1447,8 +1771,10 @@ Compaction* VersionSet::CompactRange(
 
 Compaction::Compaction(const Options* options, int level)
     : level_(level),
+      output_level_(level + 1),
       max_output_file_size_(MaxFileSizeForLevel(options, level)),
       input_version_(NULL),
+      deletion_compaction_(false),
       grandparent_index_(0),
       seen_key_(false),
       overlapped_bytes_(0) {
@@ -1465,16 +1791,21 @@ Compaction::~Compaction() {
 
 bool Compaction::IsTrivialMove() const {
   const VersionSet* vset = input_version_->vset_;
+  int total_files = 0;
+  for (int which = 0; which < num_input_levels(); which++) {
+    total_files += num_input_files(which);
+  }
   // Avoid a move if there is lots of overlapping grandparent data.
   // Otherwise, the move could create a parent file that will require
   // a very expensive merge later on.
-  return (num_input_files(0) == 1 && num_input_files(1) == 0 &&
+  return (!deletion_compaction_ &&
+          num_input_files(0) == 1 && total_files == 1 &&
           TotalFileSize(grandparents_) <=
               MaxGrandParentOverlapBytes(vset->options_));
 }
 
 void Compaction::AddInputDeletions(VersionEdit* edit) {
-  for (int which = 0; which < 2; which++) {
+  for (int which = 0; which < num_input_levels(); which++) {
     for (size_t i = 0; i < inputs_[which].size(); i++) {
       edit->DeleteFile(level_ + which, inputs_[which][i]->number);
     }
@@ -1484,8 +1815,8 @@ void Compaction::AddInputDeletions(VersionEdit* edit) {
 bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
   // Maybe use binary search to find right entry instead of linear search?
   const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
-  for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
-    const std::vector<FileMetaData*>& files = input_version_->files_[lvl];
+  for (int lvl = output_level_ + 1; lvl < config::kNumLevels; lvl++) {
+    const FileList& files = input_version_->files_[lvl];
     for (; level_ptrs_[lvl] < files.size(); ) {
       FileMetaData* f = files[level_ptrs_[lvl]];
       if (user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
@@ -19,7 +19,9 @@
 #include <set>
 #include <vector>
 #include "db/dbformat.h"
+#include "db/file_list.h"
 #include "db/version_edit.h"
+#include "leveldb/pinnable_slice.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
 
@@ -42,6 +44,9 @@ class WritableFile;
 extern int FindFile(const InternalKeyComparator& icmp,
                     const std::vector<FileMetaData*>& files,
                     const Slice& key);
+extern int FindFile(const InternalKeyComparator& icmp,
+                    const FileList& files,
+                    const Slice& key);
 
 // Returns true iff some file in "files" overlaps the user key range
 // [*smallest,*largest].
@@ -55,6 +60,12 @@ extern bool SomeFileOverlapsRange(
     const std::vector<FileMetaData*>& files,
     const Slice* smallest_user_key,
     const Slice* largest_user_key);
+extern bool SomeFileOverlapsRange(
+    const InternalKeyComparator& icmp,
+    bool disjoint_sorted_files,
+    const FileList& files,
+    const Slice* smallest_user_key,
+    const Slice* largest_user_key);
 
 class Version {
  public:
@@ -63,14 +74,14 @@ class Version {
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
   void AddIterators(const ReadOptions&, std::vector<Iterator*>* iters);
 
-  // Lookup the value for key.  If found, store it in *val and
+  // Lookup the value for key.  If found, pin it in *val and
   // return OK.  Else return a non-OK status.  Fills *stats.
   // REQUIRES: lock is not held
   struct GetStats {
     FileMetaData* seek_file;
     int seek_file_level;
   };
-  Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
+  Status Get(const ReadOptions&, const LookupKey& key, PinnableSlice* val,
              GetStats* stats);
 
   // Adds "stats" into the current state.  Returns true if a new
@@ -110,6 +121,9 @@ class Version {
 
   int NumFiles(int level) const { return files_[level].size(); }
 
+  // Add the numbers of all files in this version to *live.
+  void AddLiveFiles(std::set<uint64_t>* live) const;
+
   // Return a human readable string that describes this version's contents.
   std::string DebugString() const;
 
@@ -117,7 +131,7 @@ class Version {
   friend class Compaction;
   friend class VersionSet;
 
-  class LevelFileNumIterator;
+  template <typename FileListType> class LevelFileNumIterator;
   Iterator* NewConcatenatingIterator(const ReadOptions&, int level) const;
 
   // Call func(arg, level, f) for every file that overlaps user_key in
@@ -135,24 +149,46 @@ class Version {
   int refs_;                    // Number of live refs to this version
 
   // List of files per level
-  std::vector<FileMetaData*> files_[config::kNumLevels];
+  FileList files_[config::kNumLevels];
 
   // Next file to compact based on seek stats.
   FileMetaData* file_to_compact_;
   int file_to_compact_level_;
 
+  // File with the largest fraction of deletion markers above
+  // options.deletion_compaction_ratio, or NULL.  These fields are
+  // initialized by Finalize().
+  FileMetaData* deletion_file_to_compact_;
+  int deletion_file_to_compact_level_;
+
   // Level that should be compacted next and its compaction score.
   // Score < 1 means compaction is not strictly needed.  These fields
   // are initialized by Finalize().
   double compaction_score_;
   int compaction_level_;
 
+  // Level that level-0 files are compacted into and the size limit of
+  // every level.  These fields are initialized by Finalize().
+  int base_level_;
+  double max_bytes_for_level_[config::kNumLevels];
+
+  // Estimated bytes that must be compacted to bring every level under its
+  // size limit.  Initialized by Finalize().
+  uint64_t pending_compaction_bytes_;
+
   explicit Version(VersionSet* vset)
       : vset_(vset), next_(this), prev_(this), refs_(0),
         file_to_compact_(NULL),
         file_to_compact_level_(-1),
+        deletion_file_to_compact_(NULL),
+        deletion_file_to_compact_level_(-1),
         compaction_score_(-1),
-        compaction_level_(-1) {
+        compaction_level_(-1),
+        base_level_(1),
+        pending_compaction_bytes_(0) {
+    for (int level = 0; level < config::kNumLevels; level++) {
+      max_bytes_for_level_[level] = 0;
+    }
   }
 
   ~Version();
@@ -205,6 +241,12 @@ class VersionSet {
   // Return the combined file size of all files at the specified level.
   int64_t NumLevelBytes(int level) const;
 
+  // Return the estimated number of bytes that compactions must rewrite
+  // before every level is under its size limit.
+  uint64_t PendingCompactionBytes() const {
+    return current_->pending_compaction_bytes_;
+  }
+
   // Return the last sequence number.
   uint64_t LastSequence() const { return last_sequence_; }
 
@@ -224,7 +266,18 @@ class VersionSet {
   // being compacted, or zero if there is no such log file.
   uint64_t PrevLogNumber() const { return prev_log_number_; }
 
-  // Pick level and inputs for a new compaction.
+  // Return the live column families recorded in this descriptor, keyed
+  // by id.  Only the descriptor of the default column family records
+  // any; the default column family itself is not included.
+  const std::map<uint32_t, std::string>& ColumnFamilies() const {
+    return column_families_;
+  }
+
+  // Return the largest column family id ever recorded.
+  uint32_t MaxColumnFamily() const { return max_column_family_; }
+
+  // Pick level and inputs for a new compaction according to
+  // options->compaction_style.
   // Returns NULL if there is no compaction to be done.
   // Otherwise returns a pointer to a heap-allocated object that
   // describes the compaction.  Caller should delete the result.
@@ -250,13 +303,20 @@ class VersionSet {
   // Returns true iff some level needs a compaction.
   bool NeedsCompaction() const {
     Version* v = current_;
-    return (v->compaction_score_ >= 1) || (v->file_to_compact_ != NULL);
+    return (v->compaction_score_ >= 1) ||
+        (v->deletion_file_to_compact_ != NULL) ||
+        (v->file_to_compact_ != NULL);
   }
 
   // Add all files listed in any live version to *live.
   // May also mutate some internal state.
   void AddLiveFiles(std::set<uint64_t>* live);
 
+  // Add the comparator name, the compaction pointers and all files of
+  // the current version to *edit.  Applying *edit to an empty VersionSet
+  // reproduces the current version.
+  void AddCurrentState(VersionEdit* edit) const;
+
   // Return the approximate offset in the database of the data for
   // "key" as of version "v".
   uint64_t ApproximateOffsetOf(Version* v, const InternalKey& key);
@@ -289,11 +349,18 @@ class VersionSet {
 
   void SetupOtherInputs(Compaction* c);
 
+  // Universal compaction counterpart of the size-triggered part of
+  // PickCompaction().  Merges a run of adjacent sorted runs.
+  Compaction* PickUniversalCompaction();
+
   // Save current contents to *log
   Status WriteSnapshot(log::Writer* log);
 
   void AppendVersion(Version* v);
 
+  // Apply the column family records of *edit to column_families_.
+  void ApplyColumnFamilies(const VersionEdit& edit);
+
   Env* const env_;
   const std::string dbname_;
   const Options* const options_;
@@ -304,6 +371,8 @@ class VersionSet {
   uint64_t last_sequence_;
   uint64_t log_number_;
   uint64_t prev_log_number_;  // 0 or backing store for memtable being compacted
+  std::map<uint32_t, std::string> column_families_;
+  uint32_t max_column_family_;
 
   // Opened lazily
   WritableFile* descriptor_file_;
@@ -326,17 +395,27 @@ class Compaction {
   ~Compaction();
 
   // Return the level that is being compacted.  Inputs from "level"
-  // and "level+1" will be merged to produce a set of "level+1" files.
+  // through "output_level" will be merged to produce a set of
+  // "output_level" files.
   int level() const { return level_; }
 
+  // Return the level that receives the compaction output.  This is
+  // "level+1" except for universal compactions, which may merge
+  // several levels into the oldest one.
+  int output_level() const { return output_level_; }
+
+  // Return the number of levels that inputs are read from.
+  int num_input_levels() const { return output_level_ - level_ + 1; }
+
   // Return the object that holds the edits to the descriptor done
   // by this compaction.
   VersionEdit* edit() { return &edit_; }
 
-  // "which" must be either 0 or 1
+  // "which" must be in [0, num_input_levels())
   int num_input_files(int which) const { return inputs_[which].size(); }
 
-  // Return the ith input file at "level()+which" ("which" must be 0 or 1).
+  // Return the ith input file at "level()+which"
+  // ("which" must be in [0, num_input_levels())).
   FileMetaData* input(int which, int i) const { return inputs_[which][i]; }
 
   // Maximum size of files to build during this compaction.
@@ -350,8 +429,8 @@ class Compaction {
   void AddInputDeletions(VersionEdit* edit);
 
   // Returns true if the information we have available guarantees that
-  // the compaction is producing data in "level+1" for which no data exists
-  // in levels greater than "level+1".
+  // the compaction is producing data in "output_level" for which no data
+  // exists in levels greater than "output_level".
   bool IsBaseLevelForKey(const Slice& user_key);
 
   // Returns true iff we should stop building the current output
@@ -369,15 +448,21 @@ class Compaction {
   Compaction(const Options* options, int level);
 
   int level_;
+  int output_level_;
   uint64_t max_output_file_size_;
   Version* input_version_;
   VersionEdit edit_;
 
-  // Each compaction reads inputs from "level_" and "level_+1"
-  std::vector<FileMetaData*> inputs_[2];      // The two sets of inputs
+  // True if the compaction was picked to drop deletion markers, which
+  // takes rewriting the input rather than moving it.
+  bool deletion_compaction_;
+
+  // Each compaction reads inputs from "level_" through "output_level_".
+  // inputs_[which] holds the input files at level "level_+which".
+  std::vector<FileMetaData*> inputs_[config::kNumLevels];
 
   // State used to check for number of of overlapping grandparent files
-  // (parent == level_ + 1, grandparent == level_ + 2)
+  // (parent == output_level_, grandparent == output_level_ + 1)
   std::vector<FileMetaData*> grandparents_;
   size_t grandparent_index_;  // Index in grandparent_starts_
   bool seen_key_;             // Some output key has been seen
@@ -389,7 +474,7 @@ class Compaction {
   // level_ptrs_ holds indices into input_version_->levels_: our state
   // is that we are positioned at one of the file ranges for each
   // higher level than the ones involved in this compaction (i.e. for
-  // all L >= level_ + 2).
+  // all L > output_level_).
   size_t level_ptrs_[config::kNumLevels];
 };
 
@@ -0,0 +1,496 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Benchmark for the phrase-table access pattern of a statistical machine
+// translation system.  Each entry maps a (target phrase, source phrase)
+// pair to an occurrence counter.  Phrases are sequences of word indexes
+// and keys are encoded as
+//
+//      target words ++ UNUSED_WORD ++ source words
+//
+// where every word index takes kWordIndexBytes bytes in base 254 with each
+// digit shifted by one, so that no key contains a zero byte and all pairs
+// that share a target phrase are stored next to each other.
+//
+// The corpus is synthetic: words are drawn from a Zipf distribution over
+// the vocabulary and entry i is regenerated from a seed derived from i, so
+// later phases can pick existing keys without keeping them in memory.
+// Entries are grouped by target phrase, --phrases_per_target pairs each,
+// and the lookup, scan and update phases pick targets with a Zipf
+// distribution as well.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "leveldb/cache.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/write_batch.h"
+#include "util/hash.h"
+#include "util/histogram.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+// Comma-separated list of operations to run in the specified order
+//   Actual benchmarks:
+//      load        -- write all phrase pairs in batches
+//      lookup      -- point lookups of existing phrase pairs
+//      scan        -- enumerate all source phrases of a target phrase
+//      update      -- increment the counters of existing phrase pairs
+static const char* FLAGS_benchmarks =
+    "load,"
+    "lookup,"
+    "scan,"
+    "update,"
+    "lookup,"
+    ;
+
+// Number of phrase pairs to place in the database
+static int FLAGS_num = 1000000;
+
+// Number of operations performed by each of the lookup, scan and update
+// phases.  Negative means use FLAGS_num.
+static int FLAGS_lookups = -1;
+static int FLAGS_scans = -1;
+static int FLAGS_updates = -1;
+
+// Number of distinct words
+static int FLAGS_vocab_size = 100000;
+
+// Phrases are between 1 and this many words long
+static int FLAGS_max_phrase_length = 5;
+
+// Number of source phrases stored for every target phrase
+static int FLAGS_phrases_per_target = 10;
+
+// Skew of the word and access distributions
+static double FLAGS_zipf_theta = 0.99;
+
+// Number of phrase pairs written per batch by the load phase
+static int FLAGS_batch_size = 1000;
+
+// Number of bytes to use as a cache of uncompressed data.
+// Negative means use default settings.
+static int FLAGS_cache_size = -1;
+
+// Bloom filter bits per key.
+// Negative means use default settings.
+static int FLAGS_bloom_bits = 16;
+
+// Maximum number of files to keep open at the same time (use default if == 0)
+static int FLAGS_open_files = 4000;
+
+// If true, do not destroy the existing database.  If you set this
+// flag and also specify a benchmark that wants a fresh database, that
+// benchmark will fail.
+static bool FLAGS_use_existing_db = false;
+
+// Use the db with the following name.
+static const char* FLAGS_db = NULL;
+
+namespace leveldb {
+
+namespace {
+
+// Key encoding used by the translation system
+static const int kWordIndexBytes = 5;
+static const uint32_t kWordIndexBase = 254;
+
+// Word index separating the target phrase from the source phrase, and
+// the next index, which bounds the keys sharing a target phrase.
+static const uint32_t kUnusedWord = 2;
+static const uint32_t kUnusedWordLimit = 3;
+
+// Indexes below this value are reserved for special symbols
+static const uint32_t kFirstWord = 4;
+
+typedef std::vector<uint32_t> Phrase;
+
+static void AppendWordIndex(std::string* dst, uint32_t w) {
+  char buf[kWordIndexBytes];
+  for (int j = kWordIndexBytes - 1; j >= 0; j--) {
+    buf[j] = static_cast<char>(1 + w % kWordIndexBase);
+    w /= kWordIndexBase;
+  }
+  dst->append(buf, sizeof(buf));
+}
+
+static void AppendPhrase(std::string* dst, const Phrase& p) {
+  for (size_t i = 0; i < p.size(); i++) {
+    AppendWordIndex(dst, p[i]);
+  }
+}
+
+class Corpus {
+ public:
+  Corpus()
+      : num_targets_((FLAGS_num + FLAGS_phrases_per_target - 1) /
+                     FLAGS_phrases_per_target),
+        words_(FLAGS_vocab_size, FLAGS_zipf_theta),
+        targets_(num_targets_ > 1 ? num_targets_ : 2, FLAGS_zipf_theta) {
+  }
+
+  // Store the key of entry "i" in *key
+  void Key(uint64_t i, std::string* key) const {
+    key->clear();
+    Phrase p;
+    GeneratePhrase(i / FLAGS_phrases_per_target, 0x54524700, &p);
+    AppendPhrase(key, p);
+    AppendWordIndex(key, kUnusedWord);
+    GeneratePhrase(i, 0x53524300, &p);
+    AppendPhrase(key, p);
+  }
+
+  // Store the key range [*start, *limit) holding all entries of target
+  // phrase "t" in *start and *limit.
+  void TargetRange(uint64_t t, std::string* start, std::string* limit) const {
+    Phrase p;
+    GeneratePhrase(t, 0x54524700, &p);
+    start->clear();
+    AppendPhrase(start, p);
+    *limit = *start;
+    AppendWordIndex(start, kUnusedWord);
+    AppendWordIndex(limit, kUnusedWordLimit);
+  }
+
+  // Pick a target phrase so that popular targets are accessed more often
+  uint64_t NextTarget(Random* rnd) const {
+    return targets_.NextScrambled(rnd) % num_targets_;
+  }
+
+  // Pick an existing entry, preferring those of popular targets
+  uint64_t NextEntry(Random* rnd) const {
+    uint64_t i = NextTarget(rnd) * FLAGS_phrases_per_target +
+                 rnd->Uniform(FLAGS_phrases_per_target);
+    return i < static_cast<uint64_t>(FLAGS_num) ? i : FLAGS_num - 1;
+  }
+
+ private:
+  void GeneratePhrase(uint64_t n, uint32_t salt, Phrase* p) const {
+    char buf[sizeof(n)];
+    memcpy(buf, &n, sizeof(n));
+    Random rnd(Hash(buf, sizeof(buf), salt));
+    p->resize(1 + rnd.Uniform(FLAGS_max_phrase_length));
+    for (size_t i = 0; i < p->size(); i++) {
+      (*p)[i] = kFirstWord + static_cast<uint32_t>(words_.Next(&rnd));
+    }
+  }
+
+  const uint64_t num_targets_;
+  const test::ZipfianGenerator words_;
+  const test::ZipfianGenerator targets_;
+};
+
+class Benchmark {
+ private:
+  Env* const env_;
+  Cache* cache_;
+  const FilterPolicy* filter_policy_;
+  DB* db_;
+  Corpus corpus_;
+  Random rand_;
+
+  // Per-phase measurements
+  Histogram hist_;
+  uint64_t start_;
+  uint64_t last_op_start_;
+  int64_t done_;
+  int64_t found_;
+  int64_t bytes_;
+
+  void PrintHeader() {
+    fprintf(stdout, "Phrase pairs: %d\n", FLAGS_num);
+    fprintf(stdout, "Phrases/target:%d\n", FLAGS_phrases_per_target);
+    fprintf(stdout, "Vocabulary:   %d words, up to %d per phrase\n",
+            FLAGS_vocab_size, FLAGS_max_phrase_length);
+    fprintf(stdout, "Zipf theta:   %.2f\n", FLAGS_zipf_theta);
+#if defined(__GNUC__) && !defined(__OPTIMIZE__)
+    fprintf(stdout,
+            "WARNING: Optimization is disabled: benchmarks unnecessarily slow\n"
+            );
+#endif
+#ifndef NDEBUG
+    fprintf(stdout,
+            "WARNING: Assertions are enabled; benchmarks unnecessarily slow\n");
+#endif
+    fprintf(stdout, "------------------------------------------------\n");
+  }
+
+  void Start() {
+    hist_.Clear();
+    done_ = 0;
+    found_ = 0;
+    bytes_ = 0;
+    start_ = env_->NowMicros();
+    last_op_start_ = start_;
+  }
+
+  void FinishedOps(int n) {
+    const uint64_t now = env_->NowMicros();
+    hist_.Add(static_cast<double>(now - last_op_start_) / n);
+    last_op_start_ = now;
+    done_ += n;
+  }
+
+  void Stop(const char* name, int64_t ops) {
+    const double elapsed = (env_->NowMicros() - start_) * 1e-6;
+    if (done_ < 1) done_ = 1;
+    char extra[100];
+    extra[0] = '\0';
+    if (ops > 0) {
+      snprintf(extra, sizeof(extra), " (%lld of %lld found)",
+               static_cast<long long>(found_), static_cast<long long>(ops));
+    }
+    if (bytes_ > 0) {
+      const size_t len = strlen(extra);
+      snprintf(extra + len, sizeof(extra) - len, " %6.1f MB/s",
+               (bytes_ / 1048576.0) / elapsed);
+    }
+    fprintf(stdout, "%-12s : %11.3f micros/op; %9.0f ops/sec;%s\n",
+            name, elapsed * 1e6 / done_, done_ / elapsed, extra);
+    fprintf(stdout, "%-12s   P50 %.1f  P99 %.1f  P99.9 %.1f  max %.1f"
+            " micros/op\n", "",
+            hist_.Median(), hist_.Percentile(99), hist_.Percentile(99.9),
+            hist_.Max());
+    fflush(stdout);
+  }
+
+  void Load() {
+    if (FLAGS_use_existing_db) {
+      fprintf(stderr, "load: cannot load into an existing db\n");
+      exit(1);
+    }
+    Start();
+    WriteBatch batch;
+    std::string key;
+    char value[20];
+    Status s;
+    for (int i = 0; i < FLAGS_num; i += FLAGS_batch_size) {
+      batch.Clear();
+      const int n = std::min(FLAGS_batch_size, FLAGS_num - i);
+      for (int j = 0; j < n; j++) {
+        corpus_.Key(i + j, &key);
+        snprintf(value, sizeof(value), "%d", 1 + rand_.Uniform(100));
+        batch.Put(key, value);
+        bytes_ += key.size() + strlen(value);
+      }
+      s = db_->Write(WriteOptions(), &batch);
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+      FinishedOps(n);
+    }
+    Stop("load", 0);
+  }
+
+  void Lookup(int ops) {
+    Start();
+    ReadOptions options;
+    std::string key;
+    std::string value;
+    for (int i = 0; i < ops; i++) {
+      corpus_.Key(corpus_.NextEntry(&rand_), &key);
+      if (db_->Get(options, key, &value).ok()) {
+        found_++;
+      }
+      FinishedOps(1);
+    }
+    Stop("lookup", ops);
+  }
+
+  void Scan(int ops) {
+    Start();
+    ReadOptions options;
+    std::string start, limit;
+    int64_t entries = 0;
+    for (int i = 0; i < ops; i++) {
+      corpus_.TargetRange(corpus_.NextTarget(&rand_), &start, &limit);
+      Iterator* iter = db_->NewIterator(options);
+      int n = 0;
+      for (iter->Seek(start);
+           iter->Valid() && iter->key().compare(limit) < 0;
+           iter->Next()) {
+        bytes_ += iter->key().size() + iter->value().size();
+        n++;
+      }
+      if (!iter->status().ok()) {
+        fprintf(stderr, "scan error: %s\n", iter->status().ToString().c_str());
+        exit(1);
+      }
+      delete iter;
+      if (n > 0) {
+        found_++;
+      }
+      entries += n;
+      FinishedOps(1);
+    }
+    Stop("scan", ops);
+    fprintf(stdout, "%-12s   %.1f source phrases/target\n", "",
+            ops > 0 ? static_cast<double>(entries) / ops : 0.0);
+  }
+
+  void Update(int ops) {
+    Start();
+    std::string key;
+    std::string value;
+    char buf[20];
+    for (int i = 0; i < ops; i++) {
+      corpus_.Key(corpus_.NextEntry(&rand_), &key);
+      int count = 0;
+      Status s = db_->Get(ReadOptions(), key, &value);
+      if (s.ok()) {
+        count = atoi(value.c_str());
+        found_++;
+      } else if (!s.IsNotFound()) {
+        fprintf(stderr, "get error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+      snprintf(buf, sizeof(buf), "%d", count + 1);
+      s = db_->Put(WriteOptions(), key, buf);
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+      FinishedOps(1);
+    }
+    Stop("update", ops);
+  }
+
+  void Open() {
+    assert(db_ == NULL);
+    Options options;
+    options.create_if_missing = !FLAGS_use_existing_db;
+    options.block_cache = cache_;
+    options.filter_policy = filter_policy_;
+    if (FLAGS_open_files > 0) {
+      options.max_open_files = FLAGS_open_files;
+    }
+    Status s = DB::Open(options, FLAGS_db, &db_);
+    if (!s.ok()) {
+      fprintf(stderr, "open error: %s\n", s.ToString().c_str());
+      exit(1);
+    }
+  }
+
+ public:
+  Benchmark()
+      : env_(Env::Default()),
+        cache_(FLAGS_cache_size >= 0 ? NewLRUCache(FLAGS_cache_size) : NULL),
+        filter_policy_(FLAGS_bloom_bits >= 0
+                       ? NewBloomFilterPolicy(FLAGS_bloom_bits)
+                       : NULL),
+        db_(NULL),
+        rand_(301) {
+    if (!FLAGS_use_existing_db) {
+      DestroyDB(FLAGS_db, Options());
+    }
+  }
+
+  ~Benchmark() {
+    delete db_;
+    delete cache_;
+    delete filter_policy_;
+  }
+
+  void Run() {
+    PrintHeader();
+    Open();
+
+    const char* benchmarks = FLAGS_benchmarks;
+    while (benchmarks != NULL) {
+      const char* sep = strchr(benchmarks, ',');
+      Slice name;
+      if (sep == NULL) {
+        name = benchmarks;
+        benchmarks = NULL;
+      } else {
+        name = Slice(benchmarks, sep - benchmarks);
+        benchmarks = sep + 1;
+      }
+
+      if (name == Slice("load")) {
+        Load();
+      } else if (name == Slice("lookup")) {
+        Lookup(FLAGS_lookups < 0 ? FLAGS_num : FLAGS_lookups);
+      } else if (name == Slice("scan")) {
+        Scan(FLAGS_scans < 0 ? FLAGS_num : FLAGS_scans);
+      } else if (name == Slice("update")) {
+        Update(FLAGS_updates < 0 ? FLAGS_num : FLAGS_updates);
+      } else if (!name.empty()) {  // No error message for empty name
+        fprintf(stderr, "unknown benchmark '%s'\n", name.ToString().c_str());
+      }
+    }
+  }
+};
+
+}  // namespace
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  std::string default_db_path;
+
+  for (int i = 1; i < argc; i++) {
+    double d;
+    int n;
+    char junk;
+    if (leveldb::Slice(argv[i]).starts_with("--benchmarks=")) {
+      FLAGS_benchmarks = argv[i] + strlen("--benchmarks=");
+    } else if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1 && n > 0) {
+      FLAGS_num = n;
+    } else if (sscanf(argv[i], "--lookups=%d%c", &n, &junk) == 1) {
+      FLAGS_lookups = n;
+    } else if (sscanf(argv[i], "--scans=%d%c", &n, &junk) == 1) {
+      FLAGS_scans = n;
+    } else if (sscanf(argv[i], "--updates=%d%c", &n, &junk) == 1) {
+      FLAGS_updates = n;
+    } else if (sscanf(argv[i], "--vocab_size=%d%c", &n, &junk) == 1 &&
+               n > 1) {
+      FLAGS_vocab_size = n;
+    } else if (sscanf(argv[i], "--max_phrase_length=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      FLAGS_max_phrase_length = n;
+    } else if (sscanf(argv[i], "--phrases_per_target=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      FLAGS_phrases_per_target = n;
+    } else if (sscanf(argv[i], "--zipf_theta=%lf%c", &d, &junk) == 1 &&
+               d > 0 && d < 1) {
+      FLAGS_zipf_theta = d;
+    } else if (sscanf(argv[i], "--batch_size=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      FLAGS_batch_size = n;
+    } else if (sscanf(argv[i], "--cache_size=%d%c", &n, &junk) == 1) {
+      FLAGS_cache_size = n;
+    } else if (sscanf(argv[i], "--bloom_bits=%d%c", &n, &junk) == 1) {
+      FLAGS_bloom_bits = n;
+    } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
+      FLAGS_open_files = n;
+    } else if (sscanf(argv[i], "--use_existing_db=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_use_existing_db = n;
+    } else if (strncmp(argv[i], "--db=", 5) == 0) {
+      FLAGS_db = argv[i] + 5;
+    } else {
+      fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+      exit(1);
+    }
+  }
+
+  // Choose a location for the test database if none given with --db=<path>
+  if (FLAGS_db == NULL) {
+    leveldb::Env::Default()->GetTestDirectory(&default_db_path);
+    default_db_path += "/wibench";
+    FLAGS_db = default_db_path.c_str();
+  }
+
+  leveldb::Benchmark benchmark;
+  benchmark.Run();
+  return 0;
+}
@@ -8,13 +8,19 @@
 //    data: record[count]
 // record :=
 //    kTypeValue varstring varstring         |
-//    kTypeDeletion varstring
+//    kTypeDeletion varstring                |
+//    kTypeColumnFamilyValue varint32 varstring varstring |
+//    kTypeColumnFamilyDeletion varint32 varstring
 // varstring :=
 //    len: varint32
 //    data: uint8[len]
+//
+// The varint32 of the column family records is the id of the column
+// family.  Updates of the default column family use the plain records.
 
 #include "leveldb/write_batch.h"
 
+#include <algorithm>
 #include "leveldb/db.h"
 #include "db/dbformat.h"
 #include "db/memtable.h"
@@ -26,6 +32,11 @@ namespace leveldb {
 // WriteBatch header has an 8-byte sequence number followed by a 4-byte count.
 static const size_t kHeader = 12;
 
+// Record tags in addition to the ValueTypes.  These never appear in
+// internal keys.
+static const char kTypeColumnFamilyDeletion = 0x4;
+static const char kTypeColumnFamilyValue = 0x5;
+
 WriteBatch::WriteBatch() {
   Clear();
 }
@@ -34,6 +45,20 @@ WriteBatch::~WriteBatch() { }
 
 WriteBatch::Handler::~Handler() { }
 
+void WriteBatch::Handler::PutCF(uint32_t column_family_id,
+                                const Slice& key, const Slice& value) {
+  if (column_family_id == 0) {
+    Put(key, value);
+  }
+}
+
+void WriteBatch::Handler::DeleteCF(uint32_t column_family_id,
+                                   const Slice& key) {
+  if (column_family_id == 0) {
+    Delete(key);
+  }
+}
+
 void WriteBatch::Clear() {
   rep_.clear();
   rep_.resize(kHeader);
@@ -47,6 +72,7 @@ Status WriteBatch::Iterate(Handler* handler) const {
 
   input.remove_prefix(kHeader);
   Slice key, value;
+  uint32_t column_family;
   int found = 0;
   while (!input.empty()) {
     found++;
@@ -68,6 +94,23 @@ Status WriteBatch::Iterate(Handler* handler) const {
           return Status::Corruption("bad WriteBatch Delete");
         }
         break;
+      case kTypeColumnFamilyValue:
+        if (GetVarint32(&input, &column_family) &&
+            GetLengthPrefixedSlice(&input, &key) &&
+            GetLengthPrefixedSlice(&input, &value)) {
+          handler->PutCF(column_family, key, value);
+        } else {
+          return Status::Corruption("bad WriteBatch Put");
+        }
+        break;
+      case kTypeColumnFamilyDeletion:
+        if (GetVarint32(&input, &column_family) &&
+            GetLengthPrefixedSlice(&input, &key)) {
+          handler->DeleteCF(column_family, key);
+        } else {
+          return Status::Corruption("bad WriteBatch Delete");
+        }
+        break;
       default:
         return Status::Corruption("unknown WriteBatch tag");
     }
@@ -108,18 +151,77 @@ void WriteBatch::Delete(const Slice& key) {
   PutLengthPrefixedSlice(&rep_, key);
 }
 
+void WriteBatch::Put(ColumnFamilyHandle* column_family,
+                     const Slice& key, const Slice& value) {
+  const uint32_t id = column_family->GetID();
+  if (id == 0) {
+    Put(key, value);
+    return;
+  }
+  WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+  rep_.push_back(kTypeColumnFamilyValue);
+  PutVarint32(&rep_, id);
+  PutLengthPrefixedSlice(&rep_, key);
+  PutLengthPrefixedSlice(&rep_, value);
+}
+
+void WriteBatch::Delete(ColumnFamilyHandle* column_family, const Slice& key) {
+  const uint32_t id = column_family->GetID();
+  if (id == 0) {
+    Delete(key);
+    return;
+  }
+  WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+  rep_.push_back(kTypeColumnFamilyDeletion);
+  PutVarint32(&rep_, id);
+  PutLengthPrefixedSlice(&rep_, key);
+}
+
+WriteBatchInternal::ColumnFamilyMemTables::~ColumnFamilyMemTables() { }
+
 namespace {
 class MemTableInserter : public WriteBatch::Handler {
  public:
   SequenceNumber sequence_;
-  MemTable* mem_;
+  MemTable* mem_;  // Memtable of the default column family, or NULL
+  WriteBatchInternal::ColumnFamilyMemTables* column_families_;
+  bool inplace_update_;
+  SequenceNumber inplace_min_sequence_;
 
   virtual void Put(const Slice& key, const Slice& value) {
-    mem_->Add(sequence_, kTypeValue, key, value);
-    sequence_++;
+    Add(mem_, key, value);
   }
   virtual void Delete(const Slice& key) {
-    mem_->Add(sequence_, kTypeDeletion, key, Slice());
+    Remove(mem_, key);
+  }
+  virtual void PutCF(uint32_t column_family_id,
+                     const Slice& key, const Slice& value) {
+    Add(GetMemTable(column_family_id), key, value);
+  }
+  virtual void DeleteCF(uint32_t column_family_id, const Slice& key) {
+    Remove(GetMemTable(column_family_id), key);
+  }
+
+ private:
+  MemTable* GetMemTable(uint32_t column_family_id) {
+    if (column_families_ == NULL) {
+      return (column_family_id == 0) ? mem_ : NULL;
+    }
+    return column_families_->GetMemTable(column_family_id);
+  }
+
+  // Every update consumes a sequence number, even if it is skipped
+  void Add(MemTable* mem, const Slice& key, const Slice& value) {
+    if (mem != NULL &&
+        (!inplace_update_ || !mem->Update(key, value, inplace_min_sequence_))) {
+      mem->Add(sequence_, kTypeValue, key, value);
+    }
+    sequence_++;
+  }
+  void Remove(MemTable* mem, const Slice& key) {
+    if (mem != NULL) {
+      mem->Add(sequence_, kTypeDeletion, key, Slice());
+    }
     sequence_++;
   }
 };
@@ -130,9 +232,78 @@ Status WriteBatchInternal::InsertInto(const WriteBatch* b,
   MemTableInserter inserter;
   inserter.sequence_ = WriteBatchInternal::Sequence(b);
   inserter.mem_ = memtable;
+  inserter.column_families_ = NULL;
+  inserter.inplace_update_ = false;
+  inserter.inplace_min_sequence_ = kMaxSequenceNumber;
+  return b->Iterate(&inserter);
+}
+
+Status WriteBatchInternal::InsertInto(const WriteBatch* b,
+                                      MemTable* memtable,
+                                      SequenceNumber inplace_min_sequence) {
+  MemTableInserter inserter;
+  inserter.sequence_ = WriteBatchInternal::Sequence(b);
+  inserter.mem_ = memtable;
+  inserter.column_families_ = NULL;
+  inserter.inplace_update_ = true;
+  inserter.inplace_min_sequence_ = inplace_min_sequence;
+  return b->Iterate(&inserter);
+}
+
+Status WriteBatchInternal::InsertInto(const WriteBatch* b,
+                                      ColumnFamilyMemTables* memtables) {
+  MemTableInserter inserter;
+  inserter.sequence_ = WriteBatchInternal::Sequence(b);
+  inserter.mem_ = memtables->GetMemTable(0);
+  inserter.column_families_ = memtables;
+  inserter.inplace_update_ = false;
+  inserter.inplace_min_sequence_ = kMaxSequenceNumber;
+  return b->Iterate(&inserter);
+}
+
+Status WriteBatchInternal::InsertInto(const WriteBatch* b,
+                                      ColumnFamilyMemTables* memtables,
+                                      SequenceNumber inplace_min_sequence) {
+  MemTableInserter inserter;
+  inserter.sequence_ = WriteBatchInternal::Sequence(b);
+  inserter.mem_ = memtables->GetMemTable(0);
+  inserter.column_families_ = memtables;
+  inserter.inplace_update_ = true;
+  inserter.inplace_min_sequence_ = inplace_min_sequence;
   return b->Iterate(&inserter);
 }
 
+namespace {
+class ColumnFamilyCollector : public WriteBatch::Handler {
+ public:
+  std::vector<uint32_t>* ids_;
+
+  virtual void Put(const Slice& key, const Slice& value) { }
+  virtual void Delete(const Slice& key) { }
+  virtual void PutCF(uint32_t column_family_id,
+                     const Slice& key, const Slice& value) {
+    Add(column_family_id);
+  }
+  virtual void DeleteCF(uint32_t column_family_id, const Slice& key) {
+    Add(column_family_id);
+  }
+
+ private:
+  void Add(uint32_t id) {
+    if (id != 0 && std::find(ids_->begin(), ids_->end(), id) == ids_->end()) {
+      ids_->push_back(id);
+    }
+  }
+};
+}  // namespace
+
+void WriteBatchInternal::AddColumnFamilies(const WriteBatch* b,
+                                           std::vector<uint32_t>* ids) {
+  ColumnFamilyCollector collector;
+  collector.ids_ = ids;
+  b->Iterate(&collector);  // A corrupt batch fails when it is applied
+}
+
 void WriteBatchInternal::SetContents(WriteBatch* b, const Slice& contents) {
   assert(contents.size() >= kHeader);
   b->rep_.assign(contents.data(), contents.size());
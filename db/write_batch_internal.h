@@ -5,6 +5,7 @@
 #ifndef STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 #define STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 
+#include <vector>
 #include "db/dbformat.h"
 #include "leveldb/write_batch.h"
 
@@ -41,7 +42,36 @@ class WriteBatchInternal {
 
   static Status InsertInto(const WriteBatch* batch, MemTable* memtable);
 
+  // Like InsertInto(), but a Put() may overwrite the newest value for its
+  // key in place if that value has sequence number >= inplace_min_sequence.
+  // See MemTable::Update().
+  static Status InsertInto(const WriteBatch* batch, MemTable* memtable,
+                           SequenceNumber inplace_min_sequence);
+
+  // Maps column family ids to the memtables their updates go to.
+  class ColumnFamilyMemTables {
+   public:
+    virtual ~ColumnFamilyMemTables();
+
+    // Return the memtable for updates of column family "id", or NULL if
+    // they should be skipped.
+    virtual MemTable* GetMemTable(uint32_t id) = 0;
+  };
+
+  // Like the InsertInto() variants above, but the updates of every
+  // column family go to the memtable "memtables" maps it to.
+  static Status InsertInto(const WriteBatch* batch,
+                           ColumnFamilyMemTables* memtables);
+  static Status InsertInto(const WriteBatch* batch,
+                           ColumnFamilyMemTables* memtables,
+                           SequenceNumber inplace_min_sequence);
+
   static void Append(WriteBatch* dst, const WriteBatch* src);
+
+  // Add the ids of the column families other than the default one that
+  // "batch" updates to *ids, unless *ids already holds them.
+  static void AddColumnFamilies(const WriteBatch* batch,
+                                std::vector<uint32_t>* ids);
 };
 
 }  // namespace leveldb
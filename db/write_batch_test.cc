@@ -113,6 +113,98 @@ TEST(WriteBatchTest, Append) {
             PrintContents(&b1));
 }
 
+namespace {
+class FakeColumnFamilyHandle : public ColumnFamilyHandle {
+ public:
+  explicit FakeColumnFamilyHandle(uint32_t id) : id_(id), name_("fake") { }
+  virtual const std::string& GetName() const { return name_; }
+  virtual uint32_t GetID() const { return id_; }
+
+ private:
+  uint32_t id_;
+  std::string name_;
+};
+
+class FakeMemTables : public WriteBatchInternal::ColumnFamilyMemTables {
+ public:
+  MemTable* mem[2];
+  virtual MemTable* GetMemTable(uint32_t id) {
+    return (id < 2) ? mem[id] : NULL;
+  }
+};
+
+class CFPrinter : public WriteBatch::Handler {
+ public:
+  std::string state;
+  virtual void Put(const Slice& key, const Slice& value) {
+    PutCF(0, key, value);
+  }
+  virtual void Delete(const Slice& key) {
+    DeleteCF(0, key);
+  }
+  virtual void PutCF(uint32_t id, const Slice& key, const Slice& value) {
+    state.append("Put(" + NumberToString(id) + ", " + key.ToString() + ")");
+  }
+  virtual void DeleteCF(uint32_t id, const Slice& key) {
+    state.append("Delete(" + NumberToString(id) + ", " + key.ToString() + ")");
+  }
+};
+}  // namespace
+
+TEST(WriteBatchTest, ColumnFamilies) {
+  FakeColumnFamilyHandle zero(0), one(1), two(2);
+  WriteBatch batch;
+  batch.Put(&one, "foo", "v1");
+  batch.Put(&zero, "bar", "v2");
+  batch.Delete(&two, "baz");
+  batch.Delete(&one, "box");
+  batch.Put("default", "v3");
+  WriteBatchInternal::SetSequence(&batch, 100);
+  ASSERT_EQ(5, WriteBatchInternal::Count(&batch));
+
+  CFPrinter printer;
+  ASSERT_OK(batch.Iterate(&printer));
+  ASSERT_EQ("Put(1, foo)Put(0, bar)Delete(2, baz)Delete(1, box)"
+            "Put(0, default)",
+            printer.state);
+
+  std::vector<uint32_t> ids;
+  ids.push_back(2);
+  WriteBatchInternal::AddColumnFamilies(&batch, &ids);
+  ASSERT_EQ(2, ids.size());
+  ASSERT_EQ(2, ids[0]);
+  ASSERT_EQ(1, ids[1]);
+
+  // Updates of unknown column families are skipped but still use up a
+  // sequence number
+  InternalKeyComparator cmp(BytewiseComparator());
+  FakeMemTables memtables;
+  for (int i = 0; i < 2; i++) {
+    memtables.mem[i] = new MemTable(cmp);
+    memtables.mem[i]->Ref();
+  }
+  ASSERT_OK(WriteBatchInternal::InsertInto(&batch, &memtables));
+  std::string state[2];
+  for (int i = 0; i < 2; i++) {
+    Iterator* iter = memtables.mem[i]->NewIterator();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ParsedInternalKey ikey;
+      ASSERT_TRUE(ParseInternalKey(iter->key(), &ikey));
+      state[i].append(ikey.user_key.ToString() + "@" +
+                      NumberToString(ikey.sequence) + " ");
+    }
+    delete iter;
+    memtables.mem[i]->Unref();
+  }
+  ASSERT_EQ("bar@101 default@104 ", state[0]);
+  ASSERT_EQ("box@103 foo@100 ", state[1]);
+
+  // Without column family memtables only the default column family is
+  // applied
+  ASSERT_EQ("Put(bar, v2)@101Put(default, v3)@104CountMismatch()",
+            PrintContents(&batch));
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -0,0 +1,84 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/write_controller.h"
+
+#include <algorithm>
+#include "db/dbformat.h"
+
+namespace leveldb {
+
+// Tokens are refilled continuously, but never accumulate beyond what is
+// refilled in this many microseconds.
+static const uint64_t kRefillIntervalMicros = 1000;
+
+const uint64_t WriteController::kMinDelayedWriteRate;
+
+WriteController::WriteController(uint64_t max_delayed_write_rate)
+    : max_rate_(std::max(max_delayed_write_rate, kMinDelayedWriteRate)),
+      delayed_(false),
+      rate_(max_rate_),
+      credit_(0),
+      last_refill_micros_(0),
+      last_level0_files_(0),
+      last_pending_compaction_bytes_(0) {
+}
+
+void WriteController::Update(int level0_files,
+                             uint64_t pending_compaction_bytes) {
+  const bool stall =
+      level0_files >= config::kL0_SlowdownWritesTrigger ||
+      pending_compaction_bytes >=
+          static_cast<uint64_t>(config::kPendingCompactionBytesSlowdownTrigger);
+  if (!stall) {
+    delayed_ = false;
+    rate_ = max_rate_;
+  } else if (!delayed_) {
+    // Start out at the maximum rate with an empty bucket
+    delayed_ = true;
+    rate_ = max_rate_;
+    credit_ = 0;
+    last_refill_micros_ = 0;
+  } else if (level0_files > last_level0_files_ ||
+             pending_compaction_bytes > last_pending_compaction_bytes_) {
+    // Compactions are still falling behind
+    rate_ = std::max(rate_ / 5 * 4, kMinDelayedWriteRate);
+  } else if (level0_files < last_level0_files_ ||
+             pending_compaction_bytes < last_pending_compaction_bytes_) {
+    // Compactions are catching up
+    rate_ = std::min(rate_ / 4 * 5, max_rate_);
+  }
+  last_level0_files_ = level0_files;
+  last_pending_compaction_bytes_ = pending_compaction_bytes;
+}
+
+uint64_t WriteController::GetDelay(uint64_t now_micros, uint64_t num_bytes) {
+  if (!delayed_) {
+    return 0;
+  }
+  if (last_refill_micros_ == 0) {
+    last_refill_micros_ = now_micros;
+  }
+  if (now_micros > last_refill_micros_) {
+    const double max_credit =
+        static_cast<double>(rate_) * kRefillIntervalMicros / 1e6;
+    credit_ += static_cast<double>(now_micros - last_refill_micros_) *
+               rate_ / 1e6;
+    credit_ = std::min(credit_, max_credit);
+    last_refill_micros_ = now_micros;
+  }
+
+  credit_ -= num_bytes;
+  if (credit_ >= 0) {
+    return 0;
+  }
+
+  // Sleep until the bucket is refilled to zero.  Account for the refill
+  // now so that writers queued behind this one wait their turn.
+  last_refill_micros_ += static_cast<uint64_t>(-credit_ * 1e6 / rate_);
+  credit_ = 0;
+  return last_refill_micros_ - now_micros;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,70 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// WriteController decides how fast writes may proceed while compactions
+// are falling behind.  Instead of sleeping for a fixed time per write, it
+// throttles writes to an estimated sustainable rate with a token bucket:
+// every write consumes tokens equal to its size and, once the bucket is
+// empty, the writer is delayed until enough tokens have been refilled.
+//
+// The rate starts at the configured maximum when writes first need to be
+// slowed down and is adjusted as compaction state changes: it shrinks
+// while the number of level-0 files or the pending compaction work keeps
+// growing and recovers while they shrink.
+//
+// Not thread-safe; the DB accesses it under its mutex.
+
+#ifndef STORAGE_LEVELDB_DB_WRITE_CONTROLLER_H_
+#define STORAGE_LEVELDB_DB_WRITE_CONTROLLER_H_
+
+#include <stdint.h>
+
+namespace leveldb {
+
+class WriteController {
+ public:
+  // Writes are never throttled below this many bytes per second.
+  static const uint64_t kMinDelayedWriteRate = 16 * 1024;
+
+  explicit WriteController(uint64_t max_delayed_write_rate);
+
+  // Re-evaluate whether writes must be slowed down given the current
+  // number of level-0 files and the estimated number of bytes that must
+  // be compacted to bring every level under its size limit.
+  void Update(int level0_files, uint64_t pending_compaction_bytes);
+
+  // Returns true iff writes are currently being throttled.
+  bool IsDelayed() const { return delayed_; }
+
+  // Returns the rate in bytes per second that writes are throttled to,
+  // or 0 if writes are not being throttled.
+  uint64_t delayed_write_rate() const { return delayed_ ? rate_ : 0; }
+
+  // Charge a write of "num_bytes" issued at "now_micros" and return the
+  // number of microseconds the writer should sleep before applying it.
+  uint64_t GetDelay(uint64_t now_micros, uint64_t num_bytes);
+
+ private:
+  const uint64_t max_rate_;
+  bool delayed_;
+  uint64_t rate_;                      // Bytes per second while delayed
+
+  // Token bucket state.  Tokens are bytes; the bucket holds at most one
+  // refill interval worth of tokens so that idle periods do not allow
+  // large bursts.
+  double credit_;
+  uint64_t last_refill_micros_;
+
+  // Compaction state observed by the last call to Update()
+  int last_level0_files_;
+  uint64_t last_pending_compaction_bytes_;
+
+  // No copying allowed
+  WriteController(const WriteController&);
+  void operator=(const WriteController&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_WRITE_CONTROLLER_H_
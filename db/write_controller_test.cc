@@ -0,0 +1,83 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/write_controller.h"
+
+#include "db/dbformat.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class WriteControllerTest { };
+
+TEST(WriteControllerTest, NotDelayed) {
+  WriteController controller(1 << 20);
+  controller.Update(config::kL0_SlowdownWritesTrigger - 1, 0);
+  ASSERT_TRUE(!controller.IsDelayed());
+  ASSERT_EQ(0, controller.delayed_write_rate());
+  ASSERT_EQ(0, controller.GetDelay(1000000, 100 << 20));
+}
+
+TEST(WriteControllerTest, TokenBucket) {
+  WriteController controller(1 << 20);   // 1MB/s
+  controller.Update(config::kL0_SlowdownWritesTrigger, 0);
+  ASSERT_TRUE(controller.IsDelayed());
+  ASSERT_EQ(1 << 20, controller.delayed_write_rate());
+
+  // The first write starts with an empty bucket
+  uint64_t now = 1000000;
+  ASSERT_EQ(1000000, controller.GetDelay(now, 1 << 20));
+  now += 1000000;
+
+  // Writes that fit in the refilled tokens are not delayed
+  now += 1000;
+  ASSERT_EQ(0, controller.GetDelay(now, 1000));
+
+  // Idle time does not let tokens accumulate beyond the refill interval
+  now += 10000000;
+  const uint64_t delay = controller.GetDelay(now, 512 << 10);
+  ASSERT_GE(delay, 498000);
+  ASSERT_LE(delay, 500000);
+
+  // A writer arriving before the previous delay is over waits its turn
+  ASSERT_EQ(delay + 500000, controller.GetDelay(now, 512 << 10));
+}
+
+TEST(WriteControllerTest, AdjustsRate) {
+  const int trigger = config::kL0_SlowdownWritesTrigger;
+  WriteController controller(1 << 20);
+  controller.Update(trigger, 0);
+  ASSERT_EQ(1 << 20, controller.delayed_write_rate());
+
+  // Falling further behind lowers the rate, down to a minimum
+  controller.Update(trigger + 1, 0);
+  const uint64_t lowered = controller.delayed_write_rate();
+  ASSERT_LT(lowered, 1 << 20);
+  for (int i = 0; i < 100; i++) {
+    controller.Update(trigger + 1,
+                      config::kPendingCompactionBytesSlowdownTrigger + i);
+  }
+  ASSERT_EQ(WriteController::kMinDelayedWriteRate,
+            controller.delayed_write_rate());
+
+  // An unchanged state keeps the rate; catching up raises it again
+  controller.Update(trigger + 1,
+                    config::kPendingCompactionBytesSlowdownTrigger + 99);
+  ASSERT_EQ(WriteController::kMinDelayedWriteRate,
+            controller.delayed_write_rate());
+  controller.Update(trigger + 1, 0);
+  ASSERT_GT(controller.delayed_write_rate(),
+            WriteController::kMinDelayedWriteRate);
+
+  // Once compactions have caught up writes are no longer throttled
+  controller.Update(0, 0);
+  ASSERT_TRUE(!controller.IsDelayed());
+  ASSERT_EQ(0, controller.delayed_write_rate());
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
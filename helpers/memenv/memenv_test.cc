@@ -158,6 +158,20 @@ TEST(MemEnvTest, Misc) {
   delete writable_file;
 }
 
+TEST(MemEnvTest, LinkFile) {
+  ASSERT_OK(WriteStringToFile(env_, "abc", "/dir/f"));
+  ASSERT_OK(env_->LinkFile("/dir/f", "/dir/g"));
+  ASSERT_TRUE(!env_->LinkFile("/dir/f", "/dir/g").ok());
+  ASSERT_TRUE(!env_->LinkFile("/dir/non_existent", "/dir/h").ok());
+
+  // Both names refer to the same data until one of them is deleted
+  std::string data;
+  ASSERT_OK(env_->DeleteFile("/dir/f"));
+  ASSERT_TRUE(!env_->FileExists("/dir/f"));
+  ASSERT_OK(ReadFileToString(env_, "/dir/g", &data));
+  ASSERT_EQ("abc", data);
+}
+
 TEST(MemEnvTest, LargeWrite) {
   const size_t kWriteSize = 300 * 1024;
   char* scratch = new char[kWriteSize * 2];
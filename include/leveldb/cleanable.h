@@ -0,0 +1,51 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A Cleanable object runs a list of registered cleanup functions when it
+// is destroyed.  Iterators use it to release the blocks and tables their
+// entries point into, and PinnableSlice to release the memory it refers to.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_CLEANABLE_H_
+#define STORAGE_LEVELDB_INCLUDE_CLEANABLE_H_
+
+namespace leveldb {
+
+class Cleanable {
+ public:
+  Cleanable();
+  virtual ~Cleanable();
+
+  // Clients are allowed to register function/arg1/arg2 triples that
+  // will be invoked when this object is destroyed.
+  //
+  // Note that this method is not virtual and therefore clients should
+  // not override it.
+  typedef void (*CleanupFunction)(void* arg1, void* arg2);
+  void RegisterCleanup(CleanupFunction function, void* arg1, void* arg2);
+
+  // Move all cleanups registered with this object to "*other", which
+  // will run them instead of this object.
+  void DelegateCleanupsTo(Cleanable* other);
+
+ protected:
+  // Run all registered cleanups now and forget them.
+  void DoCleanup();
+
+ private:
+  struct Cleanup {
+    CleanupFunction function;
+    void* arg1;
+    void* arg2;
+    Cleanup* next;
+  };
+  Cleanup cleanup_;
+
+  // No copying allowed
+  Cleanable(const Cleanable&);
+  void operator=(const Cleanable&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_CLEANABLE_H_
@@ -7,8 +7,11 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string>
+#include <vector>
 #include "leveldb/iterator.h"
 #include "leveldb/options.h"
+#include "leveldb/pinnable_slice.h"
 
 namespace leveldb {
 
@@ -29,6 +32,33 @@ class Snapshot {
   virtual ~Snapshot();
 };
 
+// A column family is an independent key space of a DB with its own
+// options, memtables and table files.  All column families of a DB share
+// its log, so a WriteBatch that updates several of them is applied
+// atomically, and its background compaction thread.  Every DB has a
+// column family named kDefaultColumnFamilyName, which the methods that
+// take no ColumnFamilyHandle operate on.
+extern const char* kDefaultColumnFamilyName;
+
+class ColumnFamilyHandle {
+ public:
+  virtual ~ColumnFamilyHandle();
+
+  virtual const std::string& GetName() const = 0;
+
+  // The default column family has id 0.  Ids are never reused.
+  virtual uint32_t GetID() const = 0;
+};
+
+struct ColumnFamilyDescriptor {
+  std::string name;
+  Options options;
+
+  ColumnFamilyDescriptor() { }
+  ColumnFamilyDescriptor(const std::string& n, const Options& o)
+      : name(n), options(o) { }
+};
+
 // A range of keys
 struct Range {
   Slice start;          // Included in the range
@@ -48,10 +78,31 @@ class DB {
   // OK on success.
   // Stores NULL in *dbptr and returns a non-OK status on error.
   // Caller should delete *dbptr when it is no longer needed.
+  //
+  // Fails if the database has column families other than the default one.
+  static Status Open(const Options& options,
+                     const std::string& name,
+                     DB** dbptr);
+
+  // Like Open(), but also opens the column families described by
+  // "column_families", which must name every column family of the
+  // database other than the default one (listing the default one as
+  // well is optional).  See CreateColumnFamily() for the options used.
+  // On success, stores a handle for every element of "column_families"
+  // in *handles, in the same order.  The caller should delete the
+  // handles before deleting *dbptr.
   static Status Open(const Options& options,
                      const std::string& name,
+                     const std::vector<ColumnFamilyDescriptor>& column_families,
+                     std::vector<ColumnFamilyHandle*>* handles,
                      DB** dbptr);
 
+  // Store the names of the column families of the database "name",
+  // including the default one, in *column_families.
+  static Status ListColumnFamilies(const Options& options,
+                                   const std::string& name,
+                                   std::vector<std::string>* column_families);
+
   DB() { }
   virtual ~DB();
 
@@ -83,6 +134,22 @@ class DB {
   virtual Status Get(const ReadOptions& options,
                      const Slice& key, std::string* value) = 0;
 
+  // If the database contains an entry for "key", make *value refer to
+  // the corresponding value and return OK.  Values found in tables are
+  // not copied: *value pins the block that holds the value until it is
+  // reset or destroyed.  Values found in memory are copied into
+  // value->GetSelf().
+  //
+  // If there is no entry for "key" reset *value and return a status for
+  // which Status::IsNotFound() returns true.
+  //
+  // May return some other Status on an error.
+  //
+  // The default implementation copies the result of the string Get()
+  // into *value.
+  virtual Status Get(const ReadOptions& options,
+                     const Slice& key, PinnableSlice* value);
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -117,6 +184,15 @@ class DB {
   //     of the sstables that make up the db contents.
   //  "leveldb.approximate-memory-usage" - returns the approximate number of
   //     bytes of memory in use by the DB.
+  //  "leveldb.delayed-write-rate" - returns the rate in bytes per second
+  //     that writes are currently throttled to, or 0 if they are not.
+  //  "leveldb.pending-compaction-bytes" - returns the estimated number of
+  //     bytes that compactions must rewrite before every level is under
+  //     its size limit.
+  //  "leveldb.statistics" - returns a dump of Options::statistics, if set.
+  //  "leveldb.prewarm-progress" - returns "<opened>/<total>", the number of
+  //     table files opened so far by Options::prewarm_tables out of the
+  //     number it set out to open.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
   // For each i in [0,n-1], store in "sizes[i]", the approximate
@@ -142,6 +218,69 @@ class DB {
   //    db->CompactRange(NULL, NULL);
   virtual void CompactRange(const Slice* begin, const Slice* end) = 0;
 
+  // Create a consistent copy of the database in the directory
+  // "checkpoint_dir", which must not exist yet.  The result can be opened
+  // as a database of its own.
+  //
+  // The memtable is flushed first and the table files of the current
+  // state are hard-linked into the checkpoint where the file system
+  // allows it (and copied otherwise), so a checkpoint on the same file
+  // system is cheap and takes no extra space until the database and the
+  // checkpoint diverge.  Writes that are not finished when the call
+  // starts may or may not be part of the checkpoint.
+  //
+  // The default implementation returns NotSupported.
+  virtual Status CreateCheckpoint(const std::string& checkpoint_dir);
+
+  // Create a new column family named "name" and store a handle for it in
+  // *handle.  The caller should delete the handle when it is no longer
+  // needed, and before deleting the DB.
+  //
+  // The options that describe the database as a whole (env, info_log,
+  // paranoid_checks, max_open_files, reuse_logs, delayed_write_rate,
+  // rate_limiter, inplace_update_support, statistics and listeners) are
+  // taken from the options the DB was opened with; the others apply to
+  // the column family only.  A NULL block_cache shares the cache of the
+  // default column family.
+  //
+  // The default implementation returns NotSupported.
+  virtual Status CreateColumnFamily(const Options& options,
+                                    const std::string& name,
+                                    ColumnFamilyHandle** handle);
+
+  // Drop the column family "column_family" and delete its contents once
+  // no iterator refers to it any more.  Later operations on the column
+  // family fail, and updates to it in write batches are ignored.  The
+  // handle must still be deleted.  The default column family cannot be
+  // dropped.
+  //
+  // The default implementation returns NotSupported.
+  virtual Status DropColumnFamily(ColumnFamilyHandle* column_family);
+
+  // Return the handle of the default column family, which is owned by
+  // the DB, or NULL if the DB does not support column families.
+  virtual ColumnFamilyHandle* DefaultColumnFamily() const;
+
+  // Counterparts of the methods above for a specific column family.
+  // The default implementations of Put() and Delete() call Write(); the
+  // others fail.
+  virtual Status Put(const WriteOptions& options,
+                     ColumnFamilyHandle* column_family,
+                     const Slice& key,
+                     const Slice& value);
+  virtual Status Delete(const WriteOptions& options,
+                        ColumnFamilyHandle* column_family,
+                        const Slice& key);
+  virtual Status Get(const ReadOptions& options,
+                     ColumnFamilyHandle* column_family,
+                     const Slice& key, std::string* value);
+  virtual Iterator* NewIterator(const ReadOptions& options,
+                                ColumnFamilyHandle* column_family);
+  virtual bool GetProperty(ColumnFamilyHandle* column_family,
+                           const Slice& property, std::string* value);
+  virtual void CompactRange(ColumnFamilyHandle* column_family,
+                            const Slice* begin, const Slice* end);
+
  private:
   // No copying allowed
   DB(const DB&);
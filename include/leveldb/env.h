@@ -84,6 +84,24 @@ class Env {
   virtual Status NewAppendableFile(const std::string& fname,
                                    WritableFile** result);
 
+  // Like NewRandomAccessFile(), but the returned file bypasses the
+  // operating system's page cache if the Env supports it, so that large
+  // background reads (e.g. compaction inputs) do not evict data cached
+  // for foreground reads.  The file does its own readahead and is best
+  // suited for mostly sequential reads.
+  //
+  // The default implementation calls NewRandomAccessFile().
+  virtual Status NewDirectRandomAccessFile(const std::string& fname,
+                                           RandomAccessFile** result);
+
+  // Like NewWritableFile(), but the returned file bypasses the operating
+  // system's page cache if the Env supports it.  Data is buffered by the
+  // file itself and may not reach the file system until Sync() or Close().
+  //
+  // The default implementation calls NewWritableFile().
+  virtual Status NewDirectWritableFile(const std::string& fname,
+                                       WritableFile** result);
+
   // Returns true iff the named file exists.
   virtual bool FileExists(const std::string& fname) = 0;
 
@@ -109,6 +127,12 @@ class Env {
   virtual Status RenameFile(const std::string& src,
                             const std::string& target) = 0;
 
+  // Create "target" as a hard link to the existing file "src", so that
+  // both names refer to the same data.  Fails if "target" exists.
+  //
+  // The default implementation returns NotSupported.
+  virtual Status LinkFile(const std::string& src, const std::string& target);
+
   // Lock the specified file.  Used to prevent concurrent access to
   // the same db by multiple processes.  On failure, stores NULL in
   // *lock and returns non-OK.
@@ -144,6 +168,15 @@ class Env {
   // When "function(arg)" returns, the thread will be destroyed.
   virtual void StartThread(void (*function)(void* arg), void* arg) = 0;
 
+  // Arrange to run "(*function)(arg)" once in a thread reserved for short
+  // reads issued on behalf of foreground operations, such as iterator
+  // prefetching, so that they do not queue up behind background work
+  // added with Schedule().  Functions may run concurrently.
+  //
+  // The default implementation runs "(*function)(arg)" in the calling
+  // thread before returning.
+  virtual void ScheduleRead(void (*function)(void* arg), void* arg);
+
   // *path is set to a temporary directory that can be used for testing. It may
   // or many not have just been created. The directory may or may not differ
   // between runs of the same process, but subsequent calls will return the
@@ -157,6 +190,11 @@ class Env {
   // useful for computing deltas of time.
   virtual uint64_t NowMicros() = 0;
 
+  // Returns the number of nano-seconds since some fixed point in time. Only
+  // useful for computing deltas of time.  The default implementation is
+  // derived from NowMicros().
+  virtual uint64_t NowNanos();
+
   // Sleep/delay the thread for the prescribed number of micro-seconds.
   virtual void SleepForMicroseconds(int micros) = 0;
 
@@ -197,6 +235,18 @@ class SequentialFile {
   void operator=(const SequentialFile&);
 };
 
+// A single read issued through RandomAccessFile::MultiRead().
+struct ReadRequest {
+  // Filled in by the caller
+  uint64_t offset;
+  size_t n;
+  char* scratch;      // Must have room for at least "n" bytes
+
+  // Filled in by MultiRead()
+  Slice result;
+  Status status;
+};
+
 // A file abstraction for randomly reading the contents of a file.
 class RandomAccessFile {
  public:
@@ -215,6 +265,16 @@ class RandomAccessFile {
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
 
+  // Read every request in "requests[0..n-1]" as if by Read(), setting
+  // each request's "result" and "status".  Implementations may issue the
+  // reads concurrently so that their latencies overlap; the call returns
+  // once all of them have completed.
+  //
+  // The default implementation calls Read() for each request in turn.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void MultiRead(ReadRequest* requests, size_t n) const;
+
  private:
   // No copying allowed
   RandomAccessFile(const RandomAccessFile&);
@@ -307,6 +367,13 @@ class EnvWrapper : public Env {
   Status NewAppendableFile(const std::string& f, WritableFile** r) {
     return target_->NewAppendableFile(f, r);
   }
+  Status NewDirectRandomAccessFile(const std::string& f,
+                                   RandomAccessFile** r) {
+    return target_->NewDirectRandomAccessFile(f, r);
+  }
+  Status NewDirectWritableFile(const std::string& f, WritableFile** r) {
+    return target_->NewDirectWritableFile(f, r);
+  }
   bool FileExists(const std::string& f) { return target_->FileExists(f); }
   Status GetChildren(const std::string& dir, std::vector<std::string>* r) {
     return target_->GetChildren(dir, r);
@@ -320,6 +387,9 @@ class EnvWrapper : public Env {
   Status RenameFile(const std::string& s, const std::string& t) {
     return target_->RenameFile(s, t);
   }
+  Status LinkFile(const std::string& s, const std::string& t) {
+    return target_->LinkFile(s, t);
+  }
   Status LockFile(const std::string& f, FileLock** l) {
     return target_->LockFile(f, l);
   }
@@ -330,6 +400,9 @@ class EnvWrapper : public Env {
   void StartThread(void (*f)(void*), void* a) {
     return target_->StartThread(f, a);
   }
+  void ScheduleRead(void (*f)(void*), void* a) {
+    return target_->ScheduleRead(f, a);
+  }
   virtual Status GetTestDirectory(std::string* path) {
     return target_->GetTestDirectory(path);
   }
@@ -339,6 +412,9 @@ class EnvWrapper : public Env {
   uint64_t NowMicros() {
     return target_->NowMicros();
   }
+  uint64_t NowNanos() {
+    return target_->NowNanos();
+  }
   void SleepForMicroseconds(int micros) {
     target_->SleepForMicroseconds(micros);
   }
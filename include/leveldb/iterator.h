@@ -15,12 +15,15 @@
 #ifndef STORAGE_LEVELDB_INCLUDE_ITERATOR_H_
 #define STORAGE_LEVELDB_INCLUDE_ITERATOR_H_
 
+#include "leveldb/cleanable.h"
 #include "leveldb/slice.h"
 #include "leveldb/status.h"
 
 namespace leveldb {
 
-class Iterator {
+// Functions registered with RegisterCleanup() run when the iterator is
+// destroyed.
+class Iterator : public Cleanable {
  public:
   Iterator();
   virtual ~Iterator();
@@ -67,23 +70,16 @@ class Iterator {
   // If an error has occurred, return it.  Else return an ok status.
   virtual Status status() const = 0;
 
-  // Clients are allowed to register function/arg1/arg2 triples that
-  // will be invoked when this iterator is destroyed.
-  //
-  // Note that unlike all of the preceding methods, this method is
-  // not abstract and therefore clients should not override it.
-  typedef void (*CleanupFunction)(void* arg1, void* arg2);
-  void RegisterCleanup(CleanupFunction function, void* arg1, void* arg2);
+  // Rebind the iterator to the current state of its source so that it
+  // sees the updates made since it was created or last refreshed.  The
+  // iterator is not Valid() after this call; position it with one of the
+  // Seek methods.  Iterators that read as of an explicit snapshot keep
+  // reading as of that snapshot.  Returns NotSupported if the source
+  // cannot be refreshed, as is the case for all iterators other than
+  // those returned by DB::NewIterator().
+  virtual Status Refresh();
 
  private:
-  struct Cleanup {
-    CleanupFunction function;
-    void* arg1;
-    void* arg2;
-    Cleanup* next;
-  };
-  Cleanup cleanup_;
-
   // No copying allowed
   Iterator(const Iterator&);
   void operator=(const Iterator&);
@@ -0,0 +1,98 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// An EventListener is notified of background events inside a database,
+// such as memtable flushes, compactions, write stalls and the deletion of
+// table files.  Listeners are registered with Options::listeners.
+//
+// Events are delivered in order, shortly after they happen, without
+// holding any database lock: on the background compaction thread between
+// pieces of work, or on a writer thread once its write has finished.  A
+// slow callback therefore delays that thread.  A callback may call
+// read-only methods such as DB::Get() or DB::GetProperty(), but must not
+// write to the database (Put(), Delete(), Write()) or wait for background
+// work to finish (e.g. by calling CompactRange()), since that may
+// deadlock.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_LISTENER_H_
+#define STORAGE_LEVELDB_INCLUDE_LISTENER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class DB;
+
+struct FlushJobInfo {
+  std::string db_name;
+  std::string column_family_name;
+  std::string file_path;        // Table file written by the flush
+  uint64_t file_number;
+  uint64_t file_size;
+  int level;                    // Level the table file was placed in
+  uint64_t micros;              // Time taken by the flush
+};
+
+struct CompactionJobInfo {
+  std::string db_name;
+  std::string column_family_name;
+  int level;                    // Level being compacted
+  int output_level;
+  std::vector<std::string> input_files;
+  std::vector<std::string> output_files;  // Only set on completion
+
+  // Only set on completion
+  uint64_t bytes_read;
+  uint64_t bytes_written;
+  uint64_t micros;
+  Status status;
+};
+
+enum WriteStallCondition {
+  kStallNormal = 0,             // Writes proceed at full speed
+  kStallDelayed = 1,            // Writes are being throttled
+  kStallStopped = 2             // Writes wait for background work
+};
+
+struct WriteStallInfo {
+  std::string db_name;
+  WriteStallCondition condition;
+  WriteStallCondition prev_condition;
+};
+
+struct TableFileDeletionInfo {
+  std::string db_name;
+  std::string file_path;
+  uint64_t file_number;
+  Status status;                // Result of deleting the file
+};
+
+class EventListener {
+ public:
+  virtual ~EventListener();
+
+  // Called after a memtable has been written to a table file and the
+  // file has been added to the database.
+  virtual void OnFlushCompleted(DB* db, const FlushJobInfo& info) { }
+
+  // Called before a compaction starts reading its input files, and after
+  // it has finished (successfully or not).  Compactions that merely move
+  // a file to the next level are not reported.
+  virtual void OnCompactionBegin(DB* db, const CompactionJobInfo& info) { }
+  virtual void OnCompactionCompleted(DB* db, const CompactionJobInfo& info) { }
+
+  // Called when writes start or stop being delayed or stopped because
+  // background work is falling behind.
+  virtual void OnStallConditionChanged(DB* db, const WriteStallInfo& info) { }
+
+  // Called after an obsolete table file has been deleted.
+  virtual void OnTableFileDeleted(const TableFileDeletionInfo& info) { }
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_LISTENER_H_
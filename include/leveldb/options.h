@@ -6,15 +6,19 @@
 #define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
 
 #include <stddef.h>
+#include <vector>
 
 namespace leveldb {
 
 class Cache;
 class Comparator;
 class Env;
+class EventListener;
 class FilterPolicy;
 class Logger;
+class RateLimiter;
 class Snapshot;
+class Statistics;
 
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
@@ -27,6 +31,20 @@ enum CompressionType {
   kSnappyCompression = 0x1
 };
 
+// The compaction style determines how table files are merged in the
+// background.  The following enum describes the available styles.
+enum CompactionStyle {
+  // Each level is a single sorted run that is about 10x larger than the
+  // previous level.  Keeps space and read amplification low at the cost
+  // of rewriting data once per level.
+  kCompactionStyleLevel     = 0x0,
+
+  // Sorted runs are merged with each other when they have similar sizes,
+  // so data is rewritten far less often.  Uses more disk space and
+  // consults more sorted runs per read than kCompactionStyleLevel.
+  kCompactionStyleUniversal = 0x1
+};
+
 // Options to control the behavior of a database (passed to DB::Open)
 struct Options {
   // -------------------
@@ -153,6 +171,124 @@ struct Options {
   // Default: NULL
   const FilterPolicy* filter_policy;
 
+  // Select how table files are compacted in the background.  A database
+  // may be reopened with a different compaction style.
+  //
+  // Default: kCompactionStyleLevel
+  CompactionStyle compaction_style;
+
+  // If true, the leveled compaction style derives the target size of each
+  // level from the actual size of the largest level instead of using fixed
+  // 10MB*10^(L-1) targets.  Each level is one tenth of the size of the next
+  // one, and level-0 is compacted directly into the smallest level whose
+  // target is still at least 10MB; the levels above it are kept empty.
+  // This keeps space amplification close to 1.1x regardless of how large
+  // the database grows.
+  //
+  // Default: false
+  bool dynamic_level_bytes;
+
+  // With the leveled compaction style, a table file in which at least this
+  // fraction of the entries are deletion markers is compacted into the
+  // next level even if no level is over its size limit.  This gets rid of
+  // the markers left behind by deleting a large range of keys, which
+  // would otherwise slow down every scan over that range until new
+  // writes happen to push the file down.  Compactions triggered by the
+  // size of a level take precedence.  A value <= 0 disables this; 0.5 is
+  // a reasonable setting for workloads that delete ranges of keys.
+  //
+  // When enabled, the descriptor records the number of entries and
+  // deletion markers of every new table file, in a form that versions of
+  // leveldb without this option cannot read.
+  //
+  // Default: 0
+  double deletion_compaction_ratio;
+
+  // When compactions fall behind (too many level-0 files or too many bytes
+  // waiting to be compacted), writes are throttled to an estimated
+  // sustainable rate instead of being stalled outright.  This is the rate,
+  // in bytes per second, that throttling starts at; it is lowered while
+  // compactions keep falling further behind and raised again as they
+  // catch up.  The current rate is reported by the
+  // "leveldb.delayed-write-rate" property.
+  //
+  // Default: 16MB/s
+  size_t delayed_write_rate;
+
+  // If non-NULL, table files written by memtable compactions (at high
+  // priority) and by background compactions (at low priority) request
+  // tokens from the specified rate limiter before every write, bounding
+  // the disk bandwidth taken away from foreground reads.  See
+  // NewGenericRateLimiter() in "leveldb/rate_limiter.h".
+  //
+  // Default: NULL
+  RateLimiter* rate_limiter;
+
+  // If true, memtable compactions and background compactions read their
+  // input tables and write their output tables with direct I/O (see
+  // Env::NewDirectRandomAccessFile() and Env::NewDirectWritableFile()),
+  // bypassing the operating system's page cache.  Background I/O then no
+  // longer evicts cached data that serves foreground reads.  Envs and
+  // file systems without direct I/O support fall back to buffered I/O.
+  //
+  // Default: false
+  bool use_direct_io_for_flush_and_compaction;
+
+  // If non-zero, compactions read their input table files through a
+  // readahead buffer of this many bytes, turning one small read per block
+  // into a few large sequential reads.  This helps most on spinning disks and network
+  // block devices.  Direct I/O (see above) does its own readahead.
+  //
+  // Default: 2MB
+  size_t compaction_readahead_size;
+
+  // If true, DB::Open() starts background threads that open the live
+  // table files before they are first needed, so that the first reads
+  // after a restart do not pay for opening files and reading their index
+  // and filter blocks.  No more tables are opened than the table cache
+  // holds (see max_open_files), starting with level-0.  The
+  // "leveldb.prewarm-progress" property reports how far this has got.
+  //
+  // Default: false
+  bool prewarm_tables;
+
+  // If prewarm_tables is true, also load up to this many bytes of data
+  // blocks into the block cache, starting with the tables of the lowest
+  // levels, which hold the most recently written data.
+  //
+  // Default: 0
+  size_t prewarm_data_bytes;
+
+  // If true, a Put() of a key whose newest version is a value in the
+  // current write buffer overwrites that value in place instead of
+  // appending a new entry, provided the new value is no larger than the
+  // old one and no live snapshot can observe the old value.  This keeps
+  // write buffer usage proportional to the number of distinct keys for
+  // workloads that repeatedly rewrite fixed-size values (e.g. counters).
+  //
+  // Iterators and reads that are in progress when such a write happens
+  // may observe the new value even though it was written after they
+  // started.  They never observe a partially written value.  Explicit
+  // snapshots (DB::GetSnapshot()) are not affected.
+  //
+  // Default: false
+  bool inplace_update_support;
+
+  // If non-NULL, the database records counters of internal events and
+  // histograms of operation latencies in this object.  They can be read
+  // through the object itself or the "leveldb.statistics" property.  See
+  // CreateDBStatistics() in "leveldb/statistics.h".
+  //
+  // Default: NULL
+  Statistics* statistics;
+
+  // Listeners notified of flushes, compactions, write stalls and table
+  // file deletions.  See "leveldb/listener.h".  The listeners are owned by
+  // the client and must outlive the database.
+  //
+  // Default: empty
+  std::vector<EventListener*> listeners;
+
   // Create an Options object with default values for all fields.
   Options();
 };
@@ -176,10 +312,28 @@ struct ReadOptions {
   // Default: NULL
   const Snapshot* snapshot;
 
+  // If positive, iterators that detect a sequential forward scan read up
+  // to this many of the following blocks of a table, and the following
+  // tables of a level, in the background ahead of the scan.  This overlaps
+  // I/O with the processing of keys by the caller.
+  // Default: 0
+  int prefetch_blocks;
+
+  // If true, the iterator follows the DB as it is written to: every Seek,
+  // SeekToFirst and SeekToLast sees all the updates made before it, as if
+  // Refresh() had been called first.  As long as no memtable compaction
+  // or compaction has happened since the previous seek the iterator
+  // is not rebuilt, which makes polling for new keys cheap.  "snapshot" is
+  // ignored by tailing iterators.
+  // Default: false
+  bool tailing;
+
   ReadOptions()
       : verify_checksums(false),
         fill_cache(true),
-        snapshot(NULL) {
+        snapshot(NULL),
+        prefetch_blocks(0),
+        tailing(false) {
   }
 };
 
@@ -0,0 +1,97 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A PerfContext breaks down where the calling thread spent its time and
+// what work it did inside the database, for example to find out why a
+// particular Get() was slow:
+//
+//   leveldb::SetPerfLevel(leveldb::kEnableTime);
+//   leveldb::GetPerfContext()->Reset();
+//   db->Get(leveldb::ReadOptions(), key, &value);
+//   fprintf(stderr, "%s\n", leveldb::GetPerfContext()->ToString().c_str());
+//
+// The context and the perf level are thread-local, so the counters only
+// reflect operations issued by the calling thread.  Work done on behalf of
+// the caller by background threads (e.g. block prefetching) is not counted.
+// Counters accumulate until Reset() is called.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
+#define STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
+
+#include <stdint.h>
+#include <string>
+
+namespace leveldb {
+
+enum PerfLevel {
+  kDisablePerf = 0,     // Collect nothing (the default)
+  kEnableCount = 1,     // Collect counters only
+  kEnableTime = 2       // Collect counters and timings
+};
+
+// Set and return the perf level of the calling thread.
+extern void SetPerfLevel(PerfLevel level);
+extern PerfLevel GetPerfLevel();
+
+// All timings are in nanoseconds.
+struct PerfContext {
+  // Zero all counters.
+  void Reset();
+
+  // Return a human readable list of the non-zero counters.
+  std::string ToString() const;
+
+  // Memtable lookups done by Get() and the time they took
+  uint64_t get_from_memtable_count;
+  uint64_t get_from_memtable_time;
+
+  // Time Get() spent looking the key up in table files, and the number of
+  // table files it consulted
+  uint64_t get_from_output_files_time;
+  uint64_t get_sst_files_consulted;
+
+  // Time spent waiting for the DB mutex
+  uint64_t db_mutex_lock_nanos;
+
+  // Table lookups that consulted the filter policy, and lookups that the
+  // filter ruled out
+  uint64_t bloom_filter_checked;
+  uint64_t bloom_filter_useful;
+
+  // Blocks read from table files (data, index and filter blocks), the
+  // number of bytes read and the time the reads took
+  uint64_t block_read_count;
+  uint64_t block_read_byte;
+  uint64_t block_read_time;
+
+  // Index blocks read when opening table files
+  uint64_t index_block_read_count;
+
+  // Data blocks found in the block cache
+  uint64_t block_cache_hit_count;
+
+  // Time spent verifying block checksums
+  uint64_t block_checksum_time;
+
+  // Compressed blocks, their uncompressed size and the time it took to
+  // decompress them
+  uint64_t block_decompress_count;
+  uint64_t bytes_decompressed;
+  uint64_t block_decompress_time;
+
+  // Time iterators spent seeking their internal iterator
+  uint64_t seek_internal_seek_time;
+
+  // Internal entries that iterators stepped over because they were
+  // deletion markers or were hidden by a newer entry or deletion
+  uint64_t internal_delete_skipped_count;
+  uint64_t internal_key_skipped_count;
+};
+
+// Return the perf context of the calling thread.
+extern PerfContext* GetPerfContext();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
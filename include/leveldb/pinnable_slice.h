@@ -0,0 +1,80 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// PinnableSlice is a Slice that keeps the data it refers to alive.  It
+// either pins memory owned by the database, such as a block cache entry
+// or a memory-mapped table, until it is reset or destroyed, or it holds a
+// copy of the data in its own buffer.  DB::Get() uses it to return values
+// found in tables without copying them.
+//
+// A pinned value holds on to the block that contains it, so callers
+// should reset or destroy the slice once they are done with the value.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_PINNABLE_SLICE_H_
+#define STORAGE_LEVELDB_INCLUDE_PINNABLE_SLICE_H_
+
+#include <assert.h>
+#include <string>
+#include "leveldb/cleanable.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class PinnableSlice : public Slice, public Cleanable {
+ public:
+  PinnableSlice() : pinned_(false), buf_(&self_space_) { }
+
+  // Copies of the data are stored in "*buf", which must outlive this
+  // slice.
+  explicit PinnableSlice(std::string* buf) : pinned_(false), buf_(buf) { }
+
+  virtual ~PinnableSlice() { Reset(); }
+
+  // Refer to "s" without copying it.  The cleanups registered with this
+  // slice must keep the data of "s" alive until they run.
+  void PinSlice(const Slice& s) {
+    assert(!pinned_);
+    pinned_ = true;
+    Slice::operator=(s);
+  }
+
+  // Refer to a copy of "s" held in the slice's buffer.
+  void PinSelf(const Slice& s) {
+    assert(!pinned_);
+    buf_->assign(s.data(), s.size());
+    Slice::operator=(*buf_);
+  }
+
+  // Refer to the current contents of the buffer returned by GetSelf().
+  void PinSelf() {
+    assert(!pinned_);
+    Slice::operator=(*buf_);
+  }
+
+  // Return the buffer holding copies of the data.
+  std::string* GetSelf() { return buf_; }
+
+  // Returns true iff the slice refers to memory owned by the database.
+  bool IsPinned() const { return pinned_; }
+
+  // Release any pinned memory and make the slice empty.
+  void Reset() {
+    DoCleanup();
+    pinned_ = false;
+    clear();
+  }
+
+ private:
+  bool pinned_;
+  std::string self_space_;
+  std::string* buf_;
+
+  // No copying allowed
+  PinnableSlice(const PinnableSlice&);
+  void operator=(const PinnableSlice&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_PINNABLE_SLICE_H_
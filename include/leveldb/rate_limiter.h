@@ -0,0 +1,55 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A database can be configured with a RateLimiter object that bounds the
+// rate at which memtable compactions (flushes) and background compactions
+// write table files.  Limiting background writes keeps them from
+// saturating the disk and hurting the latency of foreground reads.
+//
+// A RateLimiter has internal synchronization and may be shared by
+// several databases to bound their combined background I/O.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace leveldb {
+
+class RateLimiter {
+ public:
+  // Requests of a higher priority are granted before pending requests
+  // of a lower priority.
+  enum Priority {
+    kLowPriority = 0,     // Background compactions
+    kHighPriority = 1,    // Memtable compactions
+    kNumPriorities = 2
+  };
+
+  virtual ~RateLimiter();
+
+  // Block until "bytes" may be written at the given priority.
+  virtual void Request(size_t bytes, Priority priority) = 0;
+
+  // Return the number of bytes per second currently allowed.
+  virtual int64_t GetBytesPerSecond() const = 0;
+
+  // Return the total number of bytes requested at the given priority.
+  virtual int64_t GetTotalBytesThrough(Priority priority) const = 0;
+};
+
+// Return a new rate limiter that allows at most "bytes_per_second" bytes
+// to be written per second.
+//
+// If "auto_tuned" is true, "bytes_per_second" is an upper bound and the
+// actual limit is adjusted to the demand: it is raised while the limiter
+// is exhausted most of the time and lowered while it is mostly idle, down
+// to 1/20th of "bytes_per_second".
+extern RateLimiter* NewGenericRateLimiter(int64_t bytes_per_second,
+                                          bool auto_tuned);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
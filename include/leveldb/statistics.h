@@ -0,0 +1,101 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A database can be configured with a Statistics object that collects
+// counters ("tickers") of internal events, such as block cache hits or
+// bytes written, and histograms of operation latencies.  The counters
+// are sharded by CPU core so that collecting them is cheap enough to
+// leave on in production.
+//
+// A Statistics object has internal synchronization and may be shared by
+// several databases to collect their combined statistics.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_STATISTICS_H_
+#define STORAGE_LEVELDB_INCLUDE_STATISTICS_H_
+
+#include <stdint.h>
+#include <string>
+
+namespace leveldb {
+
+enum Ticker {
+  // Data block lookups in Options::block_cache
+  kBlockCacheHit = 0,
+  kBlockCacheMiss,
+
+  // Table lookups that the filter policy ruled out, and lookups that it
+  // let through although the table did not contain the key
+  kBloomFilterUseful,
+  kBloomFilterFalsePositive,
+
+  // Get() calls answered by a memtable, and those that went on to tables
+  kMemtableHit,
+  kMemtableMiss,
+
+  // Get() calls answered by a table in level 0, level 1, and deeper levels
+  kGetHitL0,
+  kGetHitL1,
+  kGetHitL2AndUp,
+
+  // Keys and bytes of values returned by Get(), and keys and bytes of
+  // write batches applied by Write()
+  kNumberKeysRead,
+  kBytesRead,
+  kNumberKeysWritten,
+  kBytesWritten,
+
+  // Bytes of table files read and written by compactions, and written
+  // by memtable compactions
+  kCompactReadBytes,
+  kCompactWriteBytes,
+  kFlushWriteBytes,
+
+  // Time writers spent waiting because compactions were falling behind
+  kStallMicros,
+
+  kNumTickers
+};
+
+enum HistogramType {
+  kDbGetMicros = 0,
+  kDbWriteMicros,
+  kCompactionMicros,
+  kFlushMicros,
+
+  kNumHistograms
+};
+
+class Statistics {
+ public:
+  virtual ~Statistics();
+
+  // Add "count" to the ticker.
+  virtual void RecordTick(Ticker ticker, uint64_t count) = 0;
+
+  // Return the current value of the ticker.
+  virtual uint64_t GetTickerCount(Ticker ticker) const = 0;
+
+  // Add a sample of "micros" to the histogram.
+  virtual void MeasureTime(HistogramType histogram, uint64_t micros) = 0;
+
+  // Return a human-readable summary of the histogram.
+  virtual std::string GetHistogramString(HistogramType histogram) const = 0;
+
+  // Clear all tickers and histograms.
+  virtual void Reset() = 0;
+
+  // Return a human-readable dump of all tickers and histograms.
+  virtual std::string ToString() const = 0;
+};
+
+// Return the name of the ticker or histogram, as used by ToString().
+extern const char* TickerName(Ticker ticker);
+extern const char* HistogramName(HistogramType histogram);
+
+// Return a new Statistics object.
+extern Statistics* CreateDBStatistics();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_STATISTICS_H_
@@ -12,7 +12,6 @@ namespace leveldb {
 
 class Block;
 class BlockHandle;
-class Footer;
 struct Options;
 class RandomAccessFile;
 struct ReadOptions;
@@ -61,18 +60,36 @@ class Table {
 
   explicit Table(Rep* rep) { rep_ = rep; }
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
+  static Iterator* DataFileBlockReader(void*, const ReadOptions&,
+                                       const Slice&);
+  static Iterator* ReadDataBlock(const Table* table, RandomAccessFile* file,
+                                 const ReadOptions& options,
+                                 const Slice& index_value);
 
   // Calls (*handle_result)(arg, ...) with the entry found after a call
   // to Seek(key).  May not make such a call if filter policy says
-  // that key is not present.
+  // that key is not present.  If "pin" is non-NULL, the block holding
+  // the entry is kept alive until "pin" runs its cleanups.
   friend class TableCache;
   Status InternalGet(
       const ReadOptions&, const Slice& key,
       void* arg,
-      void (*handle_result)(void* arg, const Slice& k, const Slice& v));
-
-
-  void ReadMeta(const Footer& footer);
+      void (*handle_result)(void* arg, const Slice& k, const Slice& v),
+      Cleanable* pin);
+
+  // Like NewIterator(), but reads the data blocks that are not in the
+  // block cache from "data_file" instead of the file of the table.
+  // "data_file" must hold the same contents and remain live while the
+  // returned iterator is in use.
+  Iterator* NewIterator(const ReadOptions&,
+                        RandomAccessFile* data_file) const;
+
+  // Read data blocks into the block cache, in order, until at least
+  // "max_bytes" bytes have been read or the table ends.  Used to warm up
+  // the block cache.
+  void LoadDataBlocks(uint64_t max_bytes) const;
+
+  void ReadMeta(Block* meta);
   void ReadFilter(const Slice& filter_handle_value);
 
   // No copying allowed
@@ -21,11 +21,13 @@
 #ifndef STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_H_
 #define STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_H_
 
+#include <stdint.h>
 #include <string>
 #include "leveldb/status.h"
 
 namespace leveldb {
 
+class ColumnFamilyHandle;
 class Slice;
 
 class WriteBatch {
@@ -39,6 +41,13 @@ class WriteBatch {
   // If the database contains a mapping for "key", erase it.  Else do nothing.
   void Delete(const Slice& key);
 
+  // Like Put() and Delete(), but for the column family "column_family".
+  // All updates of a batch are applied atomically, whatever their
+  // column families.
+  void Put(ColumnFamilyHandle* column_family,
+           const Slice& key, const Slice& value);
+  void Delete(ColumnFamilyHandle* column_family, const Slice& key);
+
   // Clear all updates buffered in this batch.
   void Clear();
 
@@ -48,6 +57,13 @@ class WriteBatch {
     virtual ~Handler();
     virtual void Put(const Slice& key, const Slice& value) = 0;
     virtual void Delete(const Slice& key) = 0;
+
+    // Updates of the column family with id "column_family_id".  The
+    // default implementations pass updates of the default column family
+    // (id 0) to Put() and Delete() and ignore all others.
+    virtual void PutCF(uint32_t column_family_id,
+                       const Slice& key, const Slice& value);
+    virtual void DeleteCF(uint32_t column_family_id, const Slice& key);
   };
   Status Iterate(Handler* handler) const;
 
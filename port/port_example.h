@@ -70,6 +70,27 @@ typedef intptr_t OnceType;
 #define LEVELDB_ONCE_INIT 0
 extern void InitOnce(port::OnceType*, void (*initializer)());
 
+// Thread-local storage.
+// If the platform supports it cheaply, define LEVELDB_THREAD_LOCAL to a
+// qualifier that gives a variable of static storage duration one
+// instance per thread, e.g.
+//      static LEVELDB_THREAD_LOCAL int counter;
+// The variable must have a constant initializer and no destructor.
+// Leave it undefined otherwise; callers then fall back to ThreadLocal.
+#define LEVELDB_THREAD_LOCAL __thread
+
+// Holds one value-initialized T per thread, created by the first Get()
+// of the thread and deleted when the thread exits.
+template <typename T>
+class ThreadLocal {
+ public:
+  ThreadLocal();
+  ~ThreadLocal();
+
+  // Return the instance of the calling thread.
+  T* Get();
+};
+
 // A type that holds a pointer that can be read or written atomically
 // (i.e., without word-tearing.)
 class AtomicPointer {
@@ -135,6 +156,11 @@ extern bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg);
 // the newly extended CRC value (which may also be zero).
 uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size);
 
+// Returns the index of the CPU core the calling thread is running on, or
+// a negative value if it cannot be determined.  Used to spread counters
+// across cores.
+extern int PhysicalCoreID();
+
 }  // namespace port
 }  // namespace leveldb
 
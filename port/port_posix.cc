@@ -5,6 +5,7 @@
 #include "port/port_posix.h"
 
 #include <cstdlib>
+#include <sched.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -49,5 +50,13 @@ void InitOnce(OnceType* once, void (*initializer)()) {
   PthreadCall("once", pthread_once(once, initializer));
 }
 
+int PhysicalCoreID() {
+#if defined(OS_LINUX) && defined(__GLIBC__)
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
 }  // namespace port
 }  // namespace leveldb
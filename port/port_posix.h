@@ -39,6 +39,7 @@
 #endif
 
 #include <pthread.h>
+#include <stdlib.h>
 #ifdef SNAPPY
 #include <snappy.h>
 #endif
@@ -113,6 +114,37 @@ typedef pthread_once_t OnceType;
 #define LEVELDB_ONCE_INIT PTHREAD_ONCE_INIT
 extern void InitOnce(OnceType* once, void (*initializer)());
 
+#if defined(__GNUC__)
+#define LEVELDB_THREAD_LOCAL __thread
+#endif
+
+template <typename T>
+class ThreadLocal {
+ public:
+  ThreadLocal() {
+    if (pthread_key_create(&key_, &Delete) != 0) abort();
+  }
+  ~ThreadLocal() { pthread_key_delete(key_); }
+
+  T* Get() {
+    T* value = reinterpret_cast<T*>(pthread_getspecific(key_));
+    if (value == NULL) {
+      value = new T();
+      pthread_setspecific(key_, value);
+    }
+    return value;
+  }
+
+ private:
+  static void Delete(void* value) { delete reinterpret_cast<T*>(value); }
+
+  pthread_key_t key_;
+
+  // No copying allowed
+  ThreadLocal(const ThreadLocal&);
+  void operator=(const ThreadLocal&);
+};
+
 inline bool Snappy_Compress(const char* input, size_t length,
                             ::std::string* output) {
 #ifdef SNAPPY
@@ -150,6 +182,8 @@ inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
 
 uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size);
 
+int PhysicalCoreID();
+
 } // namespace port
 } // namespace leveldb
 
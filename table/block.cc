@@ -87,6 +87,22 @@ class Block::Iter : public Iterator {
   Slice value_;
   Status status_;
 
+  // Keys are delta encoded from the start of their restart interval, so
+  // Prev() has to decode the interval from its start.  It remembers the
+  // entries it decodes so that the following calls to Prev() within the
+  // same interval only step back through prev_entries_.  While
+  // prev_index_ >= 0 the current entry is prev_entries_[prev_index_] and
+  // key_ does not hold its key.
+  struct CachedEntry {
+    uint32_t offset;      // Offset in data_ of the entry
+    size_t key_offset;    // Offset in prev_keys_ of the key of the entry
+    size_t key_size;
+    Slice value;
+  };
+  std::vector<CachedEntry> prev_entries_;
+  std::string prev_keys_;   // Keys of prev_entries_, back to back
+  int prev_index_;
+
   inline int Compare(const Slice& a, const Slice& b) const {
     return comparator_->Compare(a, b);
   }
@@ -102,6 +118,7 @@ class Block::Iter : public Iterator {
   }
 
   void SeekToRestartPoint(uint32_t index) {
+    prev_index_ = -1;
     key_.clear();
     restart_index_ = index;
     // current_ will be fixed by ParseNextKey();
@@ -121,7 +138,8 @@ class Block::Iter : public Iterator {
         restarts_(restarts),
         num_restarts_(num_restarts),
         current_(restarts_),
-        restart_index_(num_restarts_) {
+        restart_index_(num_restarts_),
+        prev_index_(-1) {
     assert(num_restarts_ > 0);
   }
 
@@ -129,6 +147,10 @@ class Block::Iter : public Iterator {
   virtual Status status() const { return status_; }
   virtual Slice key() const {
     assert(Valid());
+    if (prev_index_ >= 0) {
+      const CachedEntry& entry = prev_entries_[prev_index_];
+      return Slice(prev_keys_.data() + entry.key_offset, entry.key_size);
+    }
     return key_;
   }
   virtual Slice value() const {
@@ -138,12 +160,27 @@ class Block::Iter : public Iterator {
 
   virtual void Next() {
     assert(Valid());
+    if (prev_index_ >= 0) {
+      // ParseNextKey() needs the key of the current entry
+      const CachedEntry& entry = prev_entries_[prev_index_];
+      key_.assign(prev_keys_.data() + entry.key_offset, entry.key_size);
+      prev_index_ = -1;
+    }
     ParseNextKey();
   }
 
   virtual void Prev() {
     assert(Valid());
 
+    if (prev_index_ > 0) {
+      // The previous entry is in the same restart interval
+      prev_index_--;
+      const CachedEntry& entry = prev_entries_[prev_index_];
+      current_ = entry.offset;
+      value_ = entry.value;
+      return;
+    }
+
     // Scan backwards to a restart point before current_
     const uint32_t original = current_;
     while (GetRestartPoint(restart_index_) >= original) {
@@ -151,15 +188,14 @@ class Block::Iter : public Iterator {
         // No more entries
         current_ = restarts_;
         restart_index_ = num_restarts_;
+        prev_index_ = -1;
         return;
       }
       restart_index_--;
     }
 
-    SeekToRestartPoint(restart_index_);
-    do {
-      // Loop until end of current entry hits the start of original entry
-    } while (ParseNextKey() && NextEntryOffset() < original);
+    // Loop until end of current entry hits the start of original entry
+    DecodeRestartInterval(original);
   }
 
   virtual void Seek(const Slice& target) {
@@ -208,21 +244,43 @@ class Block::Iter : public Iterator {
   }
 
   virtual void SeekToLast() {
-    SeekToRestartPoint(num_restarts_ - 1);
-    while (ParseNextKey() && NextEntryOffset() < restarts_) {
-      // Keep skipping
-    }
+    // A reverse scan is likely to follow
+    restart_index_ = num_restarts_ - 1;
+    DecodeRestartInterval(restarts_);
   }
 
  private:
   void CorruptionError() {
     current_ = restarts_;
     restart_index_ = num_restarts_;
+    prev_index_ = -1;
     status_ = Status::Corruption("bad entry in block");
     key_.clear();
     value_.clear();
   }
 
+  // Decode the entries of restart interval restart_index_ that start
+  // before "limit" into prev_entries_ and position the iterator at the
+  // last of them.
+  void DecodeRestartInterval(uint32_t limit) {
+    SeekToRestartPoint(restart_index_);
+    prev_entries_.clear();
+    prev_keys_.clear();
+    do {
+      if (!ParseNextKey()) {
+        return;
+      }
+      CachedEntry entry;
+      entry.offset = current_;
+      entry.key_offset = prev_keys_.size();
+      entry.key_size = key_.size();
+      entry.value = value_;
+      prev_entries_.push_back(entry);
+      prev_keys_.append(key_);
+    } while (NextEntryOffset() < limit);
+    prev_index_ = static_cast<int>(prev_entries_.size()) - 1;
+  }
+
   bool ParseNextKey() {
     current_ = NextEntryOffset();
     const char* p = data_ + current_;
@@ -4,11 +4,13 @@
 
 #include "table/format.h"
 
+#include <vector>
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "table/block.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/perf_context_imp.h"
 
 namespace leveldb {
 
@@ -62,24 +64,14 @@ Status Footer::DecodeFrom(Slice* input) {
   return result;
 }
 
-Status ReadBlock(RandomAccessFile* file,
-                 const ReadOptions& options,
-                 const BlockHandle& handle,
-                 BlockContents* result) {
-  result->data = Slice();
-  result->cachable = false;
-  result->heap_allocated = false;
-
-  // Read the block contents as well as the type/crc footer.
-  // See table_builder.cc for the code that built this structure.
-  size_t n = static_cast<size_t>(handle.size());
-  char* buf = new char[n + kBlockTrailerSize];
-  Slice contents;
-  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
-  if (!s.ok()) {
-    delete[] buf;
-    return s;
-  }
+// Verify and uncompress the raw contents of a block of "n" bytes (plus
+// trailer) that were read into "buf".  Takes ownership of "buf".
+static Status DecodeBlock(const ReadOptions& options,
+                          size_t n,
+                          char* buf,
+                          const Slice& contents,
+                          BlockContents* result) {
+  Status s;
   if (contents.size() != n + kBlockTrailerSize) {
     delete[] buf;
     return Status::Corruption("truncated block read");
@@ -88,6 +80,7 @@ Status ReadBlock(RandomAccessFile* file,
   // Check the crc of the type and the block contents
   const char* data = contents.data();    // Pointer to where Read put the data
   if (options.verify_checksums) {
+    PERF_TIMER_GUARD(block_checksum_time);
     const uint32_t crc = crc32c::Unmask(DecodeFixed32(data + n + 1));
     const uint32_t actual = crc32c::Value(data, n + 1);
     if (actual != crc) {
@@ -116,6 +109,7 @@ Status ReadBlock(RandomAccessFile* file,
       // Ok
       break;
     case kSnappyCompression: {
+      PERF_TIMER_GUARD(block_decompress_time);
       size_t ulength = 0;
       if (!port::Snappy_GetUncompressedLength(data, n, &ulength)) {
         delete[] buf;
@@ -128,6 +122,8 @@ Status ReadBlock(RandomAccessFile* file,
         return Status::Corruption("corrupted compressed block contents");
       }
       delete[] buf;
+      PERF_COUNTER_ADD(block_decompress_count, 1);
+      PERF_COUNTER_ADD(bytes_decompressed, ulength);
       result->data = Slice(ubuf, ulength);
       result->heap_allocated = true;
       result->cachable = true;
@@ -141,4 +137,64 @@ Status ReadBlock(RandomAccessFile* file,
   return Status::OK();
 }
 
+Status ReadBlock(RandomAccessFile* file,
+                 const ReadOptions& options,
+                 const BlockHandle& handle,
+                 BlockContents* result) {
+  result->data = Slice();
+  result->cachable = false;
+  result->heap_allocated = false;
+
+  // Read the block contents as well as the type/crc footer.
+  // See table_builder.cc for the code that built this structure.
+  size_t n = static_cast<size_t>(handle.size());
+  char* buf = new char[n + kBlockTrailerSize];
+  Slice contents;
+  PerfTimer timer(&CurrentPerfContext()->block_read_time);
+  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
+  timer.Stop();
+  PERF_COUNTER_ADD(block_read_count, 1);
+  PERF_COUNTER_ADD(block_read_byte, contents.size());
+  if (!s.ok()) {
+    delete[] buf;
+    return s;
+  }
+  return DecodeBlock(options, n, buf, contents, result);
+}
+
+void ReadBlocks(RandomAccessFile* file,
+                const ReadOptions& options,
+                const BlockHandle* handles,
+                size_t n,
+                BlockContents* results,
+                Status* statuses) {
+  if (n == 0) {
+    return;
+  }
+  std::vector<ReadRequest> requests(n);
+  for (size_t i = 0; i < n; i++) {
+    results[i].data = Slice();
+    results[i].cachable = false;
+    results[i].heap_allocated = false;
+    requests[i].offset = handles[i].offset();
+    requests[i].n = static_cast<size_t>(handles[i].size()) + kBlockTrailerSize;
+    requests[i].scratch = new char[requests[i].n];
+  }
+  PerfTimer timer(&CurrentPerfContext()->block_read_time);
+  file->MultiRead(&requests[0], n);
+  timer.Stop();
+  PERF_COUNTER_ADD(block_read_count, n);
+  for (size_t i = 0; i < n; i++) {
+    PERF_COUNTER_ADD(block_read_byte, requests[i].result.size());
+    if (!requests[i].status.ok()) {
+      delete[] requests[i].scratch;
+      statuses[i] = requests[i].status;
+    } else {
+      statuses[i] = DecodeBlock(options, requests[i].n - kBlockTrailerSize,
+                                requests[i].scratch, requests[i].result,
+                                &results[i]);
+    }
+  }
+}
+
 }  // namespace leveldb
@@ -96,6 +96,17 @@ extern Status ReadBlock(RandomAccessFile* file,
                         const BlockHandle& handle,
                         BlockContents* result);
 
+// Read the "n" blocks identified by "handles[0..n-1]" from "file" with a
+// single batched read so that the underlying reads may be serviced
+// concurrently.  Sets statuses[i] and, on success, results[i] for every
+// block.
+extern void ReadBlocks(RandomAccessFile* file,
+                       const ReadOptions& options,
+                       const BlockHandle* handles,
+                       size_t n,
+                       BlockContents* results,
+                       Status* statuses);
+
 // Implementation details follow.  Clients should ignore,
 
 inline BlockHandle::BlockHandle()
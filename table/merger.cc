@@ -4,6 +4,7 @@
 
 #include "table/merger.h"
 
+#include <vector>
 #include "leveldb/comparator.h"
 #include "leveldb/iterator.h"
 #include "table/iterator_wrapper.h"
@@ -36,24 +37,24 @@ class MergingIterator : public Iterator {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToFirst();
     }
-    FindSmallest();
     direction_ = kForward;
+    BuildHeap();
   }
 
   virtual void SeekToLast() {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToLast();
     }
-    FindLargest();
     direction_ = kReverse;
+    BuildHeap();
   }
 
   virtual void Seek(const Slice& target) {
     for (int i = 0; i < n_; i++) {
       children_[i].Seek(target);
     }
-    FindSmallest();
     direction_ = kForward;
+    BuildHeap();
   }
 
   virtual void Next() {
@@ -76,10 +77,13 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kForward;
+      current_->Next();
+      BuildHeap();
+      return;
     }
 
     current_->Next();
-    FindSmallest();
+    ReplaceTop();
   }
 
   virtual void Prev() {
@@ -105,10 +109,13 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kReverse;
+      current_->Prev();
+      BuildHeap();
+      return;
     }
 
     current_->Prev();
-    FindLargest();
+    ReplaceTop();
   }
 
   virtual Slice key() const {
@@ -133,17 +140,34 @@ class MergingIterator : public Iterator {
   }
 
  private:
-  void FindSmallest();
-  void FindLargest();
+  // Returns true iff "a" should be yielded before "b" in the current
+  // direction.  Ties are broken by child index so that equal keys are
+  // yielded in the same order as by a linear scan of the children.
+  bool Before(const IteratorWrapper* a, const IteratorWrapper* b) const {
+    const int r = comparator_->Compare(a->key(), b->key());
+    if (direction_ == kForward) {
+      return r < 0 || (r == 0 && a < b);
+    } else {
+      return r > 0 || (r == 0 && a > b);
+    }
+  }
+
+  void BuildHeap();
+  void ReplaceTop();
+  void SiftDown(size_t i);
 
-  // We might want to use a heap in case there are lots of children.
-  // For now we use a simple array since we expect a very small number
-  // of children in leveldb.
   const Comparator* comparator_;
   IteratorWrapper* children_;
   int n_;
   IteratorWrapper* current_;
 
+  // The valid children, ordered as a binary heap whose top is the child
+  // to yield next in the current direction: the smallest one when moving
+  // forward and the largest one in reverse.  current_ is the top.  Each
+  // step costs O(log n) comparisons, and only two when the current child
+  // stays at the top.
+  std::vector<IteratorWrapper*> heap_;
+
   // Which direction is the iterator moving?
   enum Direction {
     kForward,
@@ -152,34 +176,51 @@ class MergingIterator : public Iterator {
   Direction direction_;
 };
 
-void MergingIterator::FindSmallest() {
-  IteratorWrapper* smallest = NULL;
+void MergingIterator::BuildHeap() {
+  heap_.clear();
   for (int i = 0; i < n_; i++) {
-    IteratorWrapper* child = &children_[i];
-    if (child->Valid()) {
-      if (smallest == NULL) {
-        smallest = child;
-      } else if (comparator_->Compare(child->key(), smallest->key()) < 0) {
-        smallest = child;
-      }
+    if (children_[i].Valid()) {
+      heap_.push_back(&children_[i]);
     }
   }
-  current_ = smallest;
+  for (size_t i = heap_.size() / 2; i > 0; i--) {
+    SiftDown(i - 1);
+  }
+  current_ = heap_.empty() ? NULL : heap_[0];
 }
 
-void MergingIterator::FindLargest() {
-  IteratorWrapper* largest = NULL;
-  for (int i = n_-1; i >= 0; i--) {
-    IteratorWrapper* child = &children_[i];
-    if (child->Valid()) {
-      if (largest == NULL) {
-        largest = child;
-      } else if (comparator_->Compare(child->key(), largest->key()) > 0) {
-        largest = child;
-      }
+void MergingIterator::ReplaceTop() {
+  assert(!heap_.empty() && heap_[0] == current_);
+  if (!current_->Valid()) {
+    heap_[0] = heap_.back();
+    heap_.pop_back();
+  }
+  if (!heap_.empty()) {
+    SiftDown(0);
+    current_ = heap_[0];
+  } else {
+    current_ = NULL;
+  }
+}
+
+void MergingIterator::SiftDown(size_t i) {
+  const size_t n = heap_.size();
+  IteratorWrapper* const child = heap_[i];
+  while (true) {
+    size_t first = 2 * i + 1;
+    if (first >= n) {
+      break;
+    }
+    if (first + 1 < n && Before(heap_[first + 1], heap_[first])) {
+      first++;
+    }
+    if (!Before(heap_[first], child)) {
+      break;
     }
+    heap_[i] = heap_[first];
+    i = first;
   }
-  current_ = largest;
+  heap_[i] = child;
 }
 }  // namespace
 
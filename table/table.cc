@@ -14,6 +14,8 @@
 #include "table/format.h"
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
+#include "util/perf_context_imp.h"
+#include "util/statistics.h"
 
 namespace leveldb {
 
@@ -54,20 +56,25 @@ Status Table::Open(const Options& options,
   s = footer.DecodeFrom(&footer_input);
   if (!s.ok()) return s;
 
-  // Read the index block
-  BlockContents contents;
-  Block* index_block = NULL;
-  if (s.ok()) {
-    ReadOptions opt;
-    if (options.paranoid_checks) {
-      opt.verify_checksums = true;
-    }
-    s = ReadBlock(file, opt, footer.index_handle(), &contents);
-    if (s.ok()) {
-      index_block = new Block(contents);
-    }
+  // Read the index block, and the metaindex block if a filter may need to
+  // be loaded, with a single batched read.
+  ReadOptions opt;
+  if (options.paranoid_checks) {
+    opt.verify_checksums = true;
   }
+  BlockHandle handles[2];
+  handles[0] = footer.index_handle();
+  handles[1] = footer.metaindex_handle();
+  BlockContents contents[2];
+  Status statuses[2];
+  const size_t num_blocks = (options.filter_policy != NULL) ? 2 : 1;
+  ReadBlocks(file, opt, handles, num_blocks, contents, statuses);
 
+  // Errors reading the metaindex are not propagated since meta info is
+  // not needed for operation.
+  Block* meta = (num_blocks > 1 && statuses[1].ok()) ?
+      new Block(contents[1]) : NULL;
+  s = statuses[0];
   if (s.ok()) {
     // We've successfully read the footer and the index block: we're
     // ready to serve requests.
@@ -75,37 +82,24 @@ Status Table::Open(const Options& options,
     rep->options = options;
     rep->file = file;
     rep->metaindex_handle = footer.metaindex_handle();
-    rep->index_block = index_block;
+    rep->index_block = new Block(contents[0]);
+    PERF_COUNTER_ADD(index_block_read_count, 1);
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
     rep->filter_data = NULL;
     rep->filter = NULL;
     *table = new Table(rep);
-    (*table)->ReadMeta(footer);
-  } else {
-    delete index_block;
+    if (meta != NULL) {
+      (*table)->ReadMeta(meta);
+    }
   }
+  delete meta;
 
   return s;
 }
 
-void Table::ReadMeta(const Footer& footer) {
-  if (rep_->options.filter_policy == NULL) {
-    return;  // Do not need any metadata
-  }
-
+void Table::ReadMeta(Block* meta) {
   // TODO(sanjay): Skip this if footer.metaindex_handle() size indicates
   // it is an empty block.
-  ReadOptions opt;
-  if (rep_->options.paranoid_checks) {
-    opt.verify_checksums = true;
-  }
-  BlockContents contents;
-  if (!ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents).ok()) {
-    // Do not propagate errors since meta info is not needed for operation
-    return;
-  }
-  Block* meta = new Block(contents);
-
   Iterator* iter = meta->NewIterator(BytewiseComparator());
   std::string key = "filter.";
   key.append(rep_->options.filter_policy->Name());
@@ -114,7 +108,6 @@ void Table::ReadMeta(const Footer& footer) {
     ReadFilter(iter->value());
   }
   delete iter;
-  delete meta;
 }
 
 void Table::ReadFilter(const Slice& filter_handle_value) {
@@ -165,6 +158,31 @@ Iterator* Table::BlockReader(void* arg,
                              const ReadOptions& options,
                              const Slice& index_value) {
   Table* table = reinterpret_cast<Table*>(arg);
+  return ReadDataBlock(table, table->rep_->file, options, index_value);
+}
+
+namespace {
+struct TableAndDataFile {
+  const Table* table;
+  RandomAccessFile* file;
+};
+}  // namespace
+
+static void DeleteTableAndDataFile(void* arg, void* ignored) {
+  delete reinterpret_cast<TableAndDataFile*>(arg);
+}
+
+Iterator* Table::DataFileBlockReader(void* arg,
+                                     const ReadOptions& options,
+                                     const Slice& index_value) {
+  TableAndDataFile* data_file = reinterpret_cast<TableAndDataFile*>(arg);
+  return ReadDataBlock(data_file->table, data_file->file, options,
+                       index_value);
+}
+
+Iterator* Table::ReadDataBlock(const Table* table, RandomAccessFile* file,
+                               const ReadOptions& options,
+                               const Slice& index_value) {
   Cache* block_cache = table->rep_->options.block_cache;
   Block* block = NULL;
   Cache::Handle* cache_handle = NULL;
@@ -185,8 +203,11 @@ Iterator* Table::BlockReader(void* arg,
       cache_handle = block_cache->Lookup(key);
       if (cache_handle != NULL) {
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
+        RecordTick(table->rep_->options.statistics, kBlockCacheHit);
+        PERF_COUNTER_ADD(block_cache_hit_count, 1);
       } else {
-        s = ReadBlock(table->rep_->file, options, handle, &contents);
+        RecordTick(table->rep_->options.statistics, kBlockCacheMiss);
+        s = ReadBlock(file, options, handle, &contents);
         if (s.ok()) {
           block = new Block(contents);
           if (contents.cachable && options.fill_cache) {
@@ -196,7 +217,7 @@ Iterator* Table::BlockReader(void* arg,
         }
       }
     } else {
-      s = ReadBlock(table->rep_->file, options, handle, &contents);
+      s = ReadBlock(file, options, handle, &contents);
       if (s.ok()) {
         block = new Block(contents);
       }
@@ -220,12 +241,47 @@ Iterator* Table::BlockReader(void* arg,
 Iterator* Table::NewIterator(const ReadOptions& options) const {
   return NewTwoLevelIterator(
       rep_->index_block->NewIterator(rep_->options.comparator),
-      &Table::BlockReader, const_cast<Table*>(this), options);
+      &Table::BlockReader, const_cast<Table*>(this), options,
+      rep_->options.env);
+}
+
+Iterator* Table::NewIterator(const ReadOptions& options,
+                             RandomAccessFile* data_file) const {
+  TableAndDataFile* arg = new TableAndDataFile;
+  arg->table = this;
+  arg->file = data_file;
+  Iterator* result = NewTwoLevelIterator(
+      rep_->index_block->NewIterator(rep_->options.comparator),
+      &Table::DataFileBlockReader, arg, options, rep_->options.env);
+  result->RegisterCleanup(&DeleteTableAndDataFile, arg, NULL);
+  return result;
+}
+
+void Table::LoadDataBlocks(uint64_t max_bytes) const {
+  if (rep_->options.block_cache == NULL) {
+    return;
+  }
+  ReadOptions options;
+  Iterator* index_iter =
+      rep_->index_block->NewIterator(rep_->options.comparator);
+  uint64_t loaded = 0;
+  for (index_iter->SeekToFirst(); index_iter->Valid() && loaded < max_bytes;
+       index_iter->Next()) {
+    Slice input = index_iter->value();
+    BlockHandle handle;
+    if (!handle.DecodeFrom(&input).ok()) {
+      break;
+    }
+    delete BlockReader(const_cast<Table*>(this), options, index_iter->value());
+    loaded += handle.size();
+  }
+  delete index_iter;
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice& k,
                           void* arg,
-                          void (*saver)(void*, const Slice&, const Slice&)) {
+                          void (*saver)(void*, const Slice&, const Slice&),
+                          Cleanable* pin) {
   Status s;
   Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
   iiter->Seek(k);
@@ -233,15 +289,27 @@ Status Table::InternalGet(const ReadOptions& options, const Slice& k,
     Slice handle_value = iiter->value();
     FilterBlockReader* filter = rep_->filter;
     BlockHandle handle;
+    if (filter != NULL) {
+      PERF_COUNTER_ADD(bloom_filter_checked, 1);
+    }
     if (filter != NULL &&
         handle.DecodeFrom(&handle_value).ok() &&
         !filter->KeyMayMatch(handle.offset(), k)) {
       // Not found
+      RecordTick(rep_->options.statistics, kBloomFilterUseful);
+      PERF_COUNTER_ADD(bloom_filter_useful, 1);
     } else {
       Iterator* block_iter = BlockReader(this, options, iiter->value());
       block_iter->Seek(k);
-      if (block_iter->Valid()) {
+      if (!block_iter->Valid()) {
+        if (filter != NULL && block_iter->status().ok()) {
+          RecordTick(rep_->options.statistics, kBloomFilterFalsePositive);
+        }
+      } else {
         (*saver)(arg, block_iter->key(), block_iter->value());
+        if (pin != NULL) {
+          block_iter->DelegateCleanupsTo(pin);
+        }
       }
       s = block_iter->status();
       delete block_iter;
@@ -4,10 +4,15 @@
 
 #include "table/two_level_iterator.h"
 
+#include <deque>
+#include <vector>
+#include "leveldb/env.h"
 #include "leveldb/table.h"
+#include "port/port.h"
 #include "table/block.h"
 #include "table/format.h"
 #include "table/iterator_wrapper.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
@@ -15,13 +20,18 @@ namespace {
 
 typedef Iterator* (*BlockFunction)(void*, const ReadOptions&, const Slice&);
 
+// Number of consecutive blocks a forward scan must move through before
+// the following blocks are prefetched.
+static const int kSequentialScanBlocks = 2;
+
 class TwoLevelIterator: public Iterator {
  public:
   TwoLevelIterator(
     Iterator* index_iter,
     BlockFunction block_function,
     void* arg,
-    const ReadOptions& options);
+    const ReadOptions& options,
+    Env* env);
 
   virtual ~TwoLevelIterator();
 
@@ -62,33 +72,68 @@ class TwoLevelIterator: public Iterator {
   void SetDataIterator(Iterator* data_iter);
   void InitDataBlock();
 
+  // A block that is being, or has been, loaded in the background
+  struct Prefetch {
+    std::string handle;
+    bool done;
+    Iterator* block_iter;  // Set once done
+  };
+  // Blocks loaded in order by one background task
+  struct PrefetchBatch {
+    TwoLevelIterator* iter;
+    std::vector<Prefetch*> blocks;
+  };
+  static void LoadBlocks(void* arg);
+  void PrefetchBlocks();
+  Iterator* TakePrefetched(const Slice& handle);
+  void ClearPrefetched();
+
   BlockFunction block_function_;
   void* arg_;
   const ReadOptions options_;
+  Env* const env_;
   Status status_;
   IteratorWrapper index_iter_;
   IteratorWrapper data_iter_; // May be NULL
   // If data_iter_ is non-NULL, then "data_block_handle_" holds the
   // "index_value" passed to block_function_ to create the data_iter_.
   std::string data_block_handle_;
+
+  // Number of blocks the iterator has moved through with Next() since the
+  // last seek or change of direction.
+  int sequential_blocks_;
+
+  // Blocks following the current one, in index order, that have been
+  // handed to env_->ScheduleRead().
+  port::Mutex mu_;
+  port::CondVar cv_;
+  std::deque<Prefetch*> prefetched_;
 };
 
 TwoLevelIterator::TwoLevelIterator(
     Iterator* index_iter,
     BlockFunction block_function,
     void* arg,
-    const ReadOptions& options)
+    const ReadOptions& options,
+    Env* env)
     : block_function_(block_function),
       arg_(arg),
       options_(options),
+      env_(env),
       index_iter_(index_iter),
-      data_iter_(NULL) {
+      data_iter_(NULL),
+      sequential_blocks_(0),
+      cv_(&mu_) {
 }
 
 TwoLevelIterator::~TwoLevelIterator() {
+  // Background loads use block_function_, whose state may be released
+  // along with this iterator, so wait for them to finish.
+  ClearPrefetched();
 }
 
 void TwoLevelIterator::Seek(const Slice& target) {
+  sequential_blocks_ = 0;
   index_iter_.Seek(target);
   InitDataBlock();
   if (data_iter_.iter() != NULL) data_iter_.Seek(target);
@@ -96,6 +141,7 @@ void TwoLevelIterator::Seek(const Slice& target) {
 }
 
 void TwoLevelIterator::SeekToFirst() {
+  sequential_blocks_ = 0;
   index_iter_.SeekToFirst();
   InitDataBlock();
   if (data_iter_.iter() != NULL) data_iter_.SeekToFirst();
@@ -103,6 +149,7 @@ void TwoLevelIterator::SeekToFirst() {
 }
 
 void TwoLevelIterator::SeekToLast() {
+  sequential_blocks_ = 0;
   index_iter_.SeekToLast();
   InitDataBlock();
   if (data_iter_.iter() != NULL) data_iter_.SeekToLast();
@@ -130,6 +177,7 @@ void TwoLevelIterator::SkipEmptyDataBlocksForward() {
       return;
     }
     index_iter_.Next();
+    sequential_blocks_++;
     InitDataBlock();
     if (data_iter_.iter() != NULL) data_iter_.SeekToFirst();
   }
@@ -143,6 +191,7 @@ void TwoLevelIterator::SkipEmptyDataBlocksBackward() {
       return;
     }
     index_iter_.Prev();
+    sequential_blocks_ = 0;
     InitDataBlock();
     if (data_iter_.iter() != NULL) data_iter_.SeekToLast();
   }
@@ -162,10 +211,116 @@ void TwoLevelIterator::InitDataBlock() {
       // data_iter_ is already constructed with this iterator, so
       // no need to change anything
     } else {
-      Iterator* iter = (*block_function_)(arg_, options_, handle);
+      Iterator* iter = TakePrefetched(handle);
+      if (iter == NULL) {
+        iter = (*block_function_)(arg_, options_, handle);
+      }
       data_block_handle_.assign(handle.data(), handle.size());
       SetDataIterator(iter);
+      if (options_.prefetch_blocks > 0 &&
+          sequential_blocks_ >= kSequentialScanBlocks) {
+        PrefetchBlocks();
+      }
+    }
+  }
+}
+
+void TwoLevelIterator::LoadBlocks(void* arg) {
+  PrefetchBatch* batch = reinterpret_cast<PrefetchBatch*>(arg);
+  TwoLevelIterator* iter = batch->iter;
+  for (size_t i = 0; i < batch->blocks.size(); i++) {
+    Prefetch* p = batch->blocks[i];
+    Iterator* block_iter =
+        (*iter->block_function_)(iter->arg_, iter->options_, p->handle);
+    // Position the block iterator so that the first block it depends on
+    // is read here rather than by the scan.
+    block_iter->SeekToFirst();
+    MutexLock l(&iter->mu_);
+    p->block_iter = block_iter;
+    p->done = true;
+    iter->cv_.SignalAll();
+  }
+  // "iter" may be gone once the last block is done
+  delete batch;
+}
+
+void TwoLevelIterator::PrefetchBlocks() {
+  // Top up the blocks loaded ahead of the scan once half of them have been
+  // consumed, so that each background task loads several blocks.
+  const int limit = options_.prefetch_blocks;
+  if (prefetched_.size() > static_cast<size_t>(limit / 2)) {
+    return;
+  }
+
+  // Walk the index past the blocks that were already handed out and
+  // schedule loads for the rest, then return to the current block.
+  PrefetchBatch* batch = new PrefetchBatch;
+  batch->iter = this;
+  int steps = 0;
+  bool at_end = false;
+  while (steps < limit) {
+    index_iter_.Next();
+    if (!index_iter_.Valid()) {
+      at_end = true;
+      break;
+    }
+    steps++;
+    if (static_cast<size_t>(steps) > prefetched_.size()) {
+      Prefetch* p = new Prefetch;
+      p->handle = index_iter_.value().ToString();
+      p->done = false;
+      p->block_iter = NULL;
+      batch->blocks.push_back(p);
+    }
+  }
+  prefetched_.insert(prefetched_.end(),
+                     batch->blocks.begin(), batch->blocks.end());
+  if (batch->blocks.empty()) {
+    delete batch;
+  } else {
+    env_->ScheduleRead(&TwoLevelIterator::LoadBlocks, batch);
+  }
+  if (at_end) {
+    // Back to the last block, which is "steps" past the current one
+    index_iter_.SeekToLast();
+  }
+  for (int i = 0; i < steps; i++) {
+    index_iter_.Prev();
+  }
+}
+
+Iterator* TwoLevelIterator::TakePrefetched(const Slice& handle) {
+  if (prefetched_.empty()) {
+    return NULL;
+  }
+  if (handle != Slice(prefetched_.front()->handle)) {
+    // The iterator moved somewhere else
+    ClearPrefetched();
+    return NULL;
+  }
+  Prefetch* p = prefetched_.front();
+  prefetched_.pop_front();
+  {
+    MutexLock l(&mu_);
+    while (!p->done) {
+      cv_.Wait();
+    }
+  }
+  Iterator* result = p->block_iter;
+  delete p;
+  return result;
+}
+
+void TwoLevelIterator::ClearPrefetched() {
+  MutexLock l(&mu_);
+  while (!prefetched_.empty()) {
+    Prefetch* p = prefetched_.front();
+    prefetched_.pop_front();
+    while (!p->done) {
+      cv_.Wait();
     }
+    delete p->block_iter;
+    delete p;
   }
 }
 
@@ -175,8 +330,9 @@ Iterator* NewTwoLevelIterator(
     Iterator* index_iter,
     BlockFunction block_function,
     void* arg,
-    const ReadOptions& options) {
-  return new TwoLevelIterator(index_iter, block_function, arg, options);
+    const ReadOptions& options,
+    Env* env) {
+  return new TwoLevelIterator(index_iter, block_function, arg, options, env);
 }
 
 }  // namespace leveldb
@@ -9,6 +9,7 @@
 
 namespace leveldb {
 
+class Env;
 struct ReadOptions;
 
 // Return a new two level iterator.  A two-level iterator contains an
@@ -20,6 +21,10 @@ struct ReadOptions;
 //
 // Uses a supplied function to convert an index_iter value into
 // an iterator over the contents of the corresponding block.
+//
+// If options.prefetch_blocks is positive, block_function may also be
+// invoked from threads scheduled with env->ScheduleRead() to prepare the
+// blocks that follow the current one during a sequential scan.
 extern Iterator* NewTwoLevelIterator(
     Iterator* index_iter,
     Iterator* (*block_function)(
@@ -27,7 +32,8 @@ extern Iterator* NewTwoLevelIterator(
         const ReadOptions& options,
         const Slice& index_value),
     void* arg,
-    const ReadOptions& options);
+    const ReadOptions& options,
+    Env* env);
 
 }  // namespace leveldb
 
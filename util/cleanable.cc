@@ -0,0 +1,66 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/cleanable.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+namespace leveldb {
+
+Cleanable::Cleanable() {
+  cleanup_.function = NULL;
+  cleanup_.next = NULL;
+}
+
+Cleanable::~Cleanable() {
+  DoCleanup();
+}
+
+void Cleanable::DoCleanup() {
+  if (cleanup_.function != NULL) {
+    (*cleanup_.function)(cleanup_.arg1, cleanup_.arg2);
+    for (Cleanup* c = cleanup_.next; c != NULL; ) {
+      (*c->function)(c->arg1, c->arg2);
+      Cleanup* next = c->next;
+      delete c;
+      c = next;
+    }
+    cleanup_.function = NULL;
+    cleanup_.next = NULL;
+  }
+}
+
+void Cleanable::RegisterCleanup(CleanupFunction func, void* arg1, void* arg2) {
+  assert(func != NULL);
+  Cleanup* c;
+  if (cleanup_.function == NULL) {
+    c = &cleanup_;
+  } else {
+    c = new Cleanup;
+    c->next = cleanup_.next;
+    cleanup_.next = c;
+  }
+  c->function = func;
+  c->arg1 = arg1;
+  c->arg2 = arg2;
+}
+
+void Cleanable::DelegateCleanupsTo(Cleanable* other) {
+  assert(other != this);
+  if (cleanup_.function == NULL) {
+    return;
+  }
+  other->RegisterCleanup(cleanup_.function, cleanup_.arg1, cleanup_.arg2);
+  for (Cleanup* c = cleanup_.next; c != NULL; ) {
+    other->RegisterCleanup(c->function, c->arg1, c->arg2);
+    Cleanup* next = c->next;
+    delete c;
+    c = next;
+  }
+  cleanup_.function = NULL;
+  cleanup_.next = NULL;
+}
+
+}  // namespace leveldb
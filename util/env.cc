@@ -13,12 +13,41 @@ Status Env::NewAppendableFile(const std::string& fname, WritableFile** result) {
   return Status::NotSupported("NewAppendableFile", fname);
 }
 
+Status Env::NewDirectRandomAccessFile(const std::string& fname,
+                                      RandomAccessFile** result) {
+  return NewRandomAccessFile(fname, result);
+}
+
+Status Env::NewDirectWritableFile(const std::string& fname,
+                                  WritableFile** result) {
+  return NewWritableFile(fname, result);
+}
+
+Status Env::LinkFile(const std::string& src, const std::string& target) {
+  return Status::NotSupported("LinkFile", src);
+}
+
+void Env::ScheduleRead(void (*function)(void* arg), void* arg) {
+  (*function)(arg);
+}
+
+uint64_t Env::NowNanos() {
+  return NowMicros() * 1000;
+}
+
 SequentialFile::~SequentialFile() {
 }
 
 RandomAccessFile::~RandomAccessFile() {
 }
 
+void RandomAccessFile::MultiRead(ReadRequest* requests, size_t n) const {
+  for (size_t i = 0; i < n; i++) {
+    ReadRequest* r = &requests[i];
+    r->status = Read(r->offset, r->n, &r->result, r->scratch);
+  }
+}
+
 WritableFile::~WritableFile() {
 }
 
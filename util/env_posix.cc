@@ -14,11 +14,18 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
+#if defined(LEVELDB_HAVE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#include <algorithm>
 #include <deque>
 #include <limits>
 #include <set>
+#include <vector>
 #include "leveldb/env.h"
 #include "leveldb/slice.h"
 #include "port/port.h"
@@ -89,6 +96,356 @@ class Limiter {
   void operator=(const Limiter&);
 };
 
+// Perform the read described by "r" with pread().
+static void PosixReadRequest(const std::string& fname, int fd,
+                             ReadRequest* r) {
+  ssize_t n = pread(fd, r->scratch, r->n, static_cast<off_t>(r->offset));
+  r->result = Slice(r->scratch, (n < 0) ? 0 : n);
+  r->status = (n < 0) ? IOError(fname, errno) : Status::OK();
+}
+
+// Number of threads used to service reads issued by foreground operations
+static const int kNumReadThreads = 8;
+
+// A fixed set of threads, started on first use, that run scheduled
+// functions in FIFO order.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads)
+      : num_threads_(num_threads), work_cv_(&mu_), started_(false) { }
+
+  void Schedule(void (*function)(void*), void* arg) {
+    MutexLock l(&mu_);
+    StartThreads();
+    Item item;
+    item.function = function;
+    item.arg = arg;
+    queue_.push_back(item);
+    work_cv_.Signal();
+  }
+
+ private:
+  struct Item {
+    void (*function)(void*);
+    void* arg;
+  };
+
+  // REQUIRES: mu_ is held
+  void StartThreads() {
+    if (started_) {
+      return;
+    }
+    started_ = true;
+    for (int i = 0; i < num_threads_; i++) {
+      pthread_t t;
+      int result = pthread_create(&t, NULL, &ThreadPool::ThreadMain, this);
+      if (result != 0) {
+        fprintf(stderr, "pthread leveldb read thread: %s\n", strerror(result));
+        abort();
+      }
+      pthread_detach(t);
+    }
+  }
+
+  static void* ThreadMain(void* arg) {
+    ThreadPool* pool = reinterpret_cast<ThreadPool*>(arg);
+    while (true) {
+      pool->mu_.Lock();
+      while (pool->queue_.empty()) {
+        pool->work_cv_.Wait();
+      }
+      Item item = pool->queue_.front();
+      pool->queue_.pop_front();
+      pool->mu_.Unlock();
+      (*item.function)(item.arg);
+    }
+    return NULL;
+  }
+
+  const int num_threads_;
+  port::Mutex mu_;
+  port::CondVar work_cv_;
+  bool started_;
+  std::deque<Item> queue_;
+};
+
+// Services the reads of MultiRead() calls when io_uring is not available.
+// Kept separate from the pool that runs Env::ScheduleRead() work, whose
+// functions may themselves issue MultiRead() calls and wait for them.
+static pthread_once_t read_pool_once = PTHREAD_ONCE_INIT;
+static ThreadPool* read_pool;
+static void InitReadThreadPool() { read_pool = new ThreadPool(kNumReadThreads); }
+
+// One read of a MultiRead() call handed to the read pool
+struct PooledRead {
+  const std::string* fname;
+  int fd;
+  ReadRequest* request;
+
+  // State of the MultiRead() call the request belongs to
+  port::Mutex* mu;
+  port::CondVar* cv;
+  size_t* remaining;
+};
+
+static void DoPooledRead(void* arg) {
+  PooledRead* read = reinterpret_cast<PooledRead*>(arg);
+  PosixReadRequest(*read->fname, read->fd, read->request);
+  MutexLock l(read->mu);
+  if (--*read->remaining == 0) {
+    read->cv->Signal();
+  }
+}
+
+// Read all of "requests[0..n-1]" from "fd" concurrently on the read pool
+// and return once every read has completed.  The calling thread performs
+// one of the reads itself.
+static void PooledReadAll(const std::string& fname, int fd,
+                          ReadRequest* requests, size_t n) {
+  pthread_once(&read_pool_once, &InitReadThreadPool);
+  port::Mutex mu;
+  port::CondVar cv(&mu);
+  size_t remaining = n - 1;
+  std::vector<PooledRead> reads(n);
+  for (size_t i = 1; i < n; i++) {
+    reads[i].fname = &fname;
+    reads[i].fd = fd;
+    reads[i].request = &requests[i];
+    reads[i].mu = &mu;
+    reads[i].cv = &cv;
+    reads[i].remaining = &remaining;
+    read_pool->Schedule(&DoPooledRead, &reads[i]);
+  }
+  PosixReadRequest(fname, fd, &requests[0]);
+  MutexLock l(&mu);
+  while (remaining > 0) {
+    cv.Wait();
+  }
+}
+
+#if defined(LEVELDB_HAVE_IO_URING)
+// A minimal io_uring instance used to submit all reads of a MultiRead()
+// call with one system call and wait for their completions.  A ring may
+// not be shared between threads, so each thread lazily creates its own.
+class IoUring {
+ public:
+  // Maximum number of reads in flight on a ring
+  static const unsigned kEntries = 64;
+
+  // Return the ring of the calling thread, or NULL if io_uring cannot be
+  // used on this system.
+  static IoUring* ForCurrentThread();
+
+  // Read all of "requests[0..n-1]" from "fd" and return once every read
+  // has completed.
+  void ReadAll(const std::string& fname, int fd, ReadRequest* requests,
+               size_t n);
+
+ private:
+  IoUring();
+  ~IoUring();
+  bool Init();
+  void Reap(const std::string& fname, ReadRequest* requests,
+            size_t* completed);
+
+  static void DeleteRing(void* arg);
+  static void InitKey();
+
+  int ring_fd_;
+  void* sq_ptr_;
+  size_t sq_len_;
+  void* cq_ptr_;
+  size_t cq_len_;
+  struct io_uring_sqe* sqes_;
+  size_t sqes_len_;
+
+  // Pointers into the shared submission and completion rings
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  struct io_uring_cqe* cqes_;
+
+  static pthread_once_t once_;
+  static pthread_key_t key_;
+  static bool available_;
+};
+
+pthread_once_t IoUring::once_ = PTHREAD_ONCE_INIT;
+pthread_key_t IoUring::key_;
+bool IoUring::available_ = false;
+
+IoUring::IoUring()
+    : ring_fd_(-1), sq_ptr_(MAP_FAILED), sq_len_(0), cq_ptr_(MAP_FAILED),
+      cq_len_(0), sqes_(reinterpret_cast<struct io_uring_sqe*>(MAP_FAILED)),
+      sqes_len_(0) {
+}
+
+IoUring::~IoUring() {
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_len_);
+  }
+  if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) {
+    munmap(cq_ptr_, cq_len_);
+  }
+  if (sq_ptr_ != MAP_FAILED) {
+    munmap(sq_ptr_, sq_len_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+}
+
+bool IoUring::Init() {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  ring_fd_ = syscall(__NR_io_uring_setup, kEntries, &p);
+  if (ring_fd_ < 0) {
+    return false;
+  }
+
+  sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+  }
+  sq_ptr_ = mmap(NULL, sq_len_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ptr_ == MAP_FAILED) {
+    return false;
+  }
+  if (single_mmap) {
+    cq_ptr_ = sq_ptr_;
+  } else {
+    cq_ptr_ = mmap(NULL, cq_len_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ptr_ == MAP_FAILED) {
+      return false;
+    }
+  }
+  sqes_len_ = p.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(NULL, sqes_len_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = reinterpret_cast<struct io_uring_sqe*>(sqes);
+
+  char* sq = reinterpret_cast<char*>(sq_ptr_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+  char* cq = reinterpret_cast<char*>(cq_ptr_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+  return true;
+}
+
+void IoUring::DeleteRing(void* arg) {
+  delete reinterpret_cast<IoUring*>(arg);
+}
+
+void IoUring::InitKey() {
+  // Probe once whether the kernel supports (and permits) io_uring
+  IoUring probe;
+  available_ = probe.Init() &&
+               pthread_key_create(&key_, &IoUring::DeleteRing) == 0;
+}
+
+IoUring* IoUring::ForCurrentThread() {
+  pthread_once(&once_, &IoUring::InitKey);
+  if (!available_) {
+    return NULL;
+  }
+  IoUring* ring = reinterpret_cast<IoUring*>(pthread_getspecific(key_));
+  if (ring == NULL) {
+    ring = new IoUring;
+    if (!ring->Init()) {
+      // Most likely out of locked memory; use the thread pool instead
+      delete ring;
+      return NULL;
+    }
+    pthread_setspecific(key_, ring);
+  }
+  return ring;
+}
+
+void IoUring::Reap(const std::string& fname, ReadRequest* requests,
+                   size_t* completed) {
+  unsigned head = *cq_head_;
+  const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    const struct io_uring_cqe* cqe = &cqes_[head & *cq_mask_];
+    ReadRequest* r = &requests[cqe->user_data];
+    if (cqe->res < 0) {
+      r->result = Slice(r->scratch, 0);
+      r->status = IOError(fname, -cqe->res);
+    } else {
+      r->result = Slice(r->scratch, cqe->res);
+      r->status = Status::OK();
+    }
+    head++;
+    (*completed)++;
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+void IoUring::ReadAll(const std::string& fname, int fd,
+                      ReadRequest* requests, size_t n) {
+  std::vector<struct iovec> iovecs(n);
+  size_t queued = 0;     // Requests placed on the submission ring
+  size_t completed = 0;  // Requests whose completion has been reaped
+  while (completed < n) {
+    unsigned tail = *sq_tail_;
+    while (queued < n && queued - completed < kEntries) {
+      const unsigned index = tail & *sq_mask_;
+      struct io_uring_sqe* sqe = &sqes_[index];
+      memset(sqe, 0, sizeof(*sqe));
+      iovecs[queued].iov_base = requests[queued].scratch;
+      iovecs[queued].iov_len = requests[queued].n;
+      sqe->opcode = IORING_OP_READV;
+      sqe->fd = fd;
+      sqe->off = requests[queued].offset;
+      sqe->addr = reinterpret_cast<uint64_t>(&iovecs[queued]);
+      sqe->len = 1;
+      sqe->user_data = queued;
+      sq_array_[index] = index;
+      tail++;
+      queued++;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    const unsigned to_submit =
+        tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    const int r = syscall(__NR_io_uring_enter, ring_fd_, to_submit, 1,
+                          IORING_ENTER_GETEVENTS, NULL, 0);
+    if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      Reap(fname, requests, &completed);
+      const size_t unsubmitted =
+          tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+      const size_t submitted = queued - unsubmitted;
+      if (completed == submitted) {
+        // Nothing is in flight: retract the unsubmitted entries and
+        // finish the remaining reads synchronously.
+        __atomic_store_n(sq_tail_, tail - unsubmitted, __ATOMIC_RELEASE);
+        for (size_t i = submitted; i < n; i++) {
+          PosixReadRequest(fname, fd, &requests[i]);
+        }
+        return;
+      }
+    }
+    Reap(fname, requests, &completed);
+  }
+}
+#endif  // defined(LEVELDB_HAVE_IO_URING)
+
 class PosixSequentialFile: public SequentialFile {
  private:
   std::string filename_;
@@ -171,6 +528,21 @@ class PosixRandomAccessFile: public RandomAccessFile {
     }
     return s;
   }
+
+  virtual void MultiRead(ReadRequest* requests, size_t n) const {
+    if (n <= 1 || temporary_fd_) {
+      RandomAccessFile::MultiRead(requests, n);
+      return;
+    }
+#if defined(LEVELDB_HAVE_IO_URING)
+    IoUring* ring = IoUring::ForCurrentThread();
+    if (ring != NULL) {
+      ring->ReadAll(filename_, fd_, requests, n);
+      return;
+    }
+#endif
+    PooledReadAll(filename_, fd_, requests, n);
+  }
 };
 
 // mmap() based random-access
@@ -288,6 +660,220 @@ class PosixWritableFile : public WritableFile {
   }
 };
 
+#if defined(O_DIRECT)
+// O_DIRECT requires file offsets, transfer sizes and buffer addresses to
+// be multiples of the logical block size of the underlying device.
+static const size_t kDirectIOAlignment = 4096;
+
+// Size of the aligned buffers used for direct reads and writes
+static const size_t kDirectIOBufferSize = 1 << 20;
+
+static size_t RoundUpToAlignment(size_t n) {
+  return (n + kDirectIOAlignment - 1) & ~(kDirectIOAlignment - 1);
+}
+
+static char* NewAlignedBuffer(size_t size) {
+  void* p = NULL;
+  if (posix_memalign(&p, kDirectIOAlignment, size) != 0) {
+    return NULL;
+  }
+  return reinterpret_cast<char*>(p);
+}
+
+// O_DIRECT pread() based random-access.  Reads are served from an aligned
+// buffer that is refilled with kDirectIOBufferSize bytes at a time, which
+// acts as readahead for sequential reads such as compaction inputs.  Direct
+// files are short-lived, so they keep their descriptor open without
+// counting against the read-only file limit.
+class PosixDirectRandomAccessFile: public RandomAccessFile {
+ private:
+  std::string filename_;
+  int fd_;
+  mutable port::Mutex mu_;
+  char* buf_;                       // Aligned, kDirectIOBufferSize bytes
+  mutable uint64_t buf_offset_;     // File offset of buf_[0]
+  mutable size_t buf_len_;          // Number of valid bytes in buf_
+
+  // Read "n" bytes at aligned "offset" into aligned "dst".  Returns the
+  // number of bytes read, which is less than "n" only at end of file.
+  Status ReadAligned(uint64_t offset, size_t n, char* dst,
+                     size_t* bytes_read) const {
+    *bytes_read = 0;
+    while (*bytes_read < n) {
+      ssize_t r = pread(fd_, dst + *bytes_read, n - *bytes_read,
+                        static_cast<off_t>(offset + *bytes_read));
+      if (r < 0) {
+        if (errno == EINTR) {
+          continue;  // Retry
+        }
+        return IOError(filename_, errno);
+      }
+      if (r == 0) {
+        break;  // End of file
+      }
+      *bytes_read += r;
+      if (*bytes_read % kDirectIOAlignment != 0) {
+        break;  // Partial block can only happen at end of file
+      }
+    }
+    return Status::OK();
+  }
+
+ public:
+  PosixDirectRandomAccessFile(const std::string& fname, int fd, char* buf)
+      : filename_(fname), fd_(fd), buf_(buf),
+        buf_offset_(0), buf_len_(0) {
+  }
+
+  virtual ~PosixDirectRandomAccessFile() {
+    close(fd_);
+    free(buf_);
+  }
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    const uint64_t aligned_offset = offset & ~(kDirectIOAlignment - 1);
+    const size_t prefix = offset - aligned_offset;
+    Status s;
+    if (prefix + n > kDirectIOBufferSize) {
+      // Too large for the readahead buffer; read into a temporary one
+      const size_t size = RoundUpToAlignment(prefix + n);
+      char* tmp = NewAlignedBuffer(size);
+      if (tmp == NULL) {
+        return IOError(filename_, ENOMEM);
+      }
+      size_t bytes_read;
+      s = ReadAligned(aligned_offset, size, tmp, &bytes_read);
+      size_t copied = 0;
+      if (s.ok() && bytes_read > prefix) {
+        copied = std::min(n, bytes_read - prefix);
+        memcpy(scratch, tmp + prefix, copied);
+      }
+      free(tmp);
+      *result = Slice(scratch, copied);
+      return s;
+    }
+
+    MutexLock l(&mu_);
+    if (offset < buf_offset_ || offset + n > buf_offset_ + buf_len_) {
+      buf_len_ = 0;
+      buf_offset_ = aligned_offset;
+      s = ReadAligned(aligned_offset, kDirectIOBufferSize, buf_, &buf_len_);
+    }
+    size_t copied = 0;
+    if (s.ok() && offset < buf_offset_ + buf_len_) {
+      copied = std::min<uint64_t>(n, buf_offset_ + buf_len_ - offset);
+      memcpy(scratch, buf_ + (offset - buf_offset_), copied);
+    }
+    *result = Slice(scratch, copied);
+    return s;
+  }
+};
+
+// O_DIRECT writes.  Appended data is collected in an aligned buffer that
+// is written out whenever it fills up.  Sync() and Close() write out the
+// final partial block padded to the alignment and then truncate the file
+// to its logical size; the partial block is kept in the buffer so that
+// later appends rewrite it.
+class PosixDirectWritableFile : public WritableFile {
+ private:
+  std::string filename_;
+  int fd_;
+  char* buf_;                 // Aligned, kDirectIOBufferSize bytes
+  size_t buf_len_;            // Number of valid bytes in buf_
+  uint64_t file_offset_;      // File offset of buf_[0]; always aligned
+
+  Status WriteAligned(size_t n) {
+    size_t written = 0;
+    while (written < n) {
+      ssize_t r = pwrite(fd_, buf_ + written, n - written,
+                         static_cast<off_t>(file_offset_ + written));
+      if (r < 0) {
+        if (errno == EINTR) {
+          continue;  // Retry
+        }
+        return IOError(filename_, errno);
+      }
+      written += r;
+    }
+    return Status::OK();
+  }
+
+  Status WriteTail() {
+    const size_t padded = RoundUpToAlignment(buf_len_);
+    memset(buf_ + buf_len_, 0, padded - buf_len_);
+    Status s = WriteAligned(padded);
+    if (s.ok() && padded != buf_len_ &&
+        ftruncate(fd_, static_cast<off_t>(file_offset_ + buf_len_)) != 0) {
+      s = IOError(filename_, errno);
+    }
+    if (s.ok()) {
+      const size_t full = buf_len_ & ~(kDirectIOAlignment - 1);
+      memmove(buf_, buf_ + full, buf_len_ - full);
+      file_offset_ += full;
+      buf_len_ -= full;
+    }
+    return s;
+  }
+
+ public:
+  PosixDirectWritableFile(const std::string& fname, int fd, char* buf)
+      : filename_(fname), fd_(fd), buf_(buf), buf_len_(0), file_offset_(0) {
+  }
+
+  virtual ~PosixDirectWritableFile() {
+    if (fd_ >= 0) {
+      // Ignoring any potential errors
+      Close();
+    }
+    free(buf_);
+  }
+
+  virtual Status Append(const Slice& data) {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+      const size_t n = std::min(left, kDirectIOBufferSize - buf_len_);
+      memcpy(buf_ + buf_len_, p, n);
+      buf_len_ += n;
+      p += n;
+      left -= n;
+      if (buf_len_ == kDirectIOBufferSize) {
+        Status s = WriteAligned(buf_len_);
+        if (!s.ok()) {
+          return s;
+        }
+        file_offset_ += buf_len_;
+        buf_len_ = 0;
+      }
+    }
+    return Status::OK();
+  }
+
+  virtual Status Close() {
+    Status s = WriteTail();
+    if (close(fd_) < 0 && s.ok()) {
+      s = IOError(filename_, errno);
+    }
+    fd_ = -1;
+    return s;
+  }
+
+  virtual Status Flush() {
+    // Buffered data can only be written in whole blocks; see Sync()
+    return Status::OK();
+  }
+
+  virtual Status Sync() {
+    Status s = WriteTail();
+    if (s.ok() && fdatasync(fd_) != 0) {
+      s = IOError(filename_, errno);
+    }
+    return s;
+  }
+};
+#endif  // defined(O_DIRECT)
+
 static int LockOrUnlock(int fd, bool lock) {
   errno = 0;
   struct flock f;
@@ -398,6 +984,47 @@ class PosixEnv : public Env {
     return s;
   }
 
+#if defined(O_DIRECT)
+  virtual Status NewDirectRandomAccessFile(const std::string& fname,
+                                           RandomAccessFile** result) {
+    *result = NULL;
+    int fd = open(fname.c_str(), O_RDONLY | O_DIRECT);
+    if (fd < 0 && errno == EINVAL) {
+      // The file system does not support direct I/O
+      return NewRandomAccessFile(fname, result);
+    } else if (fd < 0) {
+      return IOError(fname, errno);
+    }
+    char* buf = NewAlignedBuffer(kDirectIOBufferSize);
+    if (buf == NULL) {
+      close(fd);
+      return IOError(fname, ENOMEM);
+    }
+    *result = new PosixDirectRandomAccessFile(fname, fd, buf);
+    return Status::OK();
+  }
+
+  virtual Status NewDirectWritableFile(const std::string& fname,
+                                       WritableFile** result) {
+    *result = NULL;
+    int fd = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT,
+                  0644);
+    if (fd < 0 && errno == EINVAL) {
+      // The file system does not support direct I/O
+      return NewWritableFile(fname, result);
+    } else if (fd < 0) {
+      return IOError(fname, errno);
+    }
+    char* buf = NewAlignedBuffer(kDirectIOBufferSize);
+    if (buf == NULL) {
+      close(fd);
+      return IOError(fname, ENOMEM);
+    }
+    *result = new PosixDirectWritableFile(fname, fd, buf);
+    return Status::OK();
+  }
+#endif  // defined(O_DIRECT)
+
   virtual bool FileExists(const std::string& fname) {
     return access(fname.c_str(), F_OK) == 0;
   }
@@ -461,6 +1088,14 @@ class PosixEnv : public Env {
     return result;
   }
 
+  virtual Status LinkFile(const std::string& src, const std::string& target) {
+    Status result;
+    if (link(src.c_str(), target.c_str()) != 0) {
+      result = IOError(src, errno);
+    }
+    return result;
+  }
+
   virtual Status LockFile(const std::string& fname, FileLock** lock) {
     *lock = NULL;
     Status result;
@@ -499,6 +1134,10 @@ class PosixEnv : public Env {
 
   virtual void StartThread(void (*function)(void* arg), void* arg);
 
+  virtual void ScheduleRead(void (*function)(void* arg), void* arg) {
+    read_tasks_.Schedule(function, arg);
+  }
+
   virtual Status GetTestDirectory(std::string* result) {
     const char* env = getenv("TEST_TMPDIR");
     if (env && env[0] != '\0') {
@@ -537,6 +1176,16 @@ class PosixEnv : public Env {
     return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
   }
 
+  virtual uint64_t NowNanos() {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return Env::NowNanos();
+#endif
+  }
+
   virtual void SleepForMicroseconds(int micros) {
     usleep(micros);
   }
@@ -569,6 +1218,7 @@ class PosixEnv : public Env {
   PosixLockTable locks_;
   Limiter mmap_limit_;
   Limiter fd_limit_;
+  ThreadPool read_tasks_;
 };
 
 // Return the maximum number of concurrent mmaps.
@@ -602,7 +1252,8 @@ static intptr_t MaxOpenFiles() {
 PosixEnv::PosixEnv()
     : started_bgthread_(false),
       mmap_limit_(MaxMmaps()),
-      fd_limit_(MaxOpenFiles()) {
+      fd_limit_(MaxOpenFiles()),
+      read_tasks_(kNumReadThreads) {
   PthreadCall("mutex_init", pthread_mutex_init(&mu_, NULL));
   PthreadCall("cvar_init", pthread_cond_init(&bgsignal_, NULL));
 }
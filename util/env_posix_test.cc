@@ -56,6 +56,91 @@ TEST(EnvPosixTest, TestOpenOnRead) {
   ASSERT_OK(env_->DeleteFile(test_file));
 }
 
+TEST(EnvPosixTest, TestDirectIO) {
+  std::string test_dir;
+  ASSERT_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/direct_io.txt";
+
+  // Appends of odd sizes spanning several internal buffers, with a Sync()
+  // in the middle of a block
+  std::string data;
+  WritableFile* writable_file;
+  ASSERT_OK(env_->NewDirectWritableFile(test_file, &writable_file));
+  for (int i = 0; data.size() < (3 << 20); i++) {
+    std::string piece(i * 37 % 10000 + 1, static_cast<char>('a' + i % 26));
+    ASSERT_OK(writable_file->Append(piece));
+    data += piece;
+    if (i == 100) {
+      ASSERT_OK(writable_file->Sync());
+    }
+  }
+  ASSERT_OK(writable_file->Close());
+  delete writable_file;
+
+  uint64_t size;
+  ASSERT_OK(env_->GetFileSize(test_file, &size));
+  ASSERT_EQ(data.size(), size);
+
+  RandomAccessFile* file;
+  ASSERT_OK(env_->NewDirectRandomAccessFile(test_file, &file));
+  std::string scratch(data.size(), '\0');
+  Slice result;
+  // Small unaligned reads, a read larger than the readahead buffer and a
+  // read past the end of the file
+  const uint64_t offsets[] = { 0, 4097, 1 << 20, 5, (1 << 20) - 3 };
+  for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+    ASSERT_OK(file->Read(offsets[i], 5000, &result, &scratch[0]));
+    ASSERT_EQ(data.substr(offsets[i], 5000), result.ToString());
+  }
+  ASSERT_OK(file->Read(7, data.size(), &result, &scratch[0]));
+  ASSERT_EQ(data.substr(7), result.ToString());
+  ASSERT_OK(file->Read(data.size() - 10, 100, &result, &scratch[0]));
+  ASSERT_EQ(data.substr(data.size() - 10), result.ToString());
+  delete file;
+  ASSERT_OK(env_->DeleteFile(test_file));
+}
+
+TEST(EnvPosixTest, TestMultiRead) {
+  std::string test_dir;
+  ASSERT_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/multi_read.txt";
+  std::string data;
+  for (int i = 0; data.size() < 200000; i++) {
+    data.push_back(static_cast<char>('a' + (i * 7) % 26));
+  }
+  ASSERT_OK(WriteStringToFile(env_, data, test_file));
+
+  // Use up the mmap limit so that the last file is read with pread() and
+  // MultiRead() is serviced asynchronously.
+  RandomAccessFile* files[kMMapLimit + 1];
+  for (int i = 0; i <= kMMapLimit; i++) {
+    ASSERT_OK(env_->NewRandomAccessFile(test_file, &files[i]));
+  }
+  for (int f = 0; f <= kMMapLimit; f++) {
+    // More requests than fit in one batch, one of them past end of file
+    const int kNumRequests = 200;
+    std::vector<ReadRequest> requests(kNumRequests);
+    std::vector<std::string> scratch(kNumRequests, std::string(1000, '\0'));
+    for (int i = 0; i < kNumRequests; i++) {
+      requests[i].offset = (i * 7919) % (data.size() - 1000);
+      requests[i].n = 1 + (i * 31) % 1000;
+      requests[i].scratch = &scratch[i][0];
+    }
+    requests[0].offset = data.size() - 10;
+    requests[0].n = 10;
+    files[f]->MultiRead(&requests[0], kNumRequests);
+    for (int i = 0; i < kNumRequests; i++) {
+      ASSERT_OK(requests[i].status);
+      ASSERT_EQ(data.substr(requests[i].offset, requests[i].n),
+                requests[i].result.ToString());
+    }
+  }
+  for (int i = 0; i <= kMMapLimit; i++) {
+    delete files[i];
+  }
+  ASSERT_OK(env_->DeleteFile(test_file));
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -99,6 +99,25 @@ TEST(EnvTest, StartThread) {
   ASSERT_EQ(state.val, 3);
 }
 
+TEST(EnvTest, ScheduleRead) {
+  State state;
+  state.val = 0;
+  state.num_running = 20;
+  for (int i = 0; i < 20; i++) {
+    env_->ScheduleRead(&ThreadBody, &state);
+  }
+  while (true) {
+    state.mu.Lock();
+    int num = state.num_running;
+    state.mu.Unlock();
+    if (num == 0) {
+      break;
+    }
+    env_->SleepForMicroseconds(kDelayMicros);
+  }
+  ASSERT_EQ(state.val, 20);
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
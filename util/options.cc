@@ -24,7 +24,18 @@ Options::Options()
       max_file_size(2<<20),
       compression(kSnappyCompression),
       reuse_logs(false),
-      filter_policy(NULL) {
+      filter_policy(NULL),
+      compaction_style(kCompactionStyleLevel),
+      dynamic_level_bytes(false),
+      deletion_compaction_ratio(0),
+      delayed_write_rate(16 << 20),
+      rate_limiter(NULL),
+      use_direct_io_for_flush_and_compaction(false),
+      compaction_readahead_size(2 << 20),
+      prewarm_tables(false),
+      prewarm_data_bytes(0),
+      inplace_update_support(false),
+      statistics(NULL) {
 }
 
 }  // namespace leveldb
@@ -0,0 +1,102 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/perf_context_imp.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace leveldb {
+
+#ifdef LEVELDB_THREAD_LOCAL
+LEVELDB_THREAD_LOCAL PerfLevel perf_level = kDisablePerf;
+LEVELDB_THREAD_LOCAL PerfContext perf_context;
+
+void SetPerfLevel(PerfLevel level) {
+  perf_level = level;
+}
+
+PerfLevel GetPerfLevel() {
+  return perf_level;
+}
+
+PerfContext* GetPerfContext() {
+  return &perf_context;
+}
+#else
+namespace {
+struct PerfState {
+  PerfLevel level;      // Value-initialized to kDisablePerf
+  PerfContext context;
+};
+}  // namespace
+
+static port::OnceType once = LEVELDB_ONCE_INIT;
+static port::ThreadLocal<PerfState>* perf_state;
+
+static void InitPerfState() {
+  perf_state = new port::ThreadLocal<PerfState>;
+}
+
+static PerfState* CurrentPerfState() {
+  port::InitOnce(&once, InitPerfState);
+  return perf_state->Get();
+}
+
+void SetPerfLevel(PerfLevel level) {
+  CurrentPerfState()->level = level;
+}
+
+PerfLevel GetPerfLevel() {
+  return CurrentPerfState()->level;
+}
+
+PerfContext* GetPerfContext() {
+  return &CurrentPerfState()->context;
+}
+#endif
+
+void PerfContext::Reset() {
+  memset(this, 0, sizeof(*this));
+}
+
+std::string PerfContext::ToString() const {
+  struct Counter {
+    const char* name;
+    uint64_t value;
+  };
+  const Counter counters[] = {
+    { "get_from_memtable_count", get_from_memtable_count },
+    { "get_from_memtable_time", get_from_memtable_time },
+    { "get_from_output_files_time", get_from_output_files_time },
+    { "get_sst_files_consulted", get_sst_files_consulted },
+    { "db_mutex_lock_nanos", db_mutex_lock_nanos },
+    { "bloom_filter_checked", bloom_filter_checked },
+    { "bloom_filter_useful", bloom_filter_useful },
+    { "block_read_count", block_read_count },
+    { "block_read_byte", block_read_byte },
+    { "block_read_time", block_read_time },
+    { "index_block_read_count", index_block_read_count },
+    { "block_cache_hit_count", block_cache_hit_count },
+    { "block_checksum_time", block_checksum_time },
+    { "block_decompress_count", block_decompress_count },
+    { "bytes_decompressed", bytes_decompressed },
+    { "block_decompress_time", block_decompress_time },
+    { "seek_internal_seek_time", seek_internal_seek_time },
+    { "internal_delete_skipped_count", internal_delete_skipped_count },
+    { "internal_key_skipped_count", internal_key_skipped_count },
+  };
+  std::string result;
+  char buf[100];
+  for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+    if (counters[i].value != 0) {
+      snprintf(buf, sizeof(buf), "%s = %llu, ", counters[i].name,
+               static_cast<unsigned long long>(counters[i].value));
+      result.append(buf);
+    }
+  }
+  return result;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,81 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_PERF_CONTEXT_IMP_H_
+#define STORAGE_LEVELDB_UTIL_PERF_CONTEXT_IMP_H_
+
+#include "leveldb/env.h"
+#include "leveldb/perf_context.h"
+#include "port/port.h"
+
+namespace leveldb {
+
+// The perf level and context of the calling thread.  Where the platform
+// has cheap thread-local variables they are accessed directly, so that
+// checking the level is a single thread-local load.
+#ifdef LEVELDB_THREAD_LOCAL
+extern LEVELDB_THREAD_LOCAL PerfLevel perf_level;
+extern LEVELDB_THREAD_LOCAL PerfContext perf_context;
+
+inline PerfLevel CurrentPerfLevel() { return perf_level; }
+inline PerfContext* CurrentPerfContext() { return &perf_context; }
+#else
+inline PerfLevel CurrentPerfLevel() { return GetPerfLevel(); }
+inline PerfContext* CurrentPerfContext() { return GetPerfContext(); }
+#endif
+
+// Add "value" to the named counter of the calling thread's perf context
+// if counters are enabled.
+#define PERF_COUNTER_ADD(metric, value)                                 \
+  do {                                                                  \
+    if (::leveldb::CurrentPerfLevel() >= ::leveldb::kEnableCount) {     \
+      ::leveldb::CurrentPerfContext()->metric += (value);               \
+    }                                                                   \
+  } while (0)
+
+// Adds the time between construction (or Start()) and destruction (or
+// Stop()) to a counter of the calling thread's perf context if timings
+// are enabled.  Does not read the clock otherwise.
+class PerfTimer {
+ public:
+  explicit PerfTimer(uint64_t* metric, bool start = true)
+      : metric_(metric), start_(0) {
+    if (start) {
+      Start();
+    }
+  }
+
+  ~PerfTimer() {
+    Stop();
+  }
+
+  void Start() {
+    if (CurrentPerfLevel() >= kEnableTime) {
+      start_ = Env::Default()->NowNanos();
+    }
+  }
+
+  void Stop() {
+    if (start_ != 0) {
+      *metric_ += Env::Default()->NowNanos() - start_;
+      start_ = 0;
+    }
+  }
+
+ private:
+  uint64_t* const metric_;
+  uint64_t start_;
+
+  // No copying allowed
+  PerfTimer(const PerfTimer&);
+  void operator=(const PerfTimer&);
+};
+
+#define PERF_TIMER_GUARD(metric) \
+  ::leveldb::PerfTimer perf_timer_ ## metric(   \
+      &::leveldb::CurrentPerfContext()->metric)
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_PERF_CONTEXT_IMP_H_
@@ -0,0 +1,200 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/rate_limiter.h"
+
+#include <algorithm>
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+RateLimiter::~RateLimiter() {
+}
+
+namespace {
+
+// Tokens (bytes) are handed out in refill periods of this length.  Shorter
+// periods make background writes smoother at the cost of more wakeups.
+static const uint64_t kRefillPeriodMicros = 10000;
+
+// An auto-tuned limiter re-evaluates its rate after this many periods.
+static const int kAutoTuneIntervalPeriods = 100;
+
+class GenericRateLimiter : public RateLimiter {
+ public:
+  GenericRateLimiter(int64_t bytes_per_second, bool auto_tuned)
+      : env_(Env::Default()),
+        auto_tuned_(auto_tuned),
+        max_bytes_per_second_(std::max<int64_t>(bytes_per_second, 1)),
+        min_bytes_per_second_(std::max<int64_t>(max_bytes_per_second_ / 20,
+                                                1)),
+        available_bytes_(0),
+        next_refill_micros_(0),
+        drained_(false),
+        periods_(0),
+        drained_periods_(0) {
+    SetBytesPerSecond(max_bytes_per_second_);
+    for (int i = 0; i < kNumPriorities; i++) {
+      waiters_[i] = 0;
+      total_bytes_through_[i] = 0;
+    }
+  }
+
+  virtual void Request(size_t bytes, Priority priority) {
+    MutexLock l(&mu_);
+    total_bytes_through_[priority] += bytes;
+    while (bytes > 0) {
+      int64_t chunk;
+      waiters_[priority]++;
+      while (true) {
+        const uint64_t now = env_->NowMicros();
+        Refill(now);
+        // Large requests are granted one refill period worth at a time.
+        // Auto-tuning may shrink the period's refill while we wait, so
+        // the chunk is recomputed after every refill.
+        chunk = std::min(static_cast<int64_t>(bytes),
+                         refill_bytes_per_period_);
+        if (available_bytes_ >= chunk && !HigherPriorityWaiting(priority)) {
+          break;
+        }
+        drained_ = true;
+        // Sleep until the next refill.  Requests only wait for short
+        // periods, so sleeping without a condition variable is fine.
+        const uint64_t wait = next_refill_micros_ > now ?
+            next_refill_micros_ - now : 0;
+        mu_.Unlock();
+        env_->SleepForMicroseconds(static_cast<int>(
+            std::max<uint64_t>(wait, 100)));
+        mu_.Lock();
+      }
+      waiters_[priority]--;
+      available_bytes_ -= chunk;
+      bytes -= chunk;
+    }
+  }
+
+  virtual int64_t GetBytesPerSecond() const {
+    MutexLock l(&mu_);
+    return bytes_per_second_;
+  }
+
+  virtual int64_t GetTotalBytesThrough(Priority priority) const {
+    MutexLock l(&mu_);
+    return total_bytes_through_[priority];
+  }
+
+ private:
+  void SetBytesPerSecond(int64_t bytes_per_second) {
+    bytes_per_second_ = bytes_per_second;
+    refill_bytes_per_period_ = std::max<int64_t>(
+        bytes_per_second * kRefillPeriodMicros / 1000000, 1);
+  }
+
+  bool HigherPriorityWaiting(Priority priority) const {
+    for (int i = priority + 1; i < kNumPriorities; i++) {
+      if (waiters_[i] > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // REQUIRES: mu_ is held
+  void Refill(uint64_t now) {
+    if (now < next_refill_micros_) {
+      return;
+    }
+    next_refill_micros_ = now + kRefillPeriodMicros;
+
+    if (auto_tuned_) {
+      periods_++;
+      if (drained_) {
+        drained_periods_++;
+      }
+      drained_ = false;
+      if (periods_ >= kAutoTuneIntervalPeriods) {
+        // Raise the limit while writers are throttled most of the time and
+        // lower it while the limiter is mostly idle.
+        if (drained_periods_ * 100 >= periods_ * 90) {
+          SetBytesPerSecond(std::min(bytes_per_second_ + bytes_per_second_ / 20,
+                                     max_bytes_per_second_));
+        } else if (drained_periods_ * 100 <= periods_ * 50) {
+          SetBytesPerSecond(std::max(bytes_per_second_ - bytes_per_second_ / 21,
+                                     min_bytes_per_second_));
+        }
+        periods_ = 0;
+        drained_periods_ = 0;
+      }
+    }
+
+    // Unused tokens do not carry over to later periods, so an idle
+    // limiter never allows more than one period worth of burst.
+    available_bytes_ = refill_bytes_per_period_;
+  }
+
+  Env* const env_;
+  const bool auto_tuned_;
+  const int64_t max_bytes_per_second_;
+  const int64_t min_bytes_per_second_;
+
+  mutable port::Mutex mu_;
+  int64_t bytes_per_second_;
+  int64_t refill_bytes_per_period_;
+  int64_t available_bytes_;
+  uint64_t next_refill_micros_;
+  int waiters_[kNumPriorities];
+  int64_t total_bytes_through_[kNumPriorities];
+
+  // Auto-tuning state: whether a request had to wait during the current
+  // period, and how many of the recent periods were drained.
+  bool drained_;
+  int periods_;
+  int drained_periods_;
+};
+
+class RateLimitedWritableFile : public WritableFile {
+ public:
+  RateLimitedWritableFile(WritableFile* base, RateLimiter* limiter,
+                          RateLimiter::Priority priority)
+      : base_(base), limiter_(limiter), priority_(priority) {
+  }
+
+  virtual ~RateLimitedWritableFile() {
+    delete base_;
+  }
+
+  virtual Status Append(const Slice& data) {
+    limiter_->Request(data.size(), priority_);
+    return base_->Append(data);
+  }
+
+  virtual Status Close() { return base_->Close(); }
+  virtual Status Flush() { return base_->Flush(); }
+  virtual Status Sync() { return base_->Sync(); }
+
+ private:
+  WritableFile* const base_;
+  RateLimiter* const limiter_;
+  const RateLimiter::Priority priority_;
+};
+
+}  // namespace
+
+RateLimiter* NewGenericRateLimiter(int64_t bytes_per_second,
+                                   bool auto_tuned) {
+  return new GenericRateLimiter(bytes_per_second, auto_tuned);
+}
+
+WritableFile* NewRateLimitedWritableFile(WritableFile* base,
+                                         RateLimiter* limiter,
+                                         RateLimiter::Priority priority) {
+  if (limiter == NULL) {
+    return base;
+  }
+  return new RateLimitedWritableFile(base, limiter, priority);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,23 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
+
+#include "leveldb/rate_limiter.h"
+
+namespace leveldb {
+
+class WritableFile;
+
+// Return a file that requests tokens from "limiter" at the given priority
+// before every append to "base".  The returned file takes ownership of
+// "base".  If "limiter" is NULL, returns "base".
+extern WritableFile* NewRateLimitedWritableFile(WritableFile* base,
+                                                RateLimiter* limiter,
+                                                RateLimiter::Priority priority);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
@@ -0,0 +1,109 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/readahead_file.h"
+
+#include <string.h>
+#include <algorithm>
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+namespace {
+
+class ReadaheadRandomAccessFile : public RandomAccessFile {
+ public:
+  ReadaheadRandomAccessFile(RandomAccessFile* file, uint64_t file_size,
+                            size_t readahead_size)
+      : file_(file),
+        file_size_(file_size),
+        readahead_size_(readahead_size),
+        buf_(NULL),
+        buf_offset_(0),
+        buf_len_(0),
+        pass_through_(NULL) {
+  }
+
+  virtual ~ReadaheadRandomAccessFile() {
+    delete[] buf_;
+  }
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    if (n >= readahead_size_ || pass_through_.Acquire_Load() != NULL) {
+      return file_->Read(offset, n, result, scratch);
+    }
+
+    MutexLock l(&mu_);
+    if (buf_ == NULL) {
+      // Serve the first read directly to find out whether the file returns
+      // data it owns (e.g. a memory mapping), which needs no buffering.
+      // Only allocate the buffer if it does not.
+      Status s = file_->Read(offset, n, result, scratch);
+      if (!s.ok() || result->empty()) {
+        return s;
+      }
+      if (result->data() != scratch) {
+        pass_through_.Release_Store(scratch);  // Any non-NULL value is ok
+        return s;
+      }
+      buf_ = new char[readahead_size_];
+      return s;
+    }
+    if (offset < buf_offset_ || offset + n > buf_offset_ + buf_len_) {
+      // Some files (e.g. memory mappings) reject reads past the end
+      const size_t size = offset >= file_size_ ? n :
+          std::min<uint64_t>(readahead_size_,
+                             std::max<uint64_t>(file_size_ - offset, n));
+      Slice fill;
+      buf_offset_ = offset;
+      buf_len_ = 0;
+      Status s = file_->Read(offset, size, &fill, buf_);
+      if (!s.ok()) {
+        return s;
+      }
+      if (fill.data() != buf_) {
+        // The file returned data it owns (e.g. a memory mapping), so
+        // reads are cheap and copying them would be pure overhead
+        pass_through_.Release_Store(buf_);
+        return file_->Read(offset, n, result, scratch);
+      }
+      buf_len_ = fill.size();
+    }
+
+    // Always copy into scratch: callers expect data that does not point
+    // into scratch to stay valid for the lifetime of the file, which does
+    // not hold for the readahead buffer.
+    size_t copied = 0;
+    if (offset < buf_offset_ + buf_len_) {
+      copied = std::min<uint64_t>(n, buf_offset_ + buf_len_ - offset);
+      memcpy(scratch, buf_ + (offset - buf_offset_), copied);
+    }
+    *result = Slice(scratch, copied);
+    return Status::OK();
+  }
+
+ private:
+  RandomAccessFile* const file_;
+  const uint64_t file_size_;
+  const size_t readahead_size_;
+
+  mutable port::Mutex mu_;
+  mutable char* buf_;
+  mutable uint64_t buf_offset_;   // File offset of buf_[0]
+  mutable size_t buf_len_;        // Number of valid bytes in buf_
+  mutable port::AtomicPointer pass_through_;  // Non-NULL: bypass buf_
+};
+
+}  // namespace
+
+RandomAccessFile* NewReadaheadRandomAccessFile(RandomAccessFile* file,
+                                               uint64_t file_size,
+                                               size_t readahead_size) {
+  return new ReadaheadRandomAccessFile(file, file_size, readahead_size);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,33 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_READAHEAD_FILE_H_
+#define STORAGE_LEVELDB_UTIL_READAHEAD_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace leveldb {
+
+class RandomAccessFile;
+
+// Return a file that serves reads of "file", which is "file_size" bytes
+// long, from a buffer that is refilled with one read of "readahead_size"
+// bytes whenever a read misses it.  Mostly sequential scans (e.g.
+// compaction inputs) then issue a few large reads instead of one small
+// read per block.  Reads larger than "readahead_size" are passed
+// through, and so are all reads once "file" turns out to return data it
+// owns (e.g. a memory mapping), which needs no buffering.  The first read is
+// always passed through to find out, so such files never allocate the
+// buffer.
+//
+// The returned file does not take ownership of "file", which must remain
+// live while the returned file is in use.
+extern RandomAccessFile* NewReadaheadRandomAccessFile(RandomAccessFile* file,
+                                                      uint64_t file_size,
+                                                      size_t readahead_size);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_READAHEAD_FILE_H_
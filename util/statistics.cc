@@ -0,0 +1,154 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/statistics.h"
+
+#include <stdio.h>
+#include "port/port.h"
+#include "util/histogram.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+Statistics::~Statistics() {
+}
+
+static const char* kTickerNames[kNumTickers] = {
+  "leveldb.block.cache.hit",
+  "leveldb.block.cache.miss",
+  "leveldb.bloom.filter.useful",
+  "leveldb.bloom.filter.false.positive",
+  "leveldb.memtable.hit",
+  "leveldb.memtable.miss",
+  "leveldb.get.hit.l0",
+  "leveldb.get.hit.l1",
+  "leveldb.get.hit.l2andup",
+  "leveldb.number.keys.read",
+  "leveldb.bytes.read",
+  "leveldb.number.keys.written",
+  "leveldb.bytes.written",
+  "leveldb.compact.read.bytes",
+  "leveldb.compact.write.bytes",
+  "leveldb.flush.write.bytes",
+  "leveldb.stall.micros",
+};
+
+static const char* kHistogramNames[kNumHistograms] = {
+  "leveldb.db.get.micros",
+  "leveldb.db.write.micros",
+  "leveldb.compaction.micros",
+  "leveldb.flush.micros",
+};
+
+const char* TickerName(Ticker ticker) {
+  return kTickerNames[ticker];
+}
+
+const char* HistogramName(HistogramType histogram) {
+  return kHistogramNames[histogram];
+}
+
+namespace {
+
+// Counters are kept in one shard per CPU core (modulo kNumShards) so that
+// threads running on different cores rarely touch the same cache lines.
+static const int kNumShards = 16;
+
+class StatisticsImpl : public Statistics {
+ public:
+  StatisticsImpl() {
+    for (int i = 0; i < kNumShards; i++) {
+      ClearShard(&shards_[i]);
+    }
+  }
+
+  virtual void RecordTick(Ticker ticker, uint64_t count) {
+    __atomic_fetch_add(&CurrentShard()->tickers[ticker], count,
+                       __ATOMIC_RELAXED);
+  }
+
+  virtual uint64_t GetTickerCount(Ticker ticker) const {
+    uint64_t sum = 0;
+    for (int i = 0; i < kNumShards; i++) {
+      sum += __atomic_load_n(&shards_[i].tickers[ticker], __ATOMIC_RELAXED);
+    }
+    return sum;
+  }
+
+  virtual void MeasureTime(HistogramType histogram, uint64_t micros) {
+    Shard* shard = CurrentShard();
+    MutexLock l(&shard->mu);
+    shard->histograms[histogram].Add(static_cast<double>(micros));
+  }
+
+  virtual std::string GetHistogramString(HistogramType histogram) const {
+    Histogram merged;
+    merged.Clear();
+    for (int i = 0; i < kNumShards; i++) {
+      MutexLock l(&shards_[i].mu);
+      merged.Merge(shards_[i].histograms[histogram]);
+    }
+    return merged.ToString();
+  }
+
+  virtual void Reset() {
+    for (int i = 0; i < kNumShards; i++) {
+      ClearShard(&shards_[i]);
+    }
+  }
+
+  virtual std::string ToString() const {
+    std::string result;
+    char buf[200];
+    for (int i = 0; i < kNumTickers; i++) {
+      Ticker ticker = static_cast<Ticker>(i);
+      snprintf(buf, sizeof(buf), "%s COUNT : %llu\n", TickerName(ticker),
+               static_cast<unsigned long long>(GetTickerCount(ticker)));
+      result.append(buf);
+    }
+    for (int i = 0; i < kNumHistograms; i++) {
+      HistogramType histogram = static_cast<HistogramType>(i);
+      result.append(HistogramName(histogram));
+      result.append(":\n");
+      result.append(GetHistogramString(histogram));
+    }
+    return result;
+  }
+
+ private:
+  struct Shard {
+    uint64_t tickers[kNumTickers];
+    mutable port::Mutex mu;
+    Histogram histograms[kNumHistograms];  // Protected by mu
+    char padding[64];  // Keep shards on separate cache lines
+  };
+
+  Shard* CurrentShard() {
+    int core = port::PhysicalCoreID();
+    if (core < 0) {
+      core = 0;
+    }
+    return &shards_[core % kNumShards];
+  }
+
+  static void ClearShard(Shard* shard) {
+    MutexLock l(&shard->mu);
+    for (int i = 0; i < kNumTickers; i++) {
+      __atomic_store_n(&shard->tickers[i], 0, __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < kNumHistograms; i++) {
+      shard->histograms[i].Clear();
+    }
+  }
+
+  Shard shards_[kNumShards];
+};
+
+}  // namespace
+
+Statistics* CreateDBStatistics() {
+  return new StatisticsImpl;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,30 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_STATISTICS_H_
+#define STORAGE_LEVELDB_UTIL_STATISTICS_H_
+
+#include "leveldb/statistics.h"
+
+namespace leveldb {
+
+// Helpers for recording into an optional Statistics object.
+
+inline void RecordTick(Statistics* statistics, Ticker ticker,
+                       uint64_t count = 1) {
+  if (statistics != NULL) {
+    statistics->RecordTick(ticker, count);
+  }
+}
+
+inline void MeasureTime(Statistics* statistics, HistogramType histogram,
+                        uint64_t micros) {
+  if (statistics != NULL) {
+    statistics->MeasureTime(histogram, micros);
+  }
+}
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_STATISTICS_H_
@@ -4,6 +4,10 @@
 
 #include "util/testutil.h"
 
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "util/hash.h"
 #include "util/random.h"
 
 namespace leveldb {
@@ -47,5 +51,49 @@ extern Slice CompressibleString(Random* rnd, double compressed_fraction,
   return Slice(*dst);
 }
 
+double NextDouble(Random* rnd) {
+  return (rnd->Next() - 1) / 2147483646.0;
+}
+
+static double Zeta(uint64_t n, double theta) {
+  double sum = 0;
+  for (uint64_t i = 1; i <= n; i++) {
+    sum += 1.0 / pow(static_cast<double>(i), theta);
+  }
+  return sum;
+}
+
+ZipfianGenerator::ZipfianGenerator(uint64_t n, double theta)
+    : n_(std::max<uint64_t>(n, 1)),
+      theta_(theta),
+      alpha_(1.0 / (1.0 - theta)),
+      zetan_(Zeta(n_, theta)),
+      eta_((1.0 - pow(2.0 / n_, 1.0 - theta)) /
+           (1.0 - Zeta(2, theta) / zetan_)) {
+}
+
+uint64_t ZipfianGenerator::Next(Random* rnd) const {
+  const double u = NextDouble(rnd);
+  const double uz = u * zetan_;
+  if (uz < 1.0) {
+    return 0;
+  }
+  if (uz < 1.0 + pow(0.5, theta_)) {
+    return 1;
+  }
+  const uint64_t result =
+      static_cast<uint64_t>(n_ * pow(eta_ * u - eta_ + 1.0, alpha_));
+  return std::min(result, n_ - 1);
+}
+
+uint64_t ZipfianGenerator::NextScrambled(Random* rnd) const {
+  const uint64_t item = Next(rnd);
+  char buf[sizeof(item)];
+  memcpy(buf, &item, sizeof(item));
+  const uint64_t hash = (static_cast<uint64_t>(Hash(buf, sizeof(buf), 0))
+                         << 32) | Hash(buf, sizeof(buf), 1);
+  return hash % n_;
+}
+
 }  // namespace test
 }  // namespace leveldb
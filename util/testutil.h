@@ -26,6 +26,35 @@ extern std::string RandomKey(Random* rnd, int len);
 extern Slice CompressibleString(Random* rnd, double compressed_fraction,
                                 size_t len, std::string* dst);
 
+// Returns a uniformly distributed double in [0, 1).
+extern double NextDouble(Random* rnd);
+
+// Generates integers in [0, n) so that the popularity of item i is
+// proportional to 1/(i+1)^theta, using the algorithm from "Quickly
+// Generating Billion-Record Synthetic Databases" (Gray et al, SIGMOD 1994)
+// that YCSB uses.  Thread-safe; the random numbers come from the caller.
+class ZipfianGenerator {
+ public:
+  // REQUIRES: 0 < theta < 1
+  ZipfianGenerator(uint64_t n, double theta);
+
+  uint64_t n() const { return n_; }
+
+  // Item 0 is the most popular.
+  uint64_t Next(Random* rnd) const;
+
+  // Like Next(), but scatters the popular items over the whole range
+  // instead of clustering them at its start.
+  uint64_t NextScrambled(Random* rnd) const;
+
+ private:
+  const uint64_t n_;
+  const double theta_;
+  const double alpha_;
+  const double zetan_;
+  const double eta_;
+};
+
 // A wrapper that allows injection of errors.
 class ErrorEnv : public EnvWrapper {
  public: